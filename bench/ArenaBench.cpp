@@ -0,0 +1,82 @@
+// Measures building a message history on the heap and in a MessageArena: time and heap allocations per turn, and freeing the history.
+// Build and run from the repository root:
+//   g++ -std=c++20 -O2 -Iinclude -Iext bench/ArenaBench.cpp src/*.cpp -lcurl -o ArenaBench && ./ArenaBench
+#include "DeepSeekArena.h"
+#include "DeepSeekConversation.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+static size_t HeapAllocations = 0;
+
+void* operator new(size_t bytes)
+{
+	HeapAllocations++;
+	if (void* pointer = std::malloc(bytes ? bytes : 1)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+int main()
+{
+	const size_t turns = 100000;
+	// A user message and an answer per turn, and a large attachment every 1000 turns
+	const std::string user(400, 'u');
+	const std::string assistant(600, 'a');
+	const std::string attachment(MessageArena::MaxAdoptedBytes * 4, 'f');
+
+	std::printf("%-6s %12s %18s %12s\n", "store", "ns per turn", "heap allocs/turn", "free (ms)");
+	for (bool use_arena : { false, true }) {
+		std::shared_ptr<MessageArena> arena;
+		size_t allocations = HeapAllocations;
+		Clock::time_point start = Clock::now();
+		Conversation history;
+		if (use_arena) {
+			arena = MessageArena::Create();
+			history = Conversation(arena);
+		}
+		for (size_t i = 0; i < turns; i++) {
+			const std::string& text = i % 1000 == 999 ? attachment : user;
+			if (arena) {
+				history.push_back(arena->MakeMessage(Message::Role::User, text));
+				history.push_back(arena->MakeMessage(Message::Role::Assistant, assistant));
+			}
+			else {
+				history.emplace_back(Message::Role::User, text);
+				history.emplace_back(Message::Role::Assistant, assistant);
+			}
+		}
+		double build = std::chrono::duration<double>(Clock::now() - start).count();
+		double per_turn = static_cast<double>(HeapAllocations - allocations) / turns;
+		ArenaStats stats;
+		if (arena) {
+			stats = arena->GetStats();
+			arena.reset();
+		}
+		start = Clock::now();
+		history = Conversation();
+		double release = std::chrono::duration<double>(Clock::now() - start).count();
+		std::printf("%-6s %12.0f %18.2f %12.2f\n", use_arena ? "arena" : "heap", build * 1e9 / turns, per_turn, release * 1e3);
+		if (use_arena) {
+			std::printf("  arena: %zu allocations, %zu bytes, served by %zu heap blocks of %zu bytes in total\n", stats.Allocations, stats.AllocatedBytes,
+				stats.HeapAllocations, stats.HeapBytes);
+		}
+	}
+	return 0;
+}
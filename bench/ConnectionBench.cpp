@@ -0,0 +1,87 @@
+// Measures what a completion request costs once the connections of the instance are warm: requests per second,
+// heap allocations of the C++ code per request (curl allocates with malloc, it isn't counted) and the activity of the connection pool.
+// Needs bench/mock_server.py, see there to build and run it. Run from the repository root:
+//   ./ConnectionBench [requests]
+#include "DeepSeekAPI.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+static std::atomic<size_t> HeapAllocations = 0;
+
+void* operator new(size_t bytes)
+{
+	HeapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* pointer = std::malloc(bytes ? bytes : 1)) {
+		return pointer;
+	}
+	throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+// Sends the requests from the threads, each request answered with the given number of tokens
+static void Run(const API& api, size_t threads, size_t requests, size_t tokens)
+{
+	const std::string message = "GEN:" + std::to_string(tokens) + " Say something.";
+	auto send = [&](size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			api.GetSingleCompletion("You are a helpful assistant.", message);
+		}
+	};
+	// Warms the connections and their buffers up
+	std::vector<std::thread> workers;
+	for (size_t t = 0; t < threads; t++) {
+		workers.emplace_back(send, 4);
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+
+	TransportStats before = api.GetTransportStats();
+	size_t allocations = HeapAllocations.load();
+	Clock::time_point start = Clock::now();
+	for (size_t t = 0; t < threads; t++) {
+		workers.emplace_back(send, requests / threads);
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	TransportStats after = api.GetTransportStats();
+	size_t sent = after.Requests - before.Requests;
+	std::printf("%7zu %8zu %10.0f %14.1f %12zu %12zu %12zu\n", threads, tokens, static_cast<double>(sent) / seconds,
+		static_cast<double>(HeapAllocations.load() - allocations) / static_cast<double>(sent), after.Connections, after.BufferAllocations - before.BufferAllocations,
+		after.RetainedBufferBytes);
+}
+
+int main(int argc, char** argv)
+{
+	size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+	std::printf("%7s %8s %10s %14s %12s %12s %12s\n", "threads", "tokens", "requests/s", "allocs/request", "connections", "buffer grows", "retained");
+	for (size_t threads : { 1, 8 }) {
+		for (size_t tokens : { 10, 1000, 20000 }) {
+			// A new instance each time, so the connection counts start from zero
+			API api("benchmark");
+			Run(api, threads, requests, tokens);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+// Measures attaching a large file to a message and uploading it: read into a string, or memory-mapped (see API::AddFile).
+// Build and run from the repository root:
+//   g++ -std=c++20 -O2 -Iinclude -Iext bench/MappedFileBench.cpp src/*.cpp -lcurl -o MappedFileBench && ./MappedFileBench [file]
+// Without a file, a 256 MB text file is written to the temporary directory and removed at the end.
+// The memory columns come from /proc/self/status, so they're only printed on Linux.
+#include "DeepSeekMappedFile.h"
+#include "DeepSeekMessage.h"
+#include "DeepSeekRequestBody.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+// Returns a field of /proc/self/status in MB, -1 if it's not available
+static long StatusMegabytes(const char* field)
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.rfind(field, 0) == 0) {
+			return std::stol(line.substr(line.find(':') + 1)) / 1024;
+		}
+	}
+	return -1;
+}
+
+// Resets the peak resident size (VmHWM)
+static void ResetPeak()
+{
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+}
+
+static void WriteText(const std::filesystem::path& path, size_t bytes)
+{
+	std::ofstream file(path, std::ios::binary);
+	std::mt19937 random(38);
+	std::string line;
+	for (size_t written = 0; written < bytes; written += line.size()) {
+		line.clear();
+		size_t length = random() % 100;
+		for (size_t i = 0; i < length; i++) {
+			line += static_cast<char>('a' + random() % 26);
+		}
+		// Some characters the JSON escaping has to handle
+		if (random() % 5 == 0) {
+			line += "\t\"quoted\"\\";
+		}
+		line += '\n';
+		file << line;
+	}
+}
+
+// Writes the body of a request with the message and reads it in the chunks curl uploads
+static size_t Upload(const Message& message)
+{
+	RequestBody body;
+	body.AppendLiteral("{\"messages\":[{\"content\":");
+	body.AppendString(message.GetContent());
+	body.AppendLiteral(",\"role\":\"user\"}]}");
+	std::vector<char> buffer(64 * 1024);
+	size_t uploaded = 0;
+	while (size_t read = body.Read(buffer.data(), buffer.size())) {
+		uploaded += read;
+	}
+	return uploaded;
+}
+
+int main(int argc, char** argv)
+{
+	std::filesystem::path path;
+	bool temporary = argc < 2;
+	if (temporary) {
+		path = std::filesystem::temp_directory_path() / "DeepSeekMappedFileBench.txt";
+		WriteText(path, 256u << 20);
+	}
+	else {
+		path = argv[1];
+	}
+
+	std::printf("%-7s %10s %12s %14s %16s\n", "attach", "time (ms)", "body (MB)", "peak RSS (MB)", "anonymous (MB)");
+	for (bool mapped : { false, true }) {
+		ResetPeak();
+		Clock::time_point start = Clock::now();
+		size_t uploaded = 0;
+		long anonymous = 0;
+		{
+			Message message(Message::Role::User, std::string());
+			if (mapped) {
+				std::shared_ptr<const MappedFile> file = MappedFile::Open(path.string());
+				std::string_view content = file->View();
+				message = Message(Message::Role::User, content, std::move(file));
+			}
+			else {
+				std::ifstream file(path, std::ios::binary);
+				std::string content(std::filesystem::file_size(path), '\0');
+				file.read(content.data(), static_cast<std::streamsize>(content.size()));
+				message = Message(Message::Role::User, std::move(content));
+			}
+			uploaded = Upload(message);
+			// The memory the attachment holds while it's in the history
+			anonymous = StatusMegabytes("RssAnon");
+		}
+		double milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		std::printf("%-7s %10.0f %12zu %14ld %16ld\n", mapped ? "mapped" : "read", milliseconds, uploaded >> 20, StatusMegabytes("VmHWM"), anonymous);
+	}
+
+	if (temporary) {
+		std::filesystem::remove(path);
+	}
+	return 0;
+}
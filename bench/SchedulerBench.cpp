@@ -0,0 +1,151 @@
+// Measures the order a RequestScheduler sends a mixed workload in: short and long completions arriving at a steady pace, a few of the long ones with a deadline,
+// through 4 slots, in arrival order (earliest deadline first) and shortest predicted first. The predictions are learned from a warm-up beforehand.
+// - completion: the mean time from submission to answer of the short requests, the long ones and all of them, and the time the whole workload took.
+// - missed: the long requests with a deadline answered past it (a request past its Timeout is aborted). The last row sends them without the Timeout,
+//   to show when shortest first would answer them if their deadline didn't promote them.
+// Needs bench/mock_server.py, see there to build and run it. Run from the repository root:
+//   ./SchedulerBench [requests]
+#include "DeepSeekAPI.h"
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+// A coroutine nobody awaits, it runs until its end on its own
+struct Detached {
+	struct promise_type {
+		Detached get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+// A short request takes about 10 ms on the mock server at 1 ms per token, a long one about 150 ms
+static const std::string ShortUser = "GEN:10 Label this sentence.";
+static const std::string LongUser = "GEN:150 Write an essay about this sentence.";
+static constexpr auto Deadline = 600ms;
+
+struct Request {
+	bool Long = false;
+	bool HasDeadline = false;
+	Clock::time_point Submitted;
+	double Seconds = 0;
+	bool Failed = false;
+};
+
+struct Results {
+	std::vector<Request> Requests;
+	std::atomic<size_t> Done = 0;
+};
+
+static Detached Send(const API& api, Request& request, bool timeout, Results& results)
+{
+	const MessageView messages[] = { { Message::Role::System, "You are a helpful assistant." }, { Message::Role::User, request.Long ? LongUser : ShortUser } };
+	RequestOptions options;
+	options.Tag = request.Long ? "essay" : "label";
+	if (request.HasDeadline && timeout) {
+		options.Timeout = Deadline;
+	}
+	request.Submitted = Clock::now();
+	try {
+		co_await api.GetCompletionAsync(messages, nullptr, options);
+	}
+	catch (const std::exception&) {
+		request.Failed = true;
+	}
+	request.Seconds = std::chrono::duration<double>(Clock::now() - request.Submitted).count();
+	results.Done.fetch_add(1, std::memory_order_release);
+}
+
+// The same workload for every run: one long request in 7, one of those in 3 with a deadline
+static std::vector<Request> MakeWorkload(size_t count)
+{
+	std::mt19937 random(42);
+	std::vector<Request> requests(count);
+	size_t longs = 0;
+	for (Request& request : requests) {
+		request.Long = random() % 7 == 0;
+		request.HasDeadline = request.Long && longs++ % 3 == 0;
+	}
+	return requests;
+}
+
+static void Wait(const Results& results, size_t count)
+{
+	while (results.Done.load(std::memory_order_acquire) < count) {
+		std::this_thread::sleep_for(1ms);
+	}
+}
+
+static void Run(const char* order, bool shortest_first, bool timeout, size_t count)
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 4;
+	options.ReservedSlots = 0;
+	options.ShortestPredictedFirst = shortest_first;
+	auto scheduler = std::make_shared<RequestScheduler>(options);
+	API api("benchmark");
+	api.SetReactor(std::make_shared<Reactor>());
+	api.SetScheduler(scheduler);
+
+	// Learns the completion and the service time of both tags
+	Results warmup;
+	warmup.Requests.resize(8);
+	for (size_t i = 0; i < warmup.Requests.size(); i++) {
+		warmup.Requests[i].Long = i % 2 == 0;
+		Send(api, warmup.Requests[i], false, warmup);
+	}
+	Wait(warmup, warmup.Requests.size());
+
+	// A request every 7 ms is a little more than the slots serve, so a queue builds up
+	Results results;
+	results.Requests = MakeWorkload(count);
+	Clock::time_point start = Clock::now();
+	for (size_t i = 0; i < count; i++) {
+		std::this_thread::sleep_until(start + i * 7ms);
+		Send(api, results.Requests[i], timeout, results);
+	}
+	Wait(results, count);
+	double makespan = std::chrono::duration<double>(Clock::now() - start).count();
+
+	double short_sum = 0, long_sum = 0;
+	size_t shorts = 0, longs = 0, deadlines = 0, missed = 0, failed = 0;
+	for (const Request& request : results.Requests) {
+		(request.Long ? long_sum : short_sum) += request.Seconds;
+		(request.Long ? longs : shorts)++;
+		if (request.HasDeadline) {
+			deadlines++;
+			if (request.Failed || request.Seconds > std::chrono::duration<double>(Deadline).count()) {
+				missed++;
+			}
+		}
+		else if (request.Failed) {
+			failed++;
+		}
+	}
+	std::printf("%-22s %10.1f %10.1f %10.1f %10.2f %7zu/%zu %8zu\n", order, short_sum / shorts * 1000, long_sum / longs * 1000, (short_sum + long_sum) / count * 1000,
+		makespan, missed, deadlines, failed);
+}
+
+int main(int argc, char** argv)
+{
+	size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 400;
+	std::printf("%-22s %10s %10s %10s %10s %9s %8s\n", "order", "short (ms)", "long (ms)", "all (ms)", "total (s)", "missed", "failed");
+	Run("arrival", false, true, count);
+	Run("shortest first", true, true, count);
+	Run("shortest, no deadline", true, false, count);
+	return 0;
+}
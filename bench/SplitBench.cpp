@@ -0,0 +1,74 @@
+// Measures the throughput of the pre-tokenizer (Tokenizer::Split) on every instruction set the CPU supports.
+// Build and run from the repository root:
+//   g++ -std=c++20 -O2 -Iinclude -Iext bench/SplitBench.cpp src/*.cpp -lcurl -o SplitBench && ./SplitBench
+#include "DeepSeekTokenizer.h"
+#include "DeepSeekSimd.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+static std::string MakeText(const std::vector<const char*>& words, size_t bytes, unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::string text;
+	while (text.size() < bytes) {
+		text += words[random() % words.size()];
+	}
+	return text;
+}
+
+// Runs the function for at least half a second and returns the seconds per run
+static double Measure(const std::function<void()>& function)
+{
+	size_t runs = 0;
+	Clock::time_point start = Clock::now();
+	std::chrono::duration<double> elapsed{};
+	do {
+		function();
+		runs++;
+		elapsed = Clock::now() - start;
+	} while (elapsed.count() < 0.5);
+	return elapsed.count() / static_cast<double>(runs);
+}
+
+int main()
+{
+	struct Corpus {
+		const char* Name;
+		std::string Text;
+	};
+	const size_t size = 4 << 20;
+	std::vector<Corpus> corpora = {
+		{ "english", MakeText({ "the ", "request ", "of ", "a ", "model ", "is ", "sent ", "to ", "context ", "window, ", "and ", "it's ", "done. ", "\n" }, size, 1) },
+		{ "code", MakeText({ "int ", "main() ", "{\n", "\treturn ", "value", ";\n", "}\n", "std::string ", "name ", "= ", "\"text\"", "0x7f", "1024", "// comment\n" }, size, 2) },
+		{ "chinese", MakeText({ "\xe4\xb8\xad\xe6\x96\x87", "\xe6\xa8\xa1\xe5\x9e\x8b", "\xe8\xaf\xb7\xe6\xb1\x82", "\xef\xbc\x8c", "\xe3\x80\x82", "\n" }, size, 3) },
+		{ "mixed", MakeText({ "the ", "model ", "\xe4\xb8\xad\xe6\x96\x87", "\xef\xbc\x8c", "2026 ", "\xc3\xa9t\xc3\xa9 ", "\xf0\x9f\x98\x80", "return;\n", "  ", "(x) " }, size, 4) },
+	};
+
+	const char* names[] = { "scalar", "SSE4.2", "AVX2" };
+	std::printf("%-8s", "text");
+	for (const char* name : names) {
+		std::printf(" %12s", name);
+	}
+	std::printf("\n");
+	for (const Corpus& corpus : corpora) {
+		std::printf("%-8s", corpus.Name);
+		for (InstructionSet set : { InstructionSet::Scalar, InstructionSet::SSE42, InstructionSet::AVX2 }) {
+			SetInstructionSet(set);
+			if (GetInstructionSet() != set) {
+				std::printf(" %12s", "-");
+				continue;
+			}
+			double seconds = Measure([&]() { Tokenizer::Split(corpus.Text); });
+			std::printf(" %7.0f MB/s", static_cast<double>(corpus.Text.size()) / 1e6 / seconds);
+		}
+		std::printf("\n");
+	}
+	return 0;
+}
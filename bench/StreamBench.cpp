@@ -0,0 +1,108 @@
+// Measures thousands of concurrent streamed completions (API::StreamCompletionAsync), driven by the epoll event loop (Linux) and by a reactor thread:
+// wall time, CPU time of the process, and whether every stream returned its whole answer.
+// Needs bench/mock_server.py, see there to build and run it. Run from the repository root:
+//   ./StreamBench [tokens per answer]
+#include "DeepSeekAPI.h"
+#ifdef __linux__
+#include "DeepSeekEpoll.h"
+#endif
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <string>
+#include <thread>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+// A coroutine nobody awaits, it runs until its end on its own
+struct Detached {
+	struct promise_type {
+		Detached get_return_object() { return {}; }
+		std::suspend_never initial_suspend() noexcept { return {}; }
+		std::suspend_never final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+struct Results {
+	std::atomic<size_t> Done = 0;
+	std::atomic<size_t> Complete = 0;
+	std::atomic<size_t> Deltas = 0;
+};
+
+static Detached Consume(const API& api, std::span<const MessageView> messages, size_t tokens, Results& results)
+{
+	DeltaStream stream = api.StreamCompletionAsync(messages);
+	try {
+		size_t deltas = 0;
+		while (co_await stream.Next()) {
+			deltas++;
+		}
+		results.Deltas += deltas;
+		if (stream.GetContent().size() == tokens && stream.GetUsage().CompletionTokens == static_cast<int>(tokens)) {
+			results.Complete++;
+		}
+	}
+	catch (const std::exception& e) {
+		std::fprintf(stderr, "%s\n", e.what());
+	}
+	results.Done++;
+}
+
+static void Print(const char* driver, size_t streams, const Results& results, Clock::time_point start, std::clock_t cpu_start)
+{
+	double wall = std::chrono::duration<double>(Clock::now() - start).count();
+	double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+	std::printf("%-8s %8zu %10.2f %10.2f %10zu %10zu\n", driver, streams, wall, cpu, results.Deltas.load(), results.Complete.load());
+}
+
+int main(int argc, char** argv)
+{
+	size_t tokens = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 40;
+	const std::string user = "GEN:" + std::to_string(tokens) + " Tell me a story.";
+	const MessageView messages[] = { { Message::Role::System, "You are a helpful assistant." }, { Message::Role::User, user } };
+
+	std::printf("%-8s %8s %10s %10s %10s %10s\n", "driver", "streams", "wall (s)", "CPU (s)", "deltas", "complete");
+	for (size_t streams : { 100, 1000, 5000 }) {
+#ifdef __linux__
+		{
+			// The coroutines are resumed by Poll, on this thread
+			EpollEventLoop loop;
+			API api("benchmark");
+			api.SetReactor(loop.GetReactor());
+			Results results;
+			Clock::time_point start = Clock::now();
+			std::clock_t cpu_start = std::clock();
+			for (size_t i = 0; i < streams; i++) {
+				Consume(api, messages, tokens, results);
+			}
+			while (results.Done < streams) {
+				loop.Poll(100);
+			}
+			Print("epoll", streams, results, start, cpu_start);
+		}
+#endif
+		{
+			auto reactor = std::make_shared<Reactor>();
+			API api("benchmark");
+			api.SetReactor(reactor);
+			Results results;
+			Clock::time_point start = Clock::now();
+			std::clock_t cpu_start = std::clock();
+			for (size_t i = 0; i < streams; i++) {
+				Consume(api, messages, tokens, results);
+			}
+			while (results.Done < streams) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			Print("thread", streams, results, start, cpu_start);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,190 @@
+// Measures what submitting an asynchronous request costs the submitting threads, from 1 to 32 of them at once:
+// - mutex: the previous design, a vector under a mutex the reactor thread swaps out, and a wakeup per submission.
+// - queue: the SubmissionQueue alone, with the wakeups coalesced the way the reactor does.
+// - reactor: ReactorCore::Submit of a reactor thread, with cancelled transfers it ends without sending anything.
+// The time per submit is wall time, so with more threads than cores it includes the time the threads were preempted.
+// Build and run from the repository root:
+//   g++ -std=c++20 -O2 -Iinclude -Iext bench/SubmitBench.cpp src/*.cpp -lcurl -o SubmitBench && ./SubmitBench
+#include "DeepSeekReactor.h"
+#include <curl/curl.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+	double Seconds = 0;
+	// The time the producers spent in the submit calls, summed
+	double SubmitSeconds = 0;
+};
+
+// Runs the producers together, each calling submit count times, and measures them
+static Result Run(size_t threads, size_t count, const std::function<void(size_t, size_t)>& submit)
+{
+	std::atomic<size_t> ready = 0;
+	std::atomic<bool> go = false;
+	std::vector<double> submit_seconds(threads);
+	std::vector<std::thread> producers;
+	for (size_t t = 0; t < threads; t++) {
+		producers.emplace_back([&, t]() {
+			ready++;
+			while (!go) {
+				std::this_thread::yield();
+			}
+			std::chrono::duration<double> spent{};
+			for (size_t i = 0; i < count; i++) {
+				Clock::time_point start = Clock::now();
+				submit(t, i);
+				spent += Clock::now() - start;
+			}
+			submit_seconds[t] = spent.count();
+		});
+	}
+	while (ready < threads) {
+		std::this_thread::yield();
+	}
+	Clock::time_point start = Clock::now();
+	go = true;
+	for (std::thread& producer : producers) {
+		producer.join();
+	}
+	Result result;
+	result.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+	for (double seconds : submit_seconds) {
+		result.SubmitSeconds += seconds;
+	}
+	return result;
+}
+
+static Result RunMutex(size_t threads, size_t count)
+{
+	CURLM* multi = curl_multi_init();
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Transfer>> pending;
+	std::atomic<size_t> consumed = 0;
+	const size_t total = threads * count;
+	std::thread consumer([&]() {
+		std::vector<std::shared_ptr<Transfer>> taken;
+		while (consumed < total) {
+			curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				taken.swap(pending);
+			}
+			consumed += taken.size();
+			taken.clear();
+		}
+	});
+	Result result = Run(threads, count, [&](size_t, size_t) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pending.emplace_back();
+		}
+		curl_multi_wakeup(multi);
+	});
+	consumer.join();
+	curl_multi_cleanup(multi);
+	return result;
+}
+
+static Result RunQueue(size_t threads, size_t count)
+{
+	CURLM* multi = curl_multi_init();
+	SubmissionQueue queue(SubmissionOptions().Capacity);
+	std::atomic<bool> wakeup_pending = false;
+	std::atomic<size_t> consumed = 0;
+	const size_t total = threads * count;
+	std::thread consumer([&]() {
+		std::shared_ptr<Transfer> taken;
+		while (consumed < total) {
+			curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+			wakeup_pending.store(false, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			while (queue.TryPop(taken)) {
+				consumed++;
+			}
+		}
+	});
+	Result result = Run(threads, count, [&](size_t, size_t) {
+		// Empty transfers: the queue only moves them
+		std::shared_ptr<Transfer> transfer;
+		while (queue.TryPush(transfer) != SubmissionQueue::PushResult::Pushed) {
+			std::this_thread::yield();
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!wakeup_pending.load(std::memory_order_relaxed) && !wakeup_pending.exchange(true)) {
+			curl_multi_wakeup(multi);
+		}
+	});
+	consumer.join();
+	curl_multi_cleanup(multi);
+	return result;
+}
+
+// A cancelled transfer, which the reactor ends as soon as it picks it up, and which is submitted again once done
+class RecycledTransfer : public Transfer {
+public:
+	using Transfer::Transfer;
+
+	void OnDone(int) noexcept override { Done.store(true, std::memory_order_release); }
+
+	std::atomic<bool> Done = true;
+};
+
+static Result RunReactor(size_t threads, size_t count)
+{
+	// A few transfers per producer, each one borrows a connection of the pool
+	const size_t per_thread = 64;
+	auto pool = std::make_shared<ConnectionPool>();
+	auto headers = std::make_shared<RequestHeaders>("benchmark", std::vector<CustomHeader>());
+	std::vector<std::vector<std::shared_ptr<RecycledTransfer>>> transfers(threads);
+	for (auto& list : transfers) {
+		for (size_t i = 0; i < per_thread; i++) {
+			auto transfer = std::make_shared<RecycledTransfer>(pool, headers);
+			transfer->PrepareCompletion(RequestBody());
+			transfer->Cancel();
+			list.push_back(std::move(transfer));
+		}
+	}
+	Reactor reactor;
+	const std::shared_ptr<ReactorCore>& core = reactor.GetCore();
+	Result result = Run(threads, count, [&](size_t t, size_t i) {
+		const std::shared_ptr<RecycledTransfer>& transfer = transfers[t][i % per_thread];
+		while (!transfer->Done.load(std::memory_order_acquire)) {
+			std::this_thread::yield();
+		}
+		transfer->Done.store(false, std::memory_order_relaxed);
+		core->Submit(transfer);
+	});
+	while (reactor.GetActiveTransfers() != 0) {
+		std::this_thread::yield();
+	}
+	return result;
+}
+
+int main()
+{
+	const size_t total = 1 << 20;
+	std::printf("%-8s %-8s %14s %16s\n", "threads", "design", "submits/s", "ns per submit");
+	for (size_t threads : { 1, 4, 8, 16, 32 }) {
+		size_t count = total / threads;
+		struct Design {
+			const char* Name;
+			Result (*Run)(size_t, size_t);
+		};
+		for (Design design : { Design{ "mutex", RunMutex }, Design{ "queue", RunQueue }, Design{ "reactor", RunReactor } }) {
+			// The reactor also waits for its own thread to end the transfers, a quarter of the submissions is enough
+			size_t runs = design.Run == RunReactor ? count / 4 : count;
+			Result result = design.Run(threads, runs);
+			double submissions = static_cast<double>(threads * runs);
+			std::printf("%-8zu %-8s %14.0f %16.1f\n", threads, design.Name, submissions / result.Seconds, result.SubmitSeconds / submissions * 1e9);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,71 @@
+// Measures the throughput of the tokenizer on English, code, Chinese and mixed text.
+// Build and run from the repository root:
+//   g++ -std=c++20 -O2 -Iinclude -Iext bench/TokenizerBench.cpp src/*.cpp -lcurl -o TokenizerBench && ./TokenizerBench [tokenizer.json]
+// The default tokenizer is the small one of the tests, pass a DeepSeek tokenizer.json for the real vocabulary.
+#include "DeepSeekTokenizer.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = std::chrono::steady_clock;
+
+static std::string MakeText(const std::vector<const char*>& words, size_t bytes, unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::string text;
+	while (text.size() < bytes) {
+		text += words[random() % words.size()];
+	}
+	return text;
+}
+
+// Runs the function for at least half a second and returns the seconds per run
+static double Measure(const std::function<void()>& function)
+{
+	size_t runs = 0;
+	Clock::time_point start = Clock::now();
+	std::chrono::duration<double> elapsed{};
+	do {
+		function();
+		runs++;
+		elapsed = Clock::now() - start;
+	} while (elapsed.count() < 0.5);
+	return elapsed.count() / static_cast<double>(runs);
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "tests/data/bpe_tokenizer.json";
+	struct Corpus {
+		const char* Name;
+		std::string Text;
+	};
+	const size_t size = 4 << 20;
+	std::vector<Corpus> corpora = {
+		{ "english", MakeText({ "the ", "request ", "of ", "a ", "model ", "is ", "sent ", "to ", "context ", "window, ", "and ", "it's ", "done. ", "\n" }, size, 1) },
+		{ "code", MakeText({ "int ", "main() ", "{\n", "\treturn ", "value", ";\n", "}\n", "std::string ", "name ", "= ", "\"text\"", "0x7f", "1024", "// comment\n" }, size, 2) },
+		{ "chinese", MakeText({ "\xe4\xb8\xad\xe6\x96\x87", "\xe6\xa8\xa1\xe5\x9e\x8b", "\xe8\xaf\xb7\xe6\xb1\x82", "\xef\xbc\x8c", "\xe3\x80\x82", "\n" }, size, 3) },
+		{ "mixed", MakeText({ "the ", "model ", "\xe4\xb8\xad\xe6\x96\x87", "\xef\xbc\x8c", "2026 ", "\xc3\xa9t\xc3\xa9 ", "\xf0\x9f\x98\x80", "return;\n", "  ", "(x) " }, size, 4) },
+	};
+
+	std::printf("%-8s %12s %12s %12s %14s\n", "text", "encode cold", "encode warm", "count warm", "count memoized");
+	for (const Corpus& corpus : corpora) {
+		// A new tokenizer per corpus, so the first run fills its piece cache
+		Tokenizer tokenizer(path);
+		double megabytes = static_cast<double>(corpus.Text.size()) / 1e6;
+		Clock::time_point start = Clock::now();
+		size_t tokens = tokenizer.Encode(corpus.Text).size();
+		double cold = std::chrono::duration<double>(Clock::now() - start).count();
+		double warm = Measure([&]() { tokenizer.Encode(corpus.Text); });
+		double count = Measure([&]() { tokenizer.CountTokens(std::string_view(corpus.Text)); });
+		// Counted once, then read from the memo of the message
+		Message message(Message::Role::User, corpus.Text);
+		double memo = Measure([&]() { tokenizer.CountTokens(message); });
+		std::printf("%-8s %7.1f MB/s %7.1f MB/s %7.1f MB/s %11.0f ns  (%zu tokens)\n", corpus.Name, megabytes / cold, megabytes / warm, megabytes / count, memo * 1e9, tokens);
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+# A local stand-in for the chat completions endpoint, for the benchmarks sending requests (no API key, no network, no cost).
+# Build the benchmark with the requests pointed at it, start it, then run the benchmark:
+#   python3 bench/mock_server.py [port] [ms per token] &
+#   g++ -std=c++20 -O2 -Iinclude -Iext -DINX_DEEPSEEK_API_URL='"http://127.0.0.1:8090"' bench/<Bench>.cpp src/*.cpp -lcurl -o <Bench>
+# A request containing GEN:<n> gets an answer of n tokens (10 by default), generated at the given pace (1 ms per token by default)
+# after a prefill proportional to the prompt. Streamed requests ("stream":true) get their tokens as server-sent events.
+import asyncio
+import json
+import re
+import sys
+
+PORT = int(sys.argv[1]) if len(sys.argv) > 1 else 8090
+MS_PER_TOKEN = float(sys.argv[2]) if len(sys.argv) > 2 else 1.0
+# Streamed tokens are sent in groups, so thousands of streams don't need a timer per token
+TOKENS_PER_SLEEP = 8
+
+
+async def read_body(reader):
+    head = await reader.readuntil(b"\r\n\r\n")
+    length = 0
+    chunked = False
+    for line in head.split(b"\r\n"):
+        name, _, value = line.partition(b":")
+        if name.strip().lower() == b"content-length":
+            length = int(value)
+        elif name.strip().lower() == b"transfer-encoding" and b"chunked" in value.lower():
+            chunked = True
+    if not chunked:
+        return await reader.readexactly(length) if length else b""
+    body = b""
+    while True:
+        size = int((await reader.readuntil(b"\r\n")).split(b";")[0], 16)
+        chunk = await reader.readexactly(size + 2)
+        if size == 0:
+            return body
+        body += chunk[:-2]
+
+
+def usage(prompt, tokens):
+    return {"prompt_tokens": prompt, "completion_tokens": tokens, "total_tokens": prompt + tokens}
+
+
+async def answer(writer, body):
+    match = re.search(rb"GEN:(\d+)", body)
+    tokens = int(match.group(1)) if match else 10
+    prompt = len(body) // 4
+    # The prefill
+    await asyncio.sleep(prompt * 0.002 / 1000.0)
+    if re.search(rb'"stream"\s*:\s*true', body) is None:
+        await asyncio.sleep(tokens * MS_PER_TOKEN / 1000.0)
+        payload = json.dumps({"choices": [{"message": {"role": "assistant", "content": "x" * tokens}, "finish_reason": "stop"}],
+                              "usage": usage(prompt, tokens)}).encode()
+        writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %d\r\n\r\n" % len(payload) + payload)
+        await writer.drain()
+        return
+    writer.write(b"HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nTransfer-Encoding: chunked\r\n\r\n")
+
+    def event(data):
+        line = b"data: " + data + b"\n\n"
+        writer.write(b"%x\r\n" % len(line) + line + b"\r\n")
+
+    delta = json.dumps({"choices": [{"delta": {"content": "x"}}]}).encode()
+    for sent in range(tokens):
+        if sent % TOKENS_PER_SLEEP == 0:
+            await writer.drain()
+            await asyncio.sleep(TOKENS_PER_SLEEP * MS_PER_TOKEN / 1000.0)
+        event(delta)
+    event(json.dumps({"choices": [], "usage": usage(prompt, tokens)}).encode())
+    event(b"[DONE]")
+    writer.write(b"0\r\n\r\n")
+    await writer.drain()
+
+
+async def handle(reader, writer):
+    try:
+        while True:
+            await answer(writer, await read_body(reader))
+    except (asyncio.IncompleteReadError, ConnectionError):
+        pass
+    writer.close()
+
+
+async def main():
+    server = await asyncio.start_server(handle, "127.0.0.1", PORT, backlog=8192)
+    async with server:
+        await server.serve_forever()
+
+
+if __name__ == "__main__":
+    asyncio.run(main())
@@ -2,9 +2,25 @@
 
 #include <string>
 #include <vector>
+#include <future>
+#include <memory>
+#include <span>
 #include "DeepSeekMessage.h"
 #include "DeepSeekModel.h"
 #include "DeepSeekBalance.h"
+#include "DeepSeekUsage.h"
+#include "DeepSeekTokenizer.h"
+#include "DeepSeekContextWindow.h"
+#include "DeepSeekCompaction.h"
+#include "DeepSeekConversation.h"
+#include "DeepSeekMappedFile.h"
+#include "DeepSeekRequestBody.h"
+#include "DeepSeekStream.h"
+#include "DeepSeekConnection.h"
+#include "DeepSeekHeaders.h"
+#include "DeepSeekAsync.h"
+#include "DeepSeekRequestOptions.h"
+#include "DeepSeekScheduler.h"
 
 #pragma comment(lib, "Ws2_32.lib")
 #pragma comment(lib, "Advapi32.lib")
@@ -24,7 +40,7 @@ namespace inx::DeepSeek {
 		/// </summary>
 		/// <param name="api_key">Your API key from https://platform.deepseek.com/api_keys</param>
 		/// <param name="model">The model to use for completions</param>
-		/// <param name="system_prompt">The system prompt (it will be added as the first system message)</param>
+		/// <param name="system_prompt">The system prompt (it will be added as the first system message). It's interned: instances with the same prompt share a single copy.</param>
 		API(std::string_view api_key, Model model = Model::DeepSeekChat, std::string_view system_prompt = "You are a helpful assistant");
 
 		/// <summary>
@@ -51,12 +67,36 @@ namespace inx::DeepSeek {
 		/// <param name="message">The message to add</param>
 		void AddMessage(const std::string& message);
 
+		/// <summary>
+		/// Adds your message to the history, taking over the string instead of copying it.
+		/// <para>Use it for large documents: the content is then only copied once, into the request body.</para>
+		/// </summary>
+		/// <param name="message">The message to add</param>
+		void AddMessage(std::string&& message);
+
 		/// <summary>
 		/// Adds a custom message to the history. You can define the role (system, user, assistant) yourself.
 		/// </summary>
 		/// <param name="message">The message to add</param>
 		void AddCustomMessage(const Message& message);
 
+		/// <summary>
+		/// Adds a custom message to the history, taking over its content instead of copying it.
+		/// <para>A message viewing external content (see the Message constructor taking an owner) is added without copying the content at all.</para>
+		/// </summary>
+		/// <param name="message">The message to add</param>
+		void AddCustomMessage(Message&& message);
+
+		/// <summary>
+		/// Adds the content of a local file to the history, as a message of its own.
+		/// <para>The file is memory-mapped instead of being read: its content is never copied into the history, only escaped into the request bodies.
+		/// The mapping stays alive as long as the message (or a copy of it) does, so don't modify the file in the meantime.</para>
+		/// <para>The file must be UTF-8 text, the requests throw std::runtime_error otherwise.</para>
+		/// </summary>
+		/// <param name="path">The path to the file</param>
+		/// <param name="role">The role of the message</param>
+		void AddFile(const std::string& path, Message::Role role = Message::Role::User);
+
 		/// <summary>
 		/// Adds the message to the history and calls GetCompletion for you.
 		/// <para>This is a convenience function combining AddMessage and GetCompletion.</para>
@@ -73,24 +113,142 @@ namespace inx::DeepSeek {
 		/// <returns>The AI's response</returns>
 		std::string GetCompletion();
 
+		/// <summary>
+		/// Performs a blocking completion request to DeepSeek using the provided messages instead of the message history.
+		/// <para>The message history is neither read nor modified, so this can be called concurrently from multiple threads.</para>
+		/// </summary>
+		/// <param name="messages">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request.</param>
+		/// <returns>The AI's response</returns>
+		std::string GetCompletion(const std::vector<Message>& messages, Usage* usage = nullptr) const;
+
+		/// <summary>
+		/// Performs a blocking completion request to DeepSeek using a conversation instead of the message history.
+		/// <para>Use it with forks of the history (copies of GetConversation) to regenerate an answer or try alternatives without touching the history.</para>
+		/// </summary>
+		/// <param name="conversation">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request.</param>
+		/// <returns>The AI's response</returns>
+		std::string GetCompletion(const Conversation& conversation, Usage* usage = nullptr) const;
+
+		/// <summary>
+		/// Performs a blocking completion request to DeepSeek using views of messages owned by the caller.
+		/// <para>The request is written directly from the views: no message is copied and the message history is neither read nor modified.</para>
+		/// <para>It only reads the settings of the instance, so any number of threads can call it concurrently on the same instance (as long as the settings don't change meanwhile).</para>
+		/// </summary>
+		/// <param name="messages">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request.</param>
+		/// <returns>The AI's response</returns>
+		std::string GetCompletion(std::span<const MessageView> messages, Usage* usage = nullptr) const;
+
+		/// <summary>
+		/// Performs a blocking completion request to DeepSeek like GetCompletion, but streams the response: on_delta receives each piece of the answer as soon as it's generated.
+		/// <para>The deltas are always whole UTF-8 code points, even when the network splits a character. on_delta is called on the calling thread, an exception thrown from it cancels the request and is rethrown.</para>
+		/// <para>Once the stream ends, the whole response is added to the history and returned.</para>
+		/// </summary>
+		/// <param name="on_delta">Called with every piece of the response</param>
+		/// <returns>The AI's response</returns>
+		std::string StreamCompletion(const DeltaCallback& on_delta);
+
+		/// <summary>
+		/// Performs a blocking, streamed completion request to DeepSeek using views of messages owned by the caller, see StreamCompletion and the GetCompletion overload taking views.
+		/// </summary>
+		/// <param name="messages">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="on_delta">Called with every piece of the response</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request.</param>
+		/// <returns>The AI's response</returns>
+		std::string StreamCompletion(std::span<const MessageView> messages, const DeltaCallback& on_delta, Usage* usage = nullptr) const;
+
+		/// <summary>
+		/// Performs an asynchronous completion request to DeepSeek using views of messages owned by the caller: co_await the result to get the AI's response.
+		/// <para>The request is sent through the reactor (see SetReactor) when it's awaited, the awaiting coroutine doesn't block any thread meanwhile and is resumed on the reactor thread.</para>
+		/// <para>The body is prepared right away, so the errors of the messages (context window, invalid UTF-8) are thrown here. The contents of the messages must stay valid until co_await returns.</para>
+		/// <para>Like the blocking version, the message history is neither read nor modified.</para>
+		/// </summary>
+		/// <param name="messages">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request, it must stay valid until co_await returns.</param>
+		/// <param name="options">Optional: The timeouts and retries of the request.</param>
+		/// <returns>The awaitable request</returns>
+		CompletionAwaitable GetCompletionAsync(std::span<const MessageView> messages, Usage* usage = nullptr, const RequestOptions& options = {}) const;
+
+		/// <summary>
+		/// Performs an asynchronous completion request to DeepSeek using a conversation, which the request keeps alive (copying it is O(1)), see the overload taking views.
+		/// </summary>
+		/// <param name="conversation">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request, it must stay valid until co_await returns.</param>
+		/// <param name="options">Optional: The timeouts and retries of the request.</param>
+		/// <returns>The awaitable request</returns>
+		CompletionAwaitable GetCompletionAsync(Conversation conversation, Usage* usage = nullptr, const RequestOptions& options = {}) const;
+
+		/// <summary>
+		/// Performs an asynchronous, streamed completion request to DeepSeek using views of messages owned by the caller: the deltas are awaited one after the other.
+		/// <para>Consume it with: while (auto delta = co_await stream.Next()) { ... }, see DeltaStream. The contents of the messages must stay valid until the stream ended.</para>
+		/// </summary>
+		/// <param name="messages">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="options">Optional: The timeouts and retries of the request, it's only retried before its first delta.</param>
+		/// <returns>The stream of deltas</returns>
+		DeltaStream StreamCompletionAsync(std::span<const MessageView> messages, const RequestOptions& options = {}) const;
+
+		/// <summary>
+		/// Performs an asynchronous, streamed completion request to DeepSeek using a conversation, which the request keeps alive, see the overload taking views.
+		/// </summary>
+		/// <param name="conversation">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="options">Optional: The timeouts and retries of the request, it's only retried before its first delta.</param>
+		/// <returns>The stream of deltas</returns>
+		DeltaStream StreamCompletionAsync(Conversation conversation, const RequestOptions& options = {}) const;
+
 		/// <summary>
 		/// Performs a blocking completion request to DeepSeek.
-		/// <para>It will not read any message history, this function creates its own, containing only the system prompt and the provided message.</para>
-		/// <para>This is intended for single-turn interactions without maintaining state.</para>
+		/// <para>It will not read any message history, the request only contains the system prompt and the provided message.</para>
+		/// <para>This is intended for single-turn interactions without maintaining state.
+		/// Neither the history nor the system prompt of the instance are touched, so it can be called concurrently (see the GetCompletion overload taking views).</para>
 		/// </summary>
 		/// <param name="system_prompt">The system prompt</param>
 		/// <param name="user_message">The user message</param>
+		/// <param name="usage">Optional: Receives the token usage reported for this request.</param>
 		/// <returns></returns>
-		std::string GetSingleCompletion(const std::string& system_prompt, const std::string& user_message);
+		std::string GetSingleCompletion(std::string_view system_prompt, std::string_view user_message, Usage* usage = nullptr) const;
+
+		/// <summary>
+		/// Primes DeepSeek's prefix cache with the provided messages, so that requests starting with the same messages get cache hits.
+		/// <para>It sends a minimal request (max_tokens = 1) and blocks until it completed, after which it's safe to fan out the requests sharing the prefix.</para>
+		/// <para>The message history is neither read nor modified.</para>
+		/// <para>The context window (see SetContextWindow) isn't applied, the prefix is sent whole: keep it within the window, or the requests of the fan-out are truncated to a different prefix.</para>
+		/// </summary>
+		/// <param name="messages">The shared prefix, usually a system prompt followed by a large document.</param>
+		/// <returns>The usage of the warming request. PromptCacheHitTokens is the part of the prefix that was already cached, PromptCacheMissTokens the part that was just written to the cache.</returns>
+		Usage WarmPrefix(const std::vector<Message>& messages) const;
+
+		/// <summary>
+		/// Non-blocking version of WarmPrefix.
+		/// <para>The returned future becomes ready once the fan-out can safely start, it can be shared between the threads waiting for it.</para>
+		/// <para>The API instance must outlive the warming request.</para>
+		/// </summary>
+		/// <param name="messages">The shared prefix, usually a system prompt followed by a large document.</param>
+		/// <returns>A future holding the usage of the warming request, or the exception if it failed.</returns>
+		std::shared_future<Usage> WarmPrefixAsync(std::vector<Message> messages) const;
 
 		/// <summary>
 		/// Overwrites the message history with your own one.
 		/// <para>This will remove all previous history!</para>
 		/// <para>Make sure the first message is a system prompt message.</para>
+		/// <para>The tokens of large histories are counted in parallel on all cores.</para>
 		/// </summary>
 		/// <param name="new_history">The history to overwrite the current one with.</param>
 		void SetMessageHistory(const std::vector<Message>& new_history);
 
+		/// <summary>
+		/// Overwrites the message history with your own one, taking over the messages instead of copying them.
+		/// </summary>
+		/// <param name="new_history">The history to overwrite the current one with.</param>
+		void SetMessageHistory(std::vector<Message>&& new_history);
+
+		/// <summary>
+		/// Overwrites the message history with a conversation, usually a fork of the history. This doesn't copy any message.
+		/// </summary>
+		/// <param name="new_history">The history to overwrite the current one with.</param>
+		void SetMessageHistory(Conversation new_history);
+
 		/// <summary>
 		/// Resets the message history to only contain the system prompt.
 		/// </summary>
@@ -98,10 +256,77 @@ namespace inx::DeepSeek {
 		void ResetMessageHistory(std::optional<std::string> new_system_prompt = {});
 
 		/// <summary>
-		/// Returns a non-modifiable message history as an std::vector.
+		/// Returns a copy of the message history.
+		/// <para>It copies every message, use GetConversation to read the history or fork it without copying.</para>
+		/// </summary>
+		/// <returns></returns>
+		std::vector<Message> GetMessageHistory() const;
+
+		/// <summary>
+		/// Returns a non-modifiable message history.
+		/// <para>Copying it forks the conversation in O(1), the copy shares the messages with the history.</para>
+		/// </summary>
+		/// <returns></returns>
+		const Conversation& GetConversation() const { return History; }
+
+		/// <summary>
+		/// Stores the message history in a monotonic arena (see MessageArena) instead of one heap allocation per message.
+		/// <para>Every reset, replacement or compaction of the history starts a new arena, and the previous one is freed in one shot.
+		/// The allocation stats are available through GetConversation().GetArena().</para>
+		/// <para>The current history is moved into an arena right away. You can leave it empty to go back to the heap (the default).</para>
+		/// </summary>
+		/// <param name="initial_bytes">The size of the first block of each arena</param>
+		void SetHistoryArena(std::optional<size_t> initial_bytes = {});
+
+		/// <summary>
+		/// Sets the tokenizer used to count the tokens of the message history.
+		/// <para>The tokenizer can be shared between several API instances. Pass nullptr to go back to the estimate.</para>
+		/// </summary>
+		/// <param name="tokenizer">The tokenizer</param>
+		void SetTokenizer(std::shared_ptr<const Tokenizer> tokenizer);
+
+		/// <summary>
+		/// Returns the prompt tokens the message history costs in a request, including the chat template.
+		/// <para>This is a running total kept up to date as messages are added, so it's free to call before every request.</para>
+		/// <para>Without a tokenizer (see SetTokenizer), it's an estimate of 4 bytes per token.</para>
+		/// </summary>
+		/// <returns></returns>
+		size_t GetHistoryTokenCount() const;
+
+		/// <summary>
+		/// Returns the prompt tokens a request with these messages costs, including the chat template, before the context window is applied.
+		/// <para>Without a tokenizer (see SetTokenizer), it's an estimate of 4 bytes per token.</para>
+		/// </summary>
+		/// <param name="messages">The messages of the request</param>
+		size_t CountPromptTokens(std::span<const Message> messages) const;
+
+		/// <summary>
+		/// Returns the token usage reported by the last GetCompletion call that used the message history.
 		/// </summary>
 		/// <returns></returns>
-		const std::vector<Message>& GetMessageHistory() const;
+		const Usage& GetLastUsage() const;
+
+		/// <summary>
+		/// Changes the API key used for the requests sent from now on (the requests in flight finish with the previous one).
+		/// </summary>
+		/// <param name="api_key">Your API key from https://platform.deepseek.com/api_keys</param>
+		void SetAPIKey(std::string_view api_key);
+
+		/// <summary>
+		/// Sets headers added to every request, for example tracing or tenant ids.
+		/// <para>The header lists are built once here (and when the key changes), so the headers cost nothing per request.
+		/// They're sent after the headers of the library, don't use them to replace Authorization or Content-Type.</para>
+		/// <para>Throws std::runtime_error if a name is empty or isn't a valid header name, or if a value contains a line break. The previous headers are then kept.</para>
+		/// <para>You can leave it empty to remove them.</para>
+		/// </summary>
+		/// <param name="headers">The names and values of the headers</param>
+		void SetCustomHeaders(std::vector<CustomHeader> headers = {});
+
+		/// <summary>
+		/// Returns the headers added to every request, see SetCustomHeaders.
+		/// </summary>
+		/// <returns></returns>
+		const std::vector<CustomHeader>& GetCustomHeaders() const { return Headers->GetCustomHeaders(); }
 
 		/// <summary>
 		/// Changes the model used for completions.
@@ -115,6 +340,47 @@ namespace inx::DeepSeek {
 		/// <returns></returns>
 		Balance GetBalance();
 
+		/// <summary>
+		/// Performs an asynchronous request to get the balance for the provided API key: co_await the result to get the balance.
+		/// </summary>
+		/// <param name="options">Optional: The timeouts and retries of the request.</param>
+		/// <returns>The awaitable request</returns>
+		BalanceAwaitable GetBalanceAsync(const RequestOptions& options = {}) const;
+
+		/// <summary>
+		/// Sets the reactor sending the asynchronous requests of this instance.
+		/// <para>You can leave it empty to use the default reactor, shared by all the instances.</para>
+		/// </summary>
+		/// <param name="reactor">The reactor</param>
+		void SetReactor(std::shared_ptr<Reactor> reactor = {}) { AsyncReactor = std::move(reactor); }
+
+		/// <summary>
+		/// Sets the scheduler the completion requests of this instance go through, blocking and asynchronous ones alike.
+		/// <para>Give the same scheduler to all the instances using the same API key (copies of an instance share it), so that they share its concurrency limit by priority, see RequestScheduler.</para>
+		/// <para>You can leave it empty to send the requests right away (the default).</para>
+		/// </summary>
+		/// <param name="scheduler">The scheduler</param>
+		void SetScheduler(std::shared_ptr<RequestScheduler> scheduler = {}) { Scheduler = std::move(scheduler); }
+		/// <summary>
+		/// Sets the class of the completion requests of this instance for its scheduler, unless RequestOptions::Priority overrides it. The default is RequestPriority::Normal.
+		/// </summary>
+		void SetPriority(RequestPriority priority) { Priority = priority; }
+		/// <summary>
+		/// Sets the tenant the completion requests of this instance are sent for, unless RequestOptions::Tenant overrides it.
+		/// The scheduler shares its slots fairly between the tenants, see RequestScheduler::SetTenant. The default is the empty tenant.
+		/// </summary>
+		void SetTenant(std::string tenant = {}) { Tenant = std::move(tenant); }
+		/// <summary>
+		/// Sets the tag of the completion requests of this instance, unless RequestOptions::Tag overrides it.
+		/// The scheduler predicts the completion of a request from the previous ones of its tag, see SchedulerOptions::ShortestPredictedFirst. The default is the empty tag.
+		/// </summary>
+		void SetTag(std::string tag = {}) { Tag = std::move(tag); }
+		/// <summary>
+		/// Returns the scheduler of this instance, empty if it has none.
+		/// </summary>
+		/// <returns></returns>
+		const std::shared_ptr<RequestScheduler>& GetScheduler() const { return Scheduler; }
+
 		/// <summary>
 		/// Set the maximum amount of tokens for the completion requests.
 		/// <para>You can leave it empty to stick with the default.</para>
@@ -135,13 +401,211 @@ namespace inx::DeepSeek {
 		/// <para>Find more information about this parameter here: https://api-docs.deepseek.com/api/create-chat-completion</para>
 		/// </summary>
 		void SetTopP(std::optional<double> top_p = {}) { TopP = top_p; }
+		/// <summary>
+		/// Sets the token budget of the prompt for the completion requests.
+		/// <para>When a request exceeds it, messages are left out of the request according to the strategy, the message history is kept as is.</para>
+		/// <para>If the request still doesn't fit after truncation, the completion throws before anything is sent.</para>
+		/// <para>You can leave it empty to always send every message (the default).</para>
+		/// </summary>
+		void SetContextWindow(std::optional<ContextWindow> context_window = {}) { Window = context_window; }
+
+		/// <summary>
+		/// Enables the background compaction of the message history, see CompactionPolicy.
+		/// <para>The summaries are requested asynchronously, through the reactor and the scheduler of the instance (as RequestPriority::Batch requests of its tenant), and spliced into the history by the next call that adds a message or requests a completion, nothing ever waits for them.</para>
+		/// <para>Destroying the instance, or replacing its history, cancels the summary in progress.</para>
+		/// <para>SetMessageHistory and ResetMessageHistory discard a summary still in progress.</para>
+		/// <para>You can leave it empty to disable the compaction (the default).</para>
+		/// </summary>
+		void SetCompactionPolicy(std::optional<CompactionPolicy> compaction_policy = {}) { Compaction = compaction_policy; }
+
+		/// <summary>
+		/// Returns whether a summary of the history is being requested in the background.
+		/// </summary>
+		/// <returns></returns>
+		bool IsCompacting() const;
+
+		/// <summary>
+		/// Blocks until the summary being requested (if any) is done, then applies it to the history.
+		/// <para>Useful before saving the history, the conversation itself never needs to call this.</para>
+		/// </summary>
+		void WaitForCompaction();
+
+		/// <summary>
+		/// Returns the totals of the compactions applied to the history so far.
+		/// </summary>
+		/// <returns></returns>
+		const CompactionStats& GetCompactionStats() const { return CompactionMetrics; }
+
+		/// <summary>
+		/// Returns the activity of the connections of this instance: requests, connections created and response buffer allocations.
+		/// <para>Requests reuse idle connections and their response buffers, so in steady state receiving a response allocates nothing.</para>
+		/// </summary>
+		/// <returns></returns>
+		TransportStats GetTransportStats() const { return Connections->GetStats(); }
+
+		/// <summary>
+		/// Frees the response buffers kept by the idle connections, for example when the application is low on memory.
+		/// <para>They're also shrunk automatically past ConnectionPool::MaxRetainedBytes. The connections stay open.</para>
+		/// </summary>
+		void TrimConnections() { Connections->Trim(); }
 	private:
-		std::string APIKey, SystemPrompt;
-		std::vector<Message> History;
+		/// <summary>
+		/// (internal) The request of a summary and its result.
+		/// </summary>
+		struct CompactionTask;
+		/// <summary>
+		/// (internal) Owns the summary in progress: it's cancelled when the instance is destroyed or its history replaced, and a copy of the instance doesn't share it.
+		/// </summary>
+		class CompactionHandle {
+		public:
+			CompactionHandle() = default;
+			CompactionHandle(const CompactionHandle&) {}
+			CompactionHandle(CompactionHandle&&) noexcept = default;
+			CompactionHandle& operator=(const CompactionHandle& other);
+			CompactionHandle& operator=(CompactionHandle&& other) noexcept;
+			~CompactionHandle();
+
+			/// <summary>
+			/// Cancels the request if it's still in flight, and forgets it.
+			/// </summary>
+			void Cancel();
+
+			std::shared_ptr<CompactionTask> Task;
+		};
+		/// <summary>
+		/// (internal) The messages of a request kept by the context window: [0, HeadEnd) followed by [TailBegin, end).
+		/// </summary>
+		struct WindowSelection {
+			size_t HeadEnd = 0;
+			size_t TailBegin = 0;
+			size_t TrimmedTokens = 0;
+			/// <summary>
+			/// (internal) The prompt tokens of the messages kept, if the window had to count them.
+			/// </summary>
+			std::optional<size_t> PromptTokens;
+		};
+
+		/// <summary>
+		/// (internal) The settings a completion request is sent with: those of the instance, overridden by the options of the request.
+		/// </summary>
+		struct RequestSettings {
+			Model SelectedModel = Model::DeepSeekChat;
+			std::optional<int> MaxTokens;
+			std::optional<double> Temperature;
+			std::optional<double> TopP;
+			RequestPriority Priority = RequestPriority::Normal;
+			std::string Tenant;
+			std::string Tag;
+		};
+
+		/// <summary>
+		/// (internal) Returns the settings of the instance, overridden by the options of a request.
+		/// </summary>
+		RequestSettings GetRequestSettings(const RequestOptions& options = {}) const;
+		/// <summary>
+		/// (internal) Applies the context window to the messages of a request.
+		/// </summary>
+		/// <param name="messages">The messages of the request</param>
+		/// <param name="known_tokens">The token count of the messages, if it's already known</param>
+		WindowSelection SelectWindow(std::span<const MessageView> messages, std::optional<size_t> known_tokens = {}) const;
+		/// <summary>
+		/// (internal) Returns the prompt tokens of the messages kept by the window, the cost of the request for the scheduler. Only counted if the window didn't count them already.
+		/// </summary>
+		size_t CountWindowTokens(std::span<const MessageView> messages, const WindowSelection& window) const;
+		/// <summary>
+		/// (internal) Prepares the JSON body of a completion request from the settings and the messages kept by the window.
+		/// <para>The body views the messages, they must outlive it.</para>
+		/// </summary>
+		/// <param name="stream">Requests a streamed response, with the usage in the last event</param>
+		RequestBody BuildRequestBody(std::span<const MessageView> messages, const WindowSelection& window, const RequestSettings& settings, bool stream = false) const;
+		/// <summary>
+		/// (internal) Returns the reactor of the asynchronous requests.
+		/// </summary>
+		std::shared_ptr<ReactorCore> GetReactorCore() const;
+		/// <summary>
+		/// (internal) Applies the window to the views of an asynchronous completion, prepares its body and gives it to the scheduler, like Complete.
+		/// </summary>
+		void PrepareOperation(CompletionOperation& operation) const;
+		/// <summary>
+		/// (internal) Prepares the body of a completion request from the messages kept by the window and gives it to the scheduler, with the settings given.
+		/// <para>Shared by the blocking, asynchronous, streamed and summarization requests.</para>
+		/// </summary>
+		/// <param name="on_delta">Streams the response to this callback if provided</param>
+		void PrepareTransfer(Transfer& transfer, std::span<const MessageView> messages, const WindowSelection& window, const RequestSettings& settings, DeltaCallback on_delta = {}) const;
+		/// <summary>
+		/// (internal) Prepares an asynchronous completion and wraps it in its awaitable.
+		/// </summary>
+		CompletionAwaitable PrepareCompletionAsync(std::shared_ptr<CompletionOperation> operation, Usage* usage) const;
+		/// <summary>
+		/// (internal) Applies the window to the views of an asynchronous stream and prepares its body, the deltas are delivered to the operation.
+		/// </summary>
+		DeltaStream PrepareStreamAsync(std::shared_ptr<StreamOperation> operation) const;
+		/// <summary>
+		/// (internal) The completion request shared by all the public entry points: applies the window, writes the body and sends it.
+		/// </summary>
+		std::string Complete(std::span<const MessageView> messages, Usage* usage, std::optional<size_t> known_tokens = {}, std::optional<int> max_tokens = {}, const DeltaCallback* on_delta = nullptr) const;
+		/// <summary>
+		/// (internal) Complete, with the messages kept already selected.
+		/// </summary>
+		std::string Complete(std::span<const MessageView> messages, const WindowSelection& window, Usage* usage, std::optional<int> max_tokens = {}, const DeltaCallback* on_delta = nullptr) const;
+		/// <summary>
+		/// (internal) Counts the tokens of a message with the tokenizer, or estimates them without one.
+		/// </summary>
+		size_t CountMessageTokens(const Message& message) const;
+		size_t CountMessageTokens(const MessageView& message) const;
+		/// <summary>
+		/// (internal) Recomputes the token total of the whole history, in parallel when it's large.
+		/// </summary>
+		void RecountHistory();
+		/// <summary>
+		/// (internal) Returns an empty history, in a new arena if SetHistoryArena was used.
+		/// </summary>
+		Conversation NewHistory() const;
+		/// <summary>
+		/// (internal) Called after a message was added to the history, applies a finished summary and starts a new one if a trigger is reached.
+		/// </summary>
+		void OnHistoryAppended();
+		/// <summary>
+		/// (internal) Replaces the summarized messages by the summary if the background request is done.
+		/// </summary>
+		void ApplyCompaction();
+		/// <summary>
+		/// (internal) Starts summarizing the older turns in the background if the history exceeds a trigger.
+		/// </summary>
+		void StartCompaction();
+
+		std::string APIKey;
+		/// <summary>
+		/// (internal) Built for APIKey and the custom headers, and replaced when they change. The requests keep a reference to it while they're sent.
+		/// </summary>
+		std::shared_ptr<const RequestHeaders> Headers;
+		/// <summary>
+		/// (internal) Interned, so that all the instances with the same system prompt share a single copy (and its JSON escaping).
+		/// </summary>
+		std::shared_ptr<const SharedText> SystemPrompt;
+		Conversation History;
 		Model SelectedModel;
+		Usage LastUsage;
+		std::shared_ptr<const Tokenizer> TokenCounter;
+		size_t HistoryTokens = 0;
+		std::optional<size_t> HistoryArenaBytes;
 
 		std::optional<int> MaxTokens;
 		std::optional<double> Temperature;
 		std::optional<double> TopP;
+		std::optional<ContextWindow> Window;
+		std::optional<CompactionPolicy> Compaction;
+		CompactionHandle PendingCompaction;
+		std::optional<size_t> SummaryPosition;
+		CompactionStats CompactionMetrics;
+		/// <summary>
+		/// (internal) Shared by the copies of the instance, it's thread-safe.
+		/// </summary>
+		std::shared_ptr<ConnectionPool> Connections = std::make_shared<ConnectionPool>();
+		std::shared_ptr<Reactor> AsyncReactor;
+		std::shared_ptr<RequestScheduler> Scheduler;
+		RequestPriority Priority = RequestPriority::Normal;
+		std::string Tenant;
+		std::string Tag;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string_view>
+#include "DeepSeekMessage.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Represents the allocations made by a MessageArena.
+	/// </summary>
+	class ArenaStats {
+	public:
+		/// <summary>
+		/// The number of allocations served by the arena (message contents, chunks, message arrays).
+		/// </summary>
+		size_t Allocations = 0;
+		/// <summary>
+		/// The bytes requested by those allocations.
+		/// </summary>
+		size_t AllocatedBytes = 0;
+		/// <summary>
+		/// The number of blocks the arena got from the heap, usually a handful however many messages the conversation has.
+		/// </summary>
+		size_t HeapAllocations = 0;
+		/// <summary>
+		/// The bytes of those blocks.
+		/// </summary>
+		size_t HeapBytes = 0;
+	};
+
+	/// <summary>
+	/// A monotonic memory arena (std::pmr) holding the messages of a conversation, see Conversation and API::SetHistoryArena.
+	/// <para>Messages are stored in a few large blocks instead of one heap allocation per string, and everything is freed in one shot
+	/// when the last conversation or message using the arena is destroyed. Memory is never reused before that, so it suits histories that are reset rather than edited.</para>
+	/// <para>All methods are thread-safe, so forks of a conversation can be used on different threads.</para>
+	/// </summary>
+	class MessageArena : public std::enable_shared_from_this<MessageArena> {
+	public:
+		/// <summary>
+		/// Creates an arena.
+		/// </summary>
+		/// <param name="initial_bytes">The size of the first block, the next ones grow geometrically.</param>
+		/// <returns></returns>
+		static std::shared_ptr<MessageArena> Create(size_t initial_bytes = 64 * 1024);
+
+		MessageArena(const MessageArena&) = delete;
+		MessageArena& operator=(const MessageArena&) = delete;
+
+		/// <summary>
+		/// Creates a message whose content is copied into the arena, which the message keeps alive. Contents larger than MaxAdoptedBytes get their own allocation instead.
+		/// </summary>
+		Message MakeMessage(Message::Role role, std::string_view content);
+
+		/// <summary>
+		/// Moves the content of a message into the arena, unless it's shared, external or larger than MaxAdoptedBytes. The memoized token count is kept.
+		/// </summary>
+		Message Adopt(Message&& message);
+		/// <summary>
+		/// Copies the content of a message into the arena, with the same exceptions as the moving version (those are copied as they are).
+		/// </summary>
+		Message Adopt(const Message& message);
+
+		/// <summary>
+		/// Larger contents stay out of the arena, in their own allocation: adopting them by move is free, and they don't pin arena memory until the last user is gone.
+		/// </summary>
+		static constexpr size_t MaxAdoptedBytes = 64 * 1024;
+
+		/// <summary>
+		/// Returns the memory resource of the arena, for std::pmr containers.
+		/// </summary>
+		std::pmr::memory_resource* GetResource() { return &Front; }
+
+		/// <summary>
+		/// Returns the allocations made so far.
+		/// </summary>
+		ArenaStats GetStats() const;
+	private:
+		/// <summary>
+		/// (internal) Counts the allocations going through it, optionally behind a mutex.
+		/// </summary>
+		class CountingResource : public std::pmr::memory_resource {
+		public:
+			CountingResource(std::pmr::memory_resource* upstream, std::mutex* mutex)
+				: Upstream(upstream), Mutex(mutex) {}
+
+			size_t Allocations = 0;
+			size_t Bytes = 0;
+		private:
+			void* do_allocate(size_t bytes, size_t alignment) override;
+			void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+			bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+			std::pmr::memory_resource* Upstream;
+			std::mutex* Mutex;
+		};
+
+		explicit MessageArena(size_t initial_bytes);
+
+		mutable std::mutex Mutex;
+		// Heap <- HeapCounter <- Monotonic <- Front, only Front locks (the others are only reached through it)
+		CountingResource HeapCounter;
+		std::pmr::monotonic_buffer_resource Monotonic;
+		CountingResource Front;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include "DeepSeekMessage.h"
+#include "DeepSeekConversation.h"
+#include "DeepSeekReactor.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// (internal) A request sent through a reactor, resuming the coroutine awaiting it once it's done.
+	/// </summary>
+	class AsyncOperation : public Transfer {
+	public:
+		using Transfer::Transfer;
+
+		/// <summary>
+		/// Submits the request to the reactor, the coroutine is resumed on the reactor thread once it's done.
+		/// </summary>
+		void Start(std::shared_ptr<ReactorCore> reactor, std::coroutine_handle<> awaiting);
+
+		/// <summary>
+		/// Cancels the request if it's in flight and forgets the coroutine, called when the awaitable is destroyed without being resumed.
+		/// </summary>
+		void Abandon();
+
+		/// <summary>
+		/// Rethrows the error the request failed with, if any.
+		/// </summary>
+		void RethrowError() const;
+	protected:
+		/// <summary>
+		/// Decodes the response of the request, on the reactor thread. The exception it throws is handed to the coroutine.
+		/// </summary>
+		virtual void Finish(int result) = 0;
+	private:
+		void OnDone(int result) noexcept override;
+
+		ReactorCore* Driver = nullptr;
+		std::mutex Mutex;
+		std::coroutine_handle<> Awaiting;
+		std::exception_ptr Failure;
+		bool Started = false;
+		bool Done = false;
+	};
+
+	/// <summary>
+	/// (internal) The state of an asynchronous completion request.
+	/// </summary>
+	class CompletionOperation : public AsyncOperation {
+	public:
+		using AsyncOperation::AsyncOperation;
+
+		/// <summary>
+		/// The messages of the request when it owns them, Views views them.
+		/// </summary>
+		Conversation Messages;
+		std::vector<MessageView> Views;
+		Usage* UsageOutput = nullptr;
+		size_t TrimmedTokens = 0;
+		std::string Content;
+
+		std::string TakeResult();
+	protected:
+		void Finish(int result) override;
+	};
+
+	/// <summary>
+	/// (internal) The state of an asynchronous balance request.
+	/// </summary>
+	class BalanceOperation : public AsyncOperation {
+	public:
+		using AsyncOperation::AsyncOperation;
+
+		Balance Result;
+
+		Balance TakeResult();
+	protected:
+		void Finish(int result) override;
+	};
+
+	/// <summary>
+	/// Awaits an asynchronous request, see API::GetCompletionAsync and API::GetBalanceAsync.
+	/// <para>The request is sent when it's co_awaited, and the coroutine is resumed on the thread of the reactor once the response arrived.
+	/// co_await returns the result, or throws the exception the blocking version would have thrown.</para>
+	/// <para>Destroying the awaiting coroutine while it's suspended cancels the request.</para>
+	/// </summary>
+	template <class Operation>
+	class RequestAwaitable {
+	public:
+		/// <summary>
+		/// (internal) Wraps a prepared operation.
+		/// </summary>
+		RequestAwaitable(std::shared_ptr<Operation> operation, std::shared_ptr<ReactorCore> reactor)
+			: Pending(std::move(operation)), Driver(std::move(reactor)) {}
+		RequestAwaitable(RequestAwaitable&&) noexcept = default;
+		RequestAwaitable& operator=(RequestAwaitable&&) noexcept = default;
+		~RequestAwaitable() {
+			if (Pending) {
+				Pending->Abandon();
+			}
+		}
+
+		bool await_ready() const noexcept { return false; }
+		void await_suspend(std::coroutine_handle<> awaiting) { Pending->Start(Driver, awaiting); }
+		auto await_resume() { return Pending->TakeResult(); }
+	private:
+		std::shared_ptr<Operation> Pending;
+		std::shared_ptr<ReactorCore> Driver;
+	};
+
+	/// <summary>
+	/// Awaits an asynchronous completion request, co_await returns the AI's response.
+	/// </summary>
+	using CompletionAwaitable = RequestAwaitable<CompletionOperation>;
+
+	/// <summary>
+	/// Awaits an asynchronous balance request, co_await returns the balance.
+	/// </summary>
+	using BalanceAwaitable = RequestAwaitable<BalanceOperation>;
+
+	/// <summary>
+	/// (internal) The state of an asynchronous streamed completion: the deltas received and not handed out yet.
+	/// </summary>
+	class StreamOperation : public Transfer {
+	public:
+		using Transfer::Transfer;
+
+		Conversation Messages;
+		std::vector<MessageView> Views;
+		size_t TrimmedTokens = 0;
+
+		/// <summary>
+		/// Called with every delta on the reactor thread, wakes the consumer up.
+		/// </summary>
+		void Deliver(std::string_view delta);
+
+		/// <summary>
+		/// Submits the request if it's not started yet, and decides whether the consumer waits: returns false if a delta or the end is already there.
+		/// </summary>
+		bool Wait(const std::shared_ptr<ReactorCore>& reactor, std::coroutine_handle<> consumer);
+
+		/// <summary>
+		/// Swaps the deltas received since the last call into delta, returns false once the stream ended (or rethrows its error).
+		/// </summary>
+		bool Take(std::string& delta);
+
+		/// <summary>
+		/// Cancels the request if it's in flight, called when the stream is destroyed before its end.
+		/// </summary>
+		void Abandon();
+
+		std::string Content;
+		Usage FinalUsage;
+	private:
+		void OnDone(int result) noexcept override;
+
+		ReactorCore* Driver = nullptr;
+		std::mutex Mutex;
+		std::string Buffered;
+		std::coroutine_handle<> Consumer;
+		std::exception_ptr Failure;
+		bool Started = false;
+		bool Ended = false;
+	};
+
+	/// <summary>
+	/// An asynchronous generator of the pieces of a streamed completion, see API::StreamCompletionAsync.
+	/// <para>Consume it with: while (auto delta = co_await stream.Next()) { ... }</para>
+	/// <para>The request is sent by the first Next. The deltas received while the consumer is busy are joined, so a delta may hold several pieces of the answer (always whole UTF-8 code points).
+	/// The coroutine is resumed on the thread of the reactor.</para>
+	/// <para>Destroying the stream before its end cancels the request.</para>
+	/// </summary>
+	class DeltaStream {
+	public:
+		/// <summary>
+		/// Awaits the next delta: co_await returns it, or nullopt once the stream ended. It throws the exception the blocking StreamCompletion would have thrown.
+		/// <para>The returned view is valid until the next call to Next.</para>
+		/// </summary>
+		class NextAwaitable {
+		public:
+			bool await_ready() const noexcept { return false; }
+			bool await_suspend(std::coroutine_handle<> consumer) { return Stream.Pending->Wait(Stream.Driver, consumer); }
+			std::optional<std::string_view> await_resume();
+		private:
+			friend class DeltaStream;
+			explicit NextAwaitable(DeltaStream& stream) : Stream(stream) {}
+
+			DeltaStream& Stream;
+		};
+
+		/// <summary>
+		/// (internal) Wraps a prepared operation.
+		/// </summary>
+		DeltaStream(std::shared_ptr<StreamOperation> operation, std::shared_ptr<ReactorCore> reactor)
+			: Pending(std::move(operation)), Driver(std::move(reactor)) {}
+		DeltaStream(DeltaStream&&) noexcept = default;
+		DeltaStream& operator=(DeltaStream&&) noexcept = default;
+		~DeltaStream();
+
+		/// <summary>
+		/// Awaits the next delta.
+		/// </summary>
+		NextAwaitable Next() { return NextAwaitable(*this); }
+
+		/// <summary>
+		/// Returns the whole response, once Next returned nullopt.
+		/// </summary>
+		const std::string& GetContent() const { return Pending->Content; }
+
+		/// <summary>
+		/// Returns the token usage reported for the request, once Next returned nullopt.
+		/// </summary>
+		const Usage& GetUsage() const { return Pending->FinalUsage; }
+	private:
+		std::shared_ptr<StreamOperation> Pending;
+		std::shared_ptr<ReactorCore> Driver;
+		/// <summary>
+		/// (internal) The delta handed out by the last Next, its buffer is swapped with the one receiving the deltas so both keep their capacity.
+		/// </summary>
+		std::string Current;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <unordered_map>
+#include "DeepSeekAPI.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// The outcome of a single request in a Batch.
+	/// </summary>
+	class BatchResult {
+	public:
+		/// <summary>
+		/// The AI's response, empty if the request failed.
+		/// </summary>
+		std::string Response;
+		/// <summary>
+		/// The token usage reported for the request.
+		/// </summary>
+		Usage TokenUsage;
+		/// <summary>
+		/// The error message if the request failed.
+		/// </summary>
+		std::optional<std::string> Error;
+		/// <summary>
+		/// Whether the request was sent as a leader, warming the provider cache for other requests sharing its prefix.
+		/// </summary>
+		bool IsLeader = false;
+	};
+
+	/// <summary>
+	/// Summarizes a Batch run, with a focus on the provider-side prefix cache.
+	/// </summary>
+	class BatchReport {
+	public:
+		/// <summary>
+		/// The number of requests in the batch.
+		/// </summary>
+		size_t Requests = 0;
+		/// <summary>
+		/// The number of requests that were sent as leaders.
+		/// </summary>
+		size_t Leaders = 0;
+		/// <summary>
+		/// The number of requests that failed.
+		/// </summary>
+		size_t Failed = 0;
+		/// <summary>
+		/// The total prompt tokens that were served from the provider cache.
+		/// </summary>
+		long long CacheHitTokens = 0;
+		/// <summary>
+		/// The total prompt tokens that missed the provider cache.
+		/// </summary>
+		long long CacheMissTokens = 0;
+		/// <summary>
+		/// The estimated cache hit tokens if the requests had been sent in their original order with the same concurrency.
+		/// <para>Estimated from the shared prefix lengths and the observed tokens per byte of the batch.</para>
+		/// </summary>
+		long long EstimatedNaiveCacheHitTokens = 0;
+		/// <summary>
+		/// CacheHitTokens - EstimatedNaiveCacheHitTokens.
+		/// </summary>
+		long long CacheHitTokensGained = 0;
+	};
+
+	/// <summary>
+	/// Sends many independent completion requests, ordered to maximize hits on DeepSeek's prefix cache.
+	/// <para>The requests are inserted in a prefix trie over their serialized messages.</para>
+	/// <para>For every large shared prefix, one "leader" request is sent first, and the requests sharing the prefix are only released once it completes.</para>
+	/// </summary>
+	class Batch {
+	public:
+		/// <summary>
+		/// Creates an empty batch.
+		/// </summary>
+		/// <param name="api">The API instance used for the requests, its settings (model, max tokens...) apply to every request. Its message history is not used.</param>
+		/// <param name="max_concurrency">The maximum number of requests in flight at the same time.</param>
+		Batch(const API& api, size_t max_concurrency = 8);
+
+		/// <summary>
+		/// Queues a request.
+		/// </summary>
+		/// <param name="messages">The full conversation to send, the first message should be a system prompt message.</param>
+		/// <param name="tag">The kind of request, see API::SetTag. If the scheduler of the API instance sends the shortest requests first, the batch sends its ready requests in that order too.</param>
+		/// <returns>The index of the request, used to look up its result.</returns>
+		size_t Add(std::vector<Message> messages, std::string tag = {});
+
+		/// <summary>
+		/// Sets the minimum size (in bytes of serialized messages) a shared prefix must have to get its own leader.
+		/// <para>Shorter prefixes are not worth serializing the batch for. The default is 4096.</para>
+		/// </summary>
+		void SetMinSharedPrefixBytes(size_t bytes) { MinSharedPrefixBytes = bytes; }
+
+		/// <summary>
+		/// Sets the class of the requests for the scheduler of the API instance (see API::SetScheduler), so they don't hold up its interactive requests.
+		/// <para>The default is RequestPriority::Batch.</para>
+		/// </summary>
+		void SetPriority(RequestPriority priority) { Priority = priority; }
+
+		/// <summary>
+		/// Sends all queued requests and blocks until every one of them completed.
+		/// <para>A failed request doesn't stop the batch, the requests waiting on it are released anyway.</para>
+		/// </summary>
+		/// <returns>The cache report of the run.</returns>
+		BatchReport Run();
+
+		/// <summary>
+		/// Returns the results of the last run, in the order the requests were added.
+		/// </summary>
+		/// <returns></returns>
+		const std::vector<BatchResult>& GetResults() const { return Results; }
+	private:
+		/// <summary>
+		/// (internal) Identifies a message in the trie, viewing the content of the queued request.
+		/// </summary>
+		struct MessageKey {
+			Message::Role Role;
+			std::string_view Content;
+			bool operator==(const MessageKey& other) const { return Role == other.Role && Content == other.Content; }
+		};
+		struct MessageKeyHash {
+			size_t operator()(const MessageKey& key) const { return std::hash<std::string_view>{}(key.Content) ^ static_cast<size_t>(key.Role); }
+		};
+
+		struct TrieNode {
+			std::unordered_map<MessageKey, size_t, MessageKeyHash> Children;
+			size_t Count = 0;
+			size_t Bytes = 0;
+			size_t Depth = 0;
+			size_t FirstRequest = 0;
+			size_t Leader = 0;
+			bool IsGroup = false;
+		};
+
+		/// <summary>
+		/// (internal) Inserts the requests in the prefix trie and records the path of every request.
+		/// </summary>
+		void BuildTrie();
+		/// <summary>
+		/// (internal) Marks the nodes that get a leader and picks the leaders.
+		/// </summary>
+		void AssignLeaders(size_t node, std::optional<size_t> current_leader);
+		/// <summary>
+		/// (internal) Returns whether the request goes through the trie node.
+		/// </summary>
+		bool PassesThrough(size_t request, size_t node) const;
+
+		const API& Client;
+		size_t MaxConcurrency;
+		size_t MinSharedPrefixBytes = 4096;
+		RequestPriority Priority = RequestPriority::Batch;
+
+		std::vector<std::vector<Message>> Requests;
+		std::vector<std::string> Tags;
+		std::vector<BatchResult> Results;
+
+		std::vector<TrieNode> Trie;
+		std::vector<std::vector<size_t>> Paths;
+		std::vector<size_t> RequestBytes;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <optional>
+#include "DeepSeekMessage.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Represents when and how the message history is compacted, see API::SetCompactionPolicy.
+	/// <para>Once the history exceeds a trigger, the older turns are summarized in the background by a request with the model of the instance,
+	/// then replaced by a single summary message. The conversation never waits for it.</para>
+	/// </summary>
+	class CompactionPolicy {
+	public:
+		/// <summary>
+		/// Compacts once the history costs more than this many prompt tokens (see API::GetHistoryTokenCount). 0 disables this trigger.
+		/// </summary>
+		size_t TriggerTokens = 32768;
+		/// <summary>
+		/// Compacts once the history has more than this many messages. 0 disables this trigger.
+		/// </summary>
+		size_t TriggerMessages = 0;
+		/// <summary>
+		/// The number of most recent turns that are never summarized, a turn starts with a user message.
+		/// </summary>
+		size_t KeepLastTurns = 4;
+		/// <summary>
+		/// The system prompt of the summarization request, the transcript of the older turns is sent as the user message.
+		/// </summary>
+		std::string SummaryPrompt = "Summarize the following conversation between a user and an assistant. "
+			"Keep every fact, decision, name, number and open question needed to continue the conversation. Be concise.";
+		/// <summary>
+		/// The text put in front of the summary in the message replacing the older turns.
+		/// </summary>
+		std::string SummaryHeader = "Summary of the earlier conversation:\n";
+		/// <summary>
+		/// The role of the message replacing the older turns.
+		/// </summary>
+		Message::Role SummaryRole = Message::Role::System;
+		/// <summary>
+		/// Optional: The maximum amount of tokens for the summary.
+		/// </summary>
+		std::optional<int> SummaryMaxTokens = 1024;
+		/// <summary>
+		/// The tag of the summarization requests for the scheduler (see RequestOptions::Tag), so their completions are predicted apart from those of the conversation.
+		/// </summary>
+		std::string SummaryTag = "summary";
+	};
+
+	/// <summary>
+	/// Represents the totals of the compactions of an API instance, see API::GetCompactionStats.
+	/// </summary>
+	class CompactionStats {
+	public:
+		/// <summary>
+		/// The number of compactions applied to the history.
+		/// </summary>
+		size_t Compactions = 0;
+		/// <summary>
+		/// The number of summarization requests that failed, the history is left as is and compacted at the next trigger.
+		/// </summary>
+		size_t FailedCompactions = 0;
+		/// <summary>
+		/// The number of messages replaced by summaries.
+		/// </summary>
+		size_t MessagesCompacted = 0;
+		/// <summary>
+		/// The prompt tokens removed from the history: the tokens of the replaced messages minus the tokens of the summaries.
+		/// <para>Every following request saves this many prompt tokens.</para>
+		/// </summary>
+		long long TokensSaved = 0;
+		/// <summary>
+		/// The tokens spent on the summarization requests (prompt + completion).
+		/// </summary>
+		long long SummaryTokens = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cstddef>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Represents the activity of the connections of an API instance, see API::GetTransportStats.
+	/// </summary>
+	class TransportStats {
+	public:
+		/// <summary>
+		/// The number of requests sent.
+		/// </summary>
+		size_t Requests = 0;
+		/// <summary>
+		/// The number of connections (curl handles) created. Idle connections are reused, so this stays at the number of concurrent requests.
+		/// </summary>
+		size_t Connections = 0;
+		/// <summary>
+		/// The number of times a response buffer was allocated or grown. It stops increasing once the buffers fit the responses.
+		/// </summary>
+		size_t BufferAllocations = 0;
+		/// <summary>
+		/// The number of times an idle buffer was freed to keep RetainedBufferBytes under the limit (or by API::TrimConnections).
+		/// </summary>
+		size_t BufferTrims = 0;
+		/// <summary>
+		/// The bytes currently held by the buffers of the idle connections.
+		/// </summary>
+		size_t RetainedBufferBytes = 0;
+	};
+
+	/// <summary>
+	/// (internal) A curl handle and its response buffer, both reused from one request to the next.
+	/// <para>The handle keeps its connection to the server alive, and the buffer keeps its capacity: once it fits the responses, receiving one allocates nothing.</para>
+	/// </summary>
+	class Connection {
+	public:
+		Connection();
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+		~Connection();
+
+		/// <summary>
+		/// Returns the curl easy handle (a CURL*).
+		/// </summary>
+		void* GetHandle() const { return Handle; }
+
+		/// <summary>
+		/// The response buffer, empty at the start of every request.
+		/// </summary>
+		std::string Response;
+
+		/// <summary>
+		/// Appends received bytes to the response buffer. The first bytes reserve the whole response if the server sent its Content-Length, up to MaxReservedBytes.
+		/// </summary>
+		void Receive(const char* data, size_t size);
+
+		/// <summary>
+		/// The most bytes reserved from the Content-Length before they arrive, so a wrong header can't make a huge allocation. Larger responses grow geometrically.
+		/// </summary>
+		static constexpr size_t MaxReservedBytes = 1024 * 1024;
+	private:
+		friend class ConnectionPool;
+
+		/// <summary>
+		/// (internal) Resizes the buffer capacity, counting the allocation.
+		/// </summary>
+		void Reserve(size_t bytes);
+
+		void* Handle = nullptr;
+		/// <summary>
+		/// (internal) The buffer allocations since the connection was last released to its pool.
+		/// </summary>
+		size_t Allocations = 0;
+	};
+
+	/// <summary>
+	/// (internal) The idle connections of an API instance. Requests borrow one (or create one if none is idle) and give it back when they're done.
+	/// <para>The buffers of the idle connections are shrunk only under memory pressure: when together they hold more than MaxRetainedBytes.</para>
+	/// <para>All methods are thread-safe.</para>
+	/// </summary>
+	class ConnectionPool {
+	public:
+		/// <summary>
+		/// Gives a borrowed connection back to its pool when destroyed.
+		/// </summary>
+		class Lease {
+		public:
+			Lease(ConnectionPool& pool, std::unique_ptr<Connection> connection)
+				: Pool(pool), Borrowed(std::move(connection)) {}
+			Lease(const Lease&) = delete;
+			Lease& operator=(const Lease&) = delete;
+			~Lease() { Pool.Release(std::move(Borrowed)); }
+
+			Connection& operator*() const { return *Borrowed; }
+			Connection* operator->() const { return Borrowed.get(); }
+		private:
+			ConnectionPool& Pool;
+			std::unique_ptr<Connection> Borrowed;
+		};
+
+		/// <summary>
+		/// Borrows an idle connection, or creates one, with its options reset and an empty response buffer.
+		/// </summary>
+		Lease Acquire();
+
+		/// <summary>
+		/// Frees the buffers of the idle connections, keeping the connections themselves.
+		/// </summary>
+		void Trim();
+
+		/// <summary>
+		/// Returns the activity of the connections so far.
+		/// </summary>
+		TransportStats GetStats() const;
+
+		/// <summary>
+		/// The most bytes the buffers of the idle connections hold before being shrunk, the largest ones first.
+		/// </summary>
+		static constexpr size_t MaxRetainedBytes = 4 * 1024 * 1024;
+		/// <summary>
+		/// The most idle connections kept, the extra ones are closed when they're released.
+		/// </summary>
+		static constexpr size_t MaxIdleConnections = 16;
+	private:
+		/// <summary>
+		/// (internal) Takes a connection back, called by Lease.
+		/// </summary>
+		void Release(std::unique_ptr<Connection> connection);
+
+		mutable std::mutex Mutex;
+		std::vector<std::unique_ptr<Connection>> Idle;
+		TransportStats Stats;
+	};
+}
\ No newline at end of file
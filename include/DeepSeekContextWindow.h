@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Represents how the messages are dropped when a request doesn't fit in the context window.
+	/// <para>The leading system messages (the system prompt) are always kept, as well as the last message.</para>
+	/// <para>A turn starts with a user message and includes the assistant messages following it.</para>
+	/// </summary>
+	enum class TruncationStrategy {
+		/// <summary>
+		/// Drops whole turns, starting with the oldest one, until the request fits.
+		/// </summary>
+		DropOldest,
+		/// <summary>
+		/// Keeps the first KeepFirstTurns and the last KeepLastTurns turns, and drops the oldest turns between them until the request fits.
+		/// <para>Useful when the first turns set up the task (instructions, a document).</para>
+		/// </summary>
+		KeepFirstAndLast,
+		/// <summary>
+		/// Keeps as many of the most recent messages as fit, without keeping turns together.
+		/// </summary>
+		SlidingWindow
+	};
+
+	/// <summary>
+	/// Represents a token budget for the prompt of completion requests, see API::SetContextWindow.
+	/// <para>The window is applied while building the request, the message history itself is never modified.</para>
+	/// </summary>
+	class ContextWindow {
+	public:
+		/// <summary>
+		/// The maximum number of prompt tokens sent, including the chat template.
+		/// <para>Leave some room below the context length of the model for the completion. 0 disables the limit.</para>
+		/// </summary>
+		size_t MaxPromptTokens = 0;
+		/// <summary>
+		/// How the messages are dropped when the prompt exceeds MaxPromptTokens.
+		/// </summary>
+		TruncationStrategy Strategy = TruncationStrategy::DropOldest;
+		/// <summary>
+		/// The number of turns kept at the start of the conversation (only used by KeepFirstAndLast).
+		/// </summary>
+		size_t KeepFirstTurns = 1;
+		/// <summary>
+		/// The number of turns kept at the end of the conversation (only used by KeepFirstAndLast), the last turn is always kept.
+		/// </summary>
+		size_t KeepLastTurns = 1;
+	};
+}
\ No newline at end of file
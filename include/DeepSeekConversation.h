@@ -0,0 +1,195 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <cstddef>
+#include <memory_resource>
+#include "DeepSeekMessage.h"
+#include "DeepSeekArena.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// A message history that can be forked in O(1).
+	/// <para>The messages are stored in chunks shared between the copies of a conversation. Copying a conversation only copies a pointer,
+	/// and a copy only allocates for the messages it adds itself, the common prefix stays shared.</para>
+	/// <para>It behaves like a value: adding messages to a copy never changes the other copies, so "regenerate" or "try alternative" features can simply copy the history.</para>
+	/// <para>Different copies can be used on different threads, a single conversation can't be modified concurrently (like std::vector).</para>
+	/// <para>A conversation can keep its messages in a MessageArena: the chunks and the message contents are then allocated from it instead of the heap.</para>
+	/// </summary>
+	class Conversation {
+	private:
+		struct Chunk {
+			explicit Chunk(std::pmr::memory_resource* resource)
+				: Messages(resource) {}
+
+			/// <summary>
+			/// The chunk holding the messages before Base, shared with the other branches.
+			/// </summary>
+			std::shared_ptr<Chunk> Parent;
+			/// <summary>
+			/// The index of the first message of the chunk in the conversation.
+			/// </summary>
+			size_t Base = 0;
+			/// <summary>
+			/// The number of chunks from the root to this one, included.
+			/// </summary>
+			size_t Depth = 1;
+			std::pmr::vector<Message> Messages;
+		};
+	public:
+		/// <summary>
+		/// Iterates over the messages, oldest first.
+		/// <para>Like with std::vector, adding messages invalidates the iterators.</para>
+		/// </summary>
+		class const_iterator {
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = Message;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const Message*;
+			using reference = const Message&;
+
+			const_iterator() = default;
+
+			reference operator*() const { return (*Spine)[ChunkIndex]->Messages[Offset]; }
+			pointer operator->() const { return &**this; }
+			const_iterator& operator++();
+			const_iterator operator++(int) { const_iterator previous = *this; ++*this; return previous; }
+			bool operator==(const const_iterator& other) const { return Index == other.Index; }
+			bool operator!=(const const_iterator& other) const { return Index != other.Index; }
+		private:
+			friend class Conversation;
+
+			/// <summary>
+			/// (internal) The chunks from the root to the tail.
+			/// </summary>
+			std::shared_ptr<const std::vector<const Chunk*>> Spine;
+			size_t ChunkIndex = 0;
+			size_t Offset = 0;
+			size_t Index = 0;
+			size_t End = 0;
+		};
+		using iterator = const_iterator;
+		using value_type = Message;
+		using size_type = size_t;
+
+		/// <summary>
+		/// Creates an empty conversation.
+		/// </summary>
+		Conversation() = default;
+
+		/// <summary>
+		/// Creates a conversation holding copies of the messages.
+		/// </summary>
+		/// <param name="messages">The messages</param>
+		explicit Conversation(const std::vector<Message>& messages);
+
+		/// <summary>
+		/// Creates a conversation taking over the messages.
+		/// </summary>
+		/// <param name="messages">The messages</param>
+		explicit Conversation(std::vector<Message>&& messages);
+
+		/// <summary>
+		/// Creates an empty conversation storing its messages in the arena. Its copies and prefixes share the arena.
+		/// </summary>
+		/// <param name="arena">The arena</param>
+		explicit Conversation(std::shared_ptr<MessageArena> arena);
+
+		Conversation(const Conversation&) = default;
+		Conversation(Conversation&& other) noexcept
+			: Arena(std::move(other.Arena)), Tail(std::move(other.Tail)), Count(std::exchange(other.Count, 0)) {}
+		Conversation& operator=(const Conversation& other);
+		Conversation& operator=(Conversation&& other) noexcept;
+
+		/// <summary>
+		/// Returns the number of messages.
+		/// </summary>
+		size_t size() const { return Count; }
+
+		/// <summary>
+		/// Returns whether the conversation has no messages.
+		/// </summary>
+		bool empty() const { return Count == 0; }
+
+		/// <summary>
+		/// Returns the message at the index.
+		/// <para>This walks the chunks from the newest one, so it's O(1) for the recent messages and O(chunks) at worst. Prefer iterating for whole passes.</para>
+		/// </summary>
+		const Message& operator[](size_t index) const;
+
+		/// <summary>
+		/// Returns the newest message, the conversation must not be empty.
+		/// </summary>
+		const Message& back() const { return Tail->Messages[Count - Tail->Base - 1]; }
+
+		const_iterator begin() const;
+		const_iterator end() const;
+
+		/// <summary>
+		/// Adds a message at the end.
+		/// <para>The message is stored in place if this conversation is the only one using its newest chunk, otherwise a new chunk is started.</para>
+		/// <para>With an arena, a message owning its content has the content moved into the arena.</para>
+		/// </summary>
+		/// <param name="message">The message</param>
+		void push_back(Message message);
+
+		/// <summary>
+		/// Constructs a message at the end, see push_back.
+		/// </summary>
+		template <class... Args>
+		const Message& emplace_back(Args&&... args) {
+			push_back(Message(std::forward<Args>(args)...));
+			return back();
+		}
+
+		/// <summary>
+		/// Removes all messages (the chunks stay alive as long as other copies use them).
+		/// </summary>
+		void clear();
+
+		/// <summary>
+		/// Returns a conversation made of the first messages of this one, sharing their storage.
+		/// <para>This is how to fork from an earlier point, for example to regenerate the last answer: Prefix(size() - 1).</para>
+		/// </summary>
+		/// <param name="count">The number of messages to keep</param>
+		/// <returns></returns>
+		Conversation Prefix(size_t count) const;
+
+		/// <summary>
+		/// Copies the messages into a vector.
+		/// </summary>
+		std::vector<Message> ToVector() const;
+
+		/// <summary>
+		/// Returns the number of chunks the messages are spread over, mostly useful to measure the sharing between branches.
+		/// </summary>
+		size_t GetChunkCount() const { return Tail ? Tail->Depth : 0; }
+
+		/// <summary>
+		/// Returns the arena of the conversation (for its allocation stats), nullptr if it uses the heap.
+		/// </summary>
+		const std::shared_ptr<MessageArena>& GetArena() const { return Arena; }
+
+		/// <summary>
+		/// (internal) Past this many chunks, adding a message to a shared chunk copies the conversation into a single chunk, to keep the walks short.
+		/// </summary>
+		static constexpr size_t MaxChunks = 64;
+	private:
+		/// <summary>
+		/// (internal) Returns the resource the chunks are allocated from.
+		/// </summary>
+		std::pmr::memory_resource* GetResource() const { return Arena ? Arena->GetResource() : std::pmr::new_delete_resource(); }
+		/// <summary>
+		/// (internal) Allocates an empty chunk.
+		/// </summary>
+		std::shared_ptr<Chunk> MakeChunk() const;
+
+		// The chunks may live in the arena, so it's declared first to be destroyed last
+		std::shared_ptr<MessageArena> Arena;
+		std::shared_ptr<Chunk> Tail;
+		size_t Count = 0;
+	};
+}
\ No newline at end of file
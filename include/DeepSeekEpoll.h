@@ -0,0 +1,79 @@
+#pragma once
+
+#ifdef __linux__
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include "DeepSeekReactor.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// A reference adapter driving a Reactor from an epoll loop, see the Reactor constructor taking EventLoopHooks (Linux only).
+	/// <para>The sockets of the transfers are watched by an epoll instance, with a timerfd for the timer of the reactor and an eventfd for the submissions.
+	/// Either run the loop itself (Run, or Poll from an existing loop), or nest it: watch GetFileDescriptor for EPOLLIN in your own epoll and call Poll(0) when it's readable.</para>
+	/// <para>Poll and Run must be called from a single thread, the coroutines awaiting the requests are resumed there. Stop is thread-safe.</para>
+	/// </summary>
+	class EpollEventLoop {
+	public:
+		/// <summary>
+		/// Creates the epoll instance and its reactor.
+		/// </summary>
+		/// <param name="options">The submission queue of the reactor, see SubmissionOptions</param>
+		explicit EpollEventLoop(SubmissionOptions options = {});
+		EpollEventLoop(const EpollEventLoop&) = delete;
+		EpollEventLoop& operator=(const EpollEventLoop&) = delete;
+
+		/// <summary>
+		/// Stops the reactor (the requests still in flight fail), then closes the descriptors. Called on the loop thread.
+		/// </summary>
+		~EpollEventLoop();
+
+		/// <summary>
+		/// Returns the reactor driven by the loop, to pass to API::SetReactor.
+		/// <para>The loop must outlive its use: once it's destroyed, the requests sent through the reactor throw.</para>
+		/// </summary>
+		const std::shared_ptr<Reactor>& GetReactor() const { return Driver; }
+
+		/// <summary>
+		/// Returns the epoll descriptor, readable when Poll has something to do.
+		/// </summary>
+		int GetFileDescriptor() const { return Epoll; }
+
+		/// <summary>
+		/// Waits up to timeout_ms (-1: without limit, 0: not at all) for events and handles them.
+		/// </summary>
+		/// <returns>The number of events handled</returns>
+		size_t Poll(int timeout_ms);
+
+		/// <summary>
+		/// Handles the events until Stop is called.
+		/// </summary>
+		void Run();
+
+		/// <summary>
+		/// Makes Run return. Thread-safe.
+		/// </summary>
+		void Stop();
+	private:
+		/// <summary>
+		/// (internal) EventLoopHooks::WatchSocket.
+		/// </summary>
+		void WatchSocket(SocketHandle socket, SocketInterest interest);
+		/// <summary>
+		/// (internal) EventLoopHooks::SetTimer.
+		/// </summary>
+		void SetTimer(long timeout_ms);
+
+		int Epoll = -1;
+		int Timer = -1;
+		int Wakeup = -1;
+		/// <summary>
+		/// (internal) The sockets registered in the epoll instance.
+		/// </summary>
+		std::unordered_map<SocketHandle, std::uint32_t> Watched;
+		std::atomic<bool> Stopping = false;
+		std::shared_ptr<Reactor> Driver;
+	};
+}
+#endif
\ No newline at end of file
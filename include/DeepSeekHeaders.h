@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// A header added to every request, see API::SetCustomHeaders.
+	/// </summary>
+	using CustomHeader = std::pair<std::string, std::string>;
+
+	/// <summary>
+	/// (internal) The header lists sent with the requests of an API instance, built once for its key and custom headers.
+	/// <para>It's immutable: changing the key or the custom headers builds a new one, and the requests in flight keep the one they started with.
+	/// So sending a request allocates nothing for its headers, and any number of threads can share the lists.</para>
+	/// </summary>
+	class RequestHeaders {
+	public:
+		/// <summary>
+		/// Builds the header lists.
+		/// <para>Throws std::runtime_error if a custom header has an empty or invalid name, or a line break in its value.</para>
+		/// </summary>
+		/// <param name="api_key">The API key sent as the bearer token</param>
+		/// <param name="custom_headers">The headers added after the ones of the library</param>
+		RequestHeaders(std::string_view api_key, std::vector<CustomHeader> custom_headers);
+		RequestHeaders(const RequestHeaders&) = delete;
+		RequestHeaders& operator=(const RequestHeaders&) = delete;
+		~RequestHeaders();
+
+		/// <summary>
+		/// Returns the headers of the completion requests (a curl_slist*).
+		/// </summary>
+		void* GetCompletionHeaders() const { return Completion; }
+
+		/// <summary>
+		/// Returns the headers of the balance requests (a curl_slist*).
+		/// </summary>
+		void* GetBalanceHeaders() const { return Balance; }
+
+		/// <summary>
+		/// Returns the custom headers the lists were built with.
+		/// </summary>
+		const std::vector<CustomHeader>& GetCustomHeaders() const { return Custom; }
+	private:
+		/// <summary>
+		/// (internal) Appends a header line to a list, throwing if curl can't allocate it.
+		/// </summary>
+		static void* Append(void* list, const std::string& line);
+
+		void* Completion = nullptr;
+		void* Balance = nullptr;
+		std::vector<CustomHeader> Custom;
+	};
+}
\ No newline at end of file
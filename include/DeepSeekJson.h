@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// (internal) Appends the text to the output as a JSON string, quotes included.
+	/// <para>The escaping is the same as nlohmann::json::dump, so the request bodies don't depend on how they were written.</para>
+	/// <para>Throws std::runtime_error if the text isn't valid UTF-8.</para>
+	/// </summary>
+	void AppendJsonString(std::string& output, std::string_view text);
+
+	/// <summary>
+	/// (internal) Appends the text escaped like AppendJsonString, without the quotes.
+	/// <para>A long text can be escaped piece by piece, as long as no piece splits a UTF-8 sequence.</para>
+	/// </summary>
+	void AppendJsonEscaped(std::string& output, std::string_view text);
+
+	/// <summary>
+	/// (internal) Returns the number of bytes AppendJsonString appends for the text, quotes included.
+	/// <para>Used to size request bodies before writing them. Throws std::runtime_error if the text isn't valid UTF-8, so a body that was sized can be written without errors.</para>
+	/// </summary>
+	size_t JsonStringLength(std::string_view text);
+}
\ No newline at end of file
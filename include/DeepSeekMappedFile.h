@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstddef>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// A read-only memory mapping of a whole file, used to attach large local files to messages without reading them into memory first.
+	/// <para>The pages are loaded by the OS on demand while the request body is written, and can be dropped again under memory pressure.</para>
+	/// <para>Open returns a shared pointer so that messages can keep the mapping alive, see API::AddFile.</para>
+	/// </summary>
+	class MappedFile {
+	public:
+		/// <summary>
+		/// Maps the file. Throws std::runtime_error if it can't be opened or mapped.
+		/// </summary>
+		/// <param name="path">The path to the file</param>
+		/// <returns></returns>
+		static std::shared_ptr<const MappedFile> Open(const std::string& path);
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile();
+
+		/// <summary>
+		/// Returns the content of the file.
+		/// </summary>
+		std::string_view View() const { return { Data, Size }; }
+
+		/// <summary>
+		/// Returns the size of the file in bytes.
+		/// </summary>
+		size_t size() const { return Size; }
+	private:
+		MappedFile() = default;
+
+		const char* Data = nullptr;
+		size_t Size = 0;
+#ifdef _WIN32
+		/// <summary>
+		/// (internal) The file mapping object, the view is Data.
+		/// </summary>
+		void* Mapping = nullptr;
+#endif
+	};
+}
\ No newline at end of file
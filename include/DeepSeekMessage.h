@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <nlohmann/json.hpp>
+#include "DeepSeekSharedText.h"
 
 namespace inx::DeepSeek {
 	/// <summary>
@@ -29,15 +34,140 @@ namespace inx::DeepSeek {
 			Assistant
 		};
 		Message(Role role, const std::string& content)
-			: role(role), content(content) {}
+			: role(role), OwnedContent(content) {}
+
+		/// <summary>
+		/// Creates a message taking over the content, without copying it.
+		/// </summary>
+		Message(Role role, std::string&& content)
+			: role(role), OwnedContent(std::move(content)) {}
+
+		/// <summary>
+		/// Creates a message viewing content owned by someone else (a memory-mapped file, a shared buffer...), nothing is copied.
+		/// <para>The owner is kept alive by the message and all its copies. Without an owner, you must keep the content alive as long as the message or any copy of it exists.</para>
+		/// </summary>
+		/// <param name="role">The role</param>
+		/// <param name="content">The content</param>
+		/// <param name="owner">Keeps the content alive, can be nullptr</param>
+		Message(Role role, std::string_view content, std::shared_ptr<const void> owner)
+			: role(role), ExternalContent(content), ContentOwner(std::move(owner)), HasExternalContent(true) {}
+
+		/// <summary>
+		/// Creates a message using shared content instead of its own copy, see SharedText::Intern.
+		/// </summary>
+		Message(Role role, std::shared_ptr<const SharedText> content)
+			: role(role), SharedContent(std::move(content)) {}
+
+		Message(const Message& other)
+			: role(other.role), OwnedContent(other.OwnedContent), SharedContent(other.SharedContent), ExternalContent(other.ExternalContent),
+			ContentOwner(other.ContentOwner), HasExternalContent(other.HasExternalContent), TokenMemo(other.TokenMemo.load(std::memory_order_relaxed)) {}
+		Message(Message&& other) noexcept
+			: role(other.role), OwnedContent(std::move(other.OwnedContent)), SharedContent(std::move(other.SharedContent)), ExternalContent(other.ExternalContent),
+			ContentOwner(std::move(other.ContentOwner)), HasExternalContent(other.HasExternalContent), TokenMemo(other.TokenMemo.load(std::memory_order_relaxed)) {}
+		Message& operator=(const Message& other);
+		Message& operator=(Message&& other) noexcept;
 
 		Role role;
-		std::string content;
+
+		/// <summary>
+		/// Returns the text of the message, wherever it's stored (owned, shared, in an arena or external).
+		/// <para>It replaces the former public content field, which only held the text of the messages owning it. Use SetContent to change it.</para>
+		/// </summary>
+		std::string_view GetContent() const {
+			if (SharedContent) {
+				return SharedContent->View();
+			}
+			return HasExternalContent ? ExternalContent : std::string_view(OwnedContent);
+		}
+
+		/// <summary>
+		/// Returns the shared content of the message, nullptr if the message owns its text.
+		/// </summary>
+		const std::shared_ptr<const SharedText>& GetSharedContent() const { return SharedContent; }
+
+		/// <summary>
+		/// Replaces the content of the message and invalidates its memoized token count.
+		/// </summary>
+		/// <param name="new_content">The new content</param>
+		void SetContent(std::string new_content);
+
+		/// <summary>
+		/// Replaces the content of the message by shared content and invalidates its memoized token count.
+		/// </summary>
+		/// <param name="new_content">The new content</param>
+		void SetContent(std::shared_ptr<const SharedText> new_content);
+
+		/// <summary>
+		/// Forgets the memoized token count, it will be recounted the next time it's needed.
+		/// </summary>
+		void InvalidateTokenCount() const { TokenMemo.store(0, std::memory_order_relaxed); }
 
 		/// <summary>
 		/// (internal) Converts the message to a JSON object for API calls.
 		/// </summary>
 		/// <returns>Example: {"role": "assistant", "content": "Hello! How can I help you?"}</returns>
 		nlohmann::json ToJSON() const;
+	private:
+		friend class Tokenizer;
+		friend class MessageArena;
+
+		/// <summary>
+		/// (internal) The text of the message when it owns it, empty for messages using shared, arena or external content.
+		/// </summary>
+		std::string OwnedContent;
+		std::shared_ptr<const SharedText> SharedContent;
+		/// <summary>
+		/// (internal) Content stored outside of the message (in an arena or by the caller), ContentOwner keeps it alive if set.
+		/// </summary>
+		std::string_view ExternalContent;
+		std::shared_ptr<const void> ContentOwner;
+		bool HasExternalContent = false;
+		/// <summary>
+		/// (internal) The token count memoized by Tokenizer, 0 when unknown. Messages using shared content use the memo of the SharedText instead.
+		/// <para>Bits 32-63 hold the id of the tokenizer, bits 0-31 the count. The content only changes through SetContent, which clears it.</para>
+		/// <para>It's atomic so that several threads can count the same message.</para>
+		/// </summary>
+		mutable std::atomic<std::uint64_t> TokenMemo{ 0 };
 	};
+
+	/// <summary>
+	/// A non-owning view of a message: a role and content owned by someone else.
+	/// <para>Used to send messages without copying them into a history, the viewed text must stay alive until the request returns.</para>
+	/// </summary>
+	class MessageView {
+	public:
+		MessageView(Message::Role role, std::string_view content)
+			: role(role), content(content) {}
+
+		/// <summary>
+		/// Views shared content, its cached JSON escaping is used when the view is sent.
+		/// </summary>
+		MessageView(Message::Role role, const SharedText& content)
+			: role(role), content(content.View()), Shared(&content) {}
+
+		/// <summary>
+		/// Views a message, its memoized token count and its shared content (if any) are used when the view is counted or sent.
+		/// </summary>
+		MessageView(const Message& message)
+			: role(message.role), content(message.GetContent()), Source(&message), Shared(message.GetSharedContent().get()) {}
+
+		Message::Role role;
+		std::string_view content;
+	private:
+		friend class API;
+
+		/// <summary>
+		/// (internal) The viewed message, if the view was made from one.
+		/// </summary>
+		const Message* Source = nullptr;
+		/// <summary>
+		/// (internal) The viewed shared content, if any.
+		/// </summary>
+		const SharedText* Shared = nullptr;
+	};
+
+	/// <summary>
+	/// (internal) Converts a role to its string representation for API calls.
+	/// </summary>
+	std::string RoleToString(Message::Role role);
 }
\ No newline at end of file
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <optional>
+#include <random>
+#include <cstddef>
+#include <cstdint>
+#include "DeepSeekTransfer.h"
+#include "DeepSeekSubmissionQueue.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// A socket of a transfer (a curl_socket_t).
+	/// </summary>
+#ifdef _WIN32
+	using SocketHandle = std::uintptr_t;
+#else
+	using SocketHandle = int;
+#endif
+
+	/// <summary>
+	/// The events a reactor waits for on a socket, see EventLoopHooks.
+	/// </summary>
+	enum class SocketInterest {
+		/// <summary>
+		/// The socket is no longer used by the reactor, stop watching it.
+		/// </summary>
+		None,
+		Read,
+		Write,
+		ReadWrite
+	};
+
+	/// <summary>
+	/// The callbacks through which a reactor lets the event loop of the application drive its requests, see the Reactor constructor taking them.
+	/// <para>They're called from the reactor methods the loop calls (and from Reactor::Stop), they must not call the reactor back.</para>
+	/// </summary>
+	class EventLoopHooks {
+	public:
+		/// <summary>
+		/// Called when the reactor starts, changes or stops (SocketInterest::None) waiting for events on a socket.
+		/// The loop then calls Reactor::OnSocketEvent when the socket is ready.
+		/// </summary>
+		std::function<void(SocketHandle socket, SocketInterest interest)> WatchSocket;
+		/// <summary>
+		/// Called with the delay in milliseconds after which the loop must call Reactor::OnTimeout (0: as soon as possible), or -1 to cancel the timer.
+		/// There's a single timer: every call replaces the previous one.
+		/// </summary>
+		std::function<void(long timeout_ms)> SetTimer;
+		/// <summary>
+		/// Called from any thread when requests were submitted: the loop must then call Reactor::ProcessSubmitted on its thread (for example by writing to an eventfd it watches).
+		/// It's called once for the submissions made until ProcessSubmitted picks them up.
+		/// </summary>
+		std::function<void()> Wakeup;
+	};
+
+	/// <summary>
+	/// (internal) The curl callbacks of a ReactorCore driven by an event loop, defined with the reactor.
+	/// </summary>
+	struct ReactorCallbacks;
+
+	/// <summary>
+	/// (internal) The state of a Reactor: its curl multi handle and its transfers.
+	/// <para>It's shared with the reactor thread, so the thread can finish cleanly even when the Reactor is destroyed by a coroutine it resumed.</para>
+	/// </summary>
+	class ReactorCore {
+	public:
+		/// <summary>
+		/// Creates the state of a reactor run by its own thread (see Run).
+		/// </summary>
+		explicit ReactorCore(SubmissionOptions options = {});
+		/// <summary>
+		/// Creates the state of a reactor driven by an event loop through its socket and timer callbacks.
+		/// </summary>
+		explicit ReactorCore(EventLoopHooks hooks, SubmissionOptions options = {});
+		ReactorCore(const ReactorCore&) = delete;
+		ReactorCore& operator=(const ReactorCore&) = delete;
+		~ReactorCore();
+
+		/// <summary>
+		/// Hands a prepared transfer to the reactor, its OnDone is called on the reactor thread once it's done. Thread-safe and lock-free, unless it blocks on a full queue.
+		/// <para>Throws std::runtime_error if the reactor is stopped, or if the queue is full and the backpressure doesn't wait.</para>
+		/// </summary>
+		void Submit(std::shared_ptr<Transfer> transfer);
+
+		/// <summary>
+		/// Cancels a submitted transfer and has the reactor thread end it at its next wakeup, without waiting for a curl callback: a transfer waiting for its scheduler slot
+		/// (or for its next attempt) leaves the scheduler right away. Thread-safe, it does nothing after the first call.
+		/// </summary>
+		void Cancel(std::shared_ptr<Transfer> transfer);
+
+		/// <summary>
+		/// Resumes the coroutine on the reactor thread, once the current curl call returned. Only called from the reactor thread.
+		/// </summary>
+		void Resume(std::coroutine_handle<> coroutine) { Ready.push_back(coroutine); }
+
+		/// <summary>
+		/// Drives the transfers until Stop is called, then fails the ones left.
+		/// </summary>
+		void Run();
+
+		/// <summary>
+		/// Makes Run return, thread-safe. Driven by an event loop, it fails the transfers left right away instead, on the loop thread.
+		/// </summary>
+		void Stop();
+
+		/// <summary>
+		/// Adds the submitted transfers, on the event loop thread.
+		/// </summary>
+		void ProcessSubmitted();
+
+		/// <summary>
+		/// Hands a socket event (CURL_CSELECT_* flags) to curl, on the event loop thread.
+		/// </summary>
+		void OnSocketEvent(SocketHandle socket, int events);
+
+		/// <summary>
+		/// Runs the timeouts of curl and the timers of the transfers that are due, on the event loop thread.
+		/// </summary>
+		void OnTimeout();
+
+		/// <summary>
+		/// Returns the number of transfers submitted and not done yet. Thread-safe.
+		/// </summary>
+		size_t GetActiveTransfers() const { return ActiveCount; }
+
+		/// <summary>
+		/// Returns the activity of the timers of the transfers. Thread-safe.
+		/// </summary>
+		TimerStats GetTimerStats() const { return Timers.GetStats(); }
+
+		/// <summary>
+		/// Returns the activity of the submission queue. Thread-safe.
+		/// </summary>
+		SubmissionStats GetSubmissionStats() const;
+	private:
+		/// <summary>
+		/// (internal) Asks the reactor thread to pick up the queue, unless a wakeup is already pending.
+		/// </summary>
+		void Wakeup();
+		/// <summary>
+		/// (internal) Hands a transfer dropped from the queue to the reactor thread, which fails it.
+		/// </summary>
+		void PushDropped(std::shared_ptr<Transfer> transfer);
+		/// <summary>
+		/// (internal) Hands a transfer that got the slot it waited for in its scheduler to the reactor thread, which starts it. Called by the scheduler from any thread.
+		/// </summary>
+		void PushGranted(std::shared_ptr<Transfer> transfer);
+		/// <summary>
+		/// (internal) Starts the transfers that got their slot, unless they're done already (or the reactor is stopping).
+		/// </summary>
+		void StartGranted();
+		/// <summary>
+		/// (internal) Ends the transfers cancelled through Cancel that are still active, or just releases them once stopping.
+		/// </summary>
+		void EndCancelled();
+		/// <summary>
+		/// (internal) Adds the submitted transfers to the multi handle (or to the queue of their scheduler), fails the dropped ones and ends the cancelled ones.
+		/// </summary>
+		void AddSubmitted();
+		/// <summary>
+		/// (internal) Sends an attempt of an active transfer: adds it to the multi handle and times its first token.
+		/// </summary>
+		void StartAttempt(Transfer& transfer);
+		/// <summary>
+		/// (internal) Removes the finished transfers from the multi handle and ends their attempt.
+		/// </summary>
+		void CompleteFinished();
+		/// <summary>
+		/// (internal) Ends an attempt removed from the multi handle: schedules the next one after its backoff, or calls OnDone.
+		/// </summary>
+		void EndAttempt(Transfer& transfer, int result);
+		/// <summary>
+		/// (internal) Aborts the attempt of a transfer whose timer expired, see Transfer::Expire.
+		/// </summary>
+		void Abort(Transfer& transfer, const std::string& message, bool retryable);
+		/// <summary>
+		/// (internal) Asks the event loop for a timeout at the earliest of the timer of curl and the timers of the transfers.
+		/// </summary>
+		void UpdateTimer();
+		/// <summary>
+		/// (internal) Resumes the coroutines of Ready.
+		/// </summary>
+		void ResumeReady();
+		/// <summary>
+		/// (internal) Fails the transfers left once stopped, after waiting for the submissions and the wakeups in flight.
+		/// </summary>
+		void FailActive();
+		/// <summary>
+		/// (internal) Returns whether Stop was called.
+		/// </summary>
+		bool IsStopping() const { return Stopping; }
+
+		friend struct ReactorCallbacks;
+
+		void* Multi = nullptr;
+		/// <summary>
+		/// (internal) Set when the reactor is driven by an event loop.
+		/// </summary>
+		std::optional<EventLoopHooks> Hooks;
+
+		SubmissionQueue Queue;
+		Backpressure WhenFull;
+		std::atomic<bool> Stopping = false;
+		/// <summary>
+		/// (internal) Set by the first submission after the reactor thread emptied the queue, the following ones don't wake it again.
+		/// </summary>
+		std::atomic<bool> WakeupPending = false;
+		/// <summary>
+		/// (internal) The wakeups calling the event loop (or curl) right now, which a stopping reactor waits for.
+		/// </summary>
+		std::atomic<size_t> WakeupsInFlight = 0;
+		/// <summary>
+		/// (internal) The transfers dropped from the queue, a lock-free stack linked through Transfer::NextDropped.
+		/// </summary>
+		std::atomic<Transfer*> Dropped = nullptr;
+		/// <summary>
+		/// (internal) The transfers that got their slot from their scheduler, a lock-free stack linked through Transfer::NextGranted.
+		/// </summary>
+		std::atomic<Transfer*> Granted = nullptr;
+		/// <summary>
+		/// (internal) The transfers cancelled through Cancel, a lock-free stack linked through Transfer::NextCancelled.
+		/// </summary>
+		std::atomic<Transfer*> CancelledTransfers = nullptr;
+		/// <summary>
+		/// (internal) The producers waiting for room (or dropping the oldest transfer), and a counter they wait on, bumped once the queue was emptied.
+		/// </summary>
+		std::atomic<size_t> BlockedProducers = 0;
+		std::atomic<std::uint32_t> Drains = 0;
+		/// <summary>
+		/// (internal) The thread emptying the queue, which must not block on it.
+		/// </summary>
+		std::atomic<std::thread::id> ConsumerThread;
+		std::atomic<size_t> BlockedCount = 0;
+		std::atomic<size_t> RejectedCount = 0;
+		std::atomic<size_t> DroppedCount = 0;
+
+		// Only used by the reactor thread (or the event loop thread)
+		std::unordered_map<Transfer*, std::shared_ptr<Transfer>> Active;
+		std::vector<std::coroutine_handle<>> Ready;
+		std::vector<std::coroutine_handle<>> Resuming;
+		bool IsResuming = false;
+		/// <summary>
+		/// (internal) The deadlines, first token timeouts and retry backoffs of the transfers.
+		/// </summary>
+		TimerWheel Timers;
+		std::minstd_rand Jitter{ std::random_device{}() };
+		/// <summary>
+		/// (internal) Driven by an event loop: when curl wants its timeout, and the timeout last asked to the loop.
+		/// </summary>
+		std::optional<TimerWheel::Clock::time_point> CurlDue;
+		std::optional<TimerWheel::Clock::time_point> RequestedDue;
+
+		std::atomic<size_t> ActiveCount = 0;
+	};
+
+	/// <summary>
+	/// Sends the asynchronous requests (see API::GetCompletionAsync) from a single thread, a curl multi handle driving all of them at once.
+	/// <para>The requests in flight only cost their connection and buffers, not a thread: a reactor handles tens of thousands of them.
+	/// The coroutines awaiting them are resumed on the reactor thread, so they should hand long computations over to another thread.</para>
+	/// <para>All the API instances share the default reactor unless they're given their own one (see API::SetReactor), to spread the requests over several threads.</para>
+	/// <para>A reactor can also be driven by the event loop of the application instead of its own thread, see the constructor taking EventLoopHooks.</para>
+	/// <para>All methods are thread-safe, except the ones driving a reactor from an event loop which are called on the loop thread.</para>
+	/// </summary>
+	class Reactor {
+	public:
+		/// <summary>
+		/// Creates a reactor and starts its thread.
+		/// </summary>
+		/// <param name="options">The size of the queue the requests are submitted through, and what happens when it's full</param>
+		explicit Reactor(SubmissionOptions options = {});
+
+		/// <summary>
+		/// Creates a reactor driven by the event loop of the application: it never starts a thread or blocks.
+		/// <para>The hooks tell the loop which sockets to watch and when to run the timer, and the loop calls OnSocketEvent, OnTimeout and ProcessSubmitted on its thread.
+		/// The awaiting coroutines are resumed from those calls. See EpollEventLoop for a reference adapter.</para>
+		/// </summary>
+		/// <param name="hooks">The callbacks of the event loop, all three are required</param>
+		/// <param name="options">The size of the queue the requests are submitted through, and what happens when it's full</param>
+		explicit Reactor(EventLoopHooks hooks, SubmissionOptions options = {});
+		Reactor(const Reactor&) = delete;
+		Reactor& operator=(const Reactor&) = delete;
+
+		/// <summary>
+		/// Stops the reactor, see Stop.
+		/// </summary>
+		~Reactor();
+
+		/// <summary>
+		/// Stops the reactor: the requests still in flight fail with std::runtime_error and their coroutines are resumed, the new ones throw.
+		/// <para>With its own thread, the thread is joined. Driven by an event loop, it's called on the loop thread, and the hooks are never called afterwards.</para>
+		/// </summary>
+		void Stop();
+
+		/// <summary>
+		/// Tells the reactor driven by an event loop that a socket it watches is ready. Called on the loop thread.
+		/// </summary>
+		/// <param name="socket">The socket</param>
+		/// <param name="readable">Whether the socket can be read (or was closed by the peer)</param>
+		/// <param name="writable">Whether the socket can be written</param>
+		/// <param name="failed">Whether the socket is in error</param>
+		void OnSocketEvent(SocketHandle socket, bool readable, bool writable, bool failed = false);
+
+		/// <summary>
+		/// Tells the reactor driven by an event loop that the delay of its timer elapsed. Called on the loop thread.
+		/// </summary>
+		void OnTimeout() { Core->OnTimeout(); }
+
+		/// <summary>
+		/// Starts the requests submitted since the last call, after EventLoopHooks::Wakeup was called. Called on the loop thread.
+		/// </summary>
+		void ProcessSubmitted() { Core->ProcessSubmitted(); }
+
+		/// <summary>
+		/// Returns the reactor shared by the API instances without their own one, started on first use.
+		/// </summary>
+		static std::shared_ptr<Reactor> GetDefault();
+
+		/// <summary>
+		/// Returns the number of requests submitted and not done yet.
+		/// </summary>
+		size_t GetActiveTransfers() const { return Core->GetActiveTransfers(); }
+
+		/// <summary>
+		/// Returns the activity of the timers applying the RequestOptions of the requests, to tune their timeouts: a firing lag well above a millisecond means the reactor thread is overloaded.
+		/// </summary>
+		TimerStats GetTimerStats() const { return Core->GetTimerStats(); }
+
+		/// <summary>
+		/// Returns the activity of the queue the requests are submitted through, see SubmissionOptions.
+		/// </summary>
+		SubmissionStats GetSubmissionStats() const { return Core->GetSubmissionStats(); }
+
+		/// <summary>
+		/// (internal) Returns the state of the reactor, which the requests submit themselves to.
+		/// </summary>
+		const std::shared_ptr<ReactorCore>& GetCore() const { return Core; }
+	private:
+		std::shared_ptr<ReactorCore> Core;
+		std::thread Thread;
+	};
+}
\ No newline at end of file
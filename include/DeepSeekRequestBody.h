@@ -0,0 +1,84 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// (internal) A request body produced on demand, in chunks, while curl uploads it.
+	/// <para>It's a list of parts: small literals (copied), pre-escaped JSON and texts to escape (both viewed, they must outlive the body).
+	/// The texts are escaped a piece at a time when read, so the memory used by a request doesn't depend on the size of its messages.</para>
+	/// <para>Its size is known before it's read, so it's sent with a Content-Length like a buffered body.</para>
+	/// </summary>
+	class RequestBody {
+	public:
+		/// <summary>
+		/// Appends text copied as is.
+		/// </summary>
+		void AppendLiteral(std::string_view text);
+		/// <summary>
+		/// Appends text viewed as is (already valid JSON), it must outlive the body.
+		/// </summary>
+		void AppendView(std::string_view text);
+		/// <summary>
+		/// Appends a JSON string (quotes included) escaped from the text, which must outlive the body.
+		/// <para>Throws std::runtime_error if the text isn't valid UTF-8, so the errors happen before anything is sent.</para>
+		/// </summary>
+		void AppendString(std::string_view text);
+
+		/// <summary>
+		/// Returns the total size of the body in bytes.
+		/// </summary>
+		size_t size() const { return Size; }
+
+		/// <summary>
+		/// Writes the next bytes of the body to the buffer and returns how many were written, 0 once the whole body was read.
+		/// </summary>
+		size_t Read(char* buffer, size_t capacity);
+
+		/// <summary>
+		/// Starts reading from the beginning again (curl rewinds the upload on redirects and retries).
+		/// </summary>
+		void Rewind();
+
+		/// <summary>
+		/// Reads the whole body into a string.
+		/// </summary>
+		std::string ToString();
+
+		/// <summary>
+		/// The number of bytes of a text escaped at once while reading.
+		/// </summary>
+		static constexpr size_t ChunkSize = 64 * 1024;
+	private:
+		enum class PartKind {
+			Literal,
+			View,
+			Escaped
+		};
+		struct Part {
+			PartKind Kind;
+			/// <summary>
+			/// The text, for Literal parts an offset into Literals (Literals grows, so no view is kept).
+			/// </summary>
+			const char* Data;
+			size_t Offset;
+			size_t Length;
+		};
+
+		std::vector<Part> Parts;
+		std::string Literals;
+		size_t Size = 0;
+
+		// Reading position
+		size_t PartIndex = 0;
+		size_t PartPosition = 0;
+		/// <summary>
+		/// (internal) The escaped piece of the current Escaped part, PendingPosition bytes of it were read.
+		/// </summary>
+		std::string Pending;
+		size_t PendingPosition = 0;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <optional>
+#include <string>
+#include <cstddef>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// The class of a completion request for the RequestScheduler it goes through: a class is always served before the ones below it.
+	/// </summary>
+	enum class RequestPriority {
+		/// <summary>
+		/// A user is waiting for the answer, like a chat turn.
+		/// </summary>
+		Interactive,
+		Normal,
+		/// <summary>
+		/// Bulk work nobody waits for, like a Batch. It can be kept out of some of the slots, see SchedulerOptions::ReservedSlots.
+		/// </summary>
+		Batch
+	};
+
+	/// <summary>
+	/// The timing of an asynchronous request: its deadlines and retries, applied by the reactor sending it (see API::GetCompletionAsync), and its priority, tenant and tag.
+	/// </summary>
+	class RequestOptions {
+	public:
+		/// <summary>
+		/// Optional: The time the request may take from the moment it's awaited, retries included. Once elapsed, it's aborted and co_await throws std::runtime_error.
+		/// </summary>
+		std::optional<std::chrono::milliseconds> Timeout;
+		/// <summary>
+		/// Optional: The time the first token may take to arrive, for every attempt. Once elapsed, the attempt is aborted (and retried if MaxRetries allows it).
+		/// <para>For a streamed request it's the first delta, otherwise the first byte of the answer (the server sends blank lines while the request waits).</para>
+		/// </summary>
+		std::optional<std::chrono::milliseconds> FirstTokenTimeout;
+		/// <summary>
+		/// The number of times the request is sent again after a transient failure: a connection error, an HTTP 429 or 5xx status, or an expired FirstTokenTimeout.
+		/// <para>A streamed request is only retried if none of its deltas was handed out yet.</para>
+		/// </summary>
+		size_t MaxRetries = 0;
+		/// <summary>
+		/// The delay before the first retry, doubled for every following one. The actual delay is drawn between the half and the whole of it, so the requests failing together don't retry together.
+		/// </summary>
+		std::chrono::milliseconds RetryBackoff{ 500 };
+		/// <summary>
+		/// Optional: The class of the request for the scheduler of its API instance (see API::SetScheduler). If empty, the class of the instance (see API::SetPriority).
+		/// <para>Within a class, the requests of a tenant with a Timeout are served earliest deadline first, ahead of the ones without
+		/// (with SchedulerOptions::ShortestPredictedFirst, shortest first until their deadline gets close).</para>
+		/// </summary>
+		std::optional<RequestPriority> Priority;
+		/// <summary>
+		/// Optional: The tenant the request is sent for, which the scheduler of its API instance shares the slots between (see RequestScheduler::SetTenant). If empty, the tenant of the instance (see API::SetTenant).
+		/// </summary>
+		std::optional<std::string> Tenant;
+		/// <summary>
+		/// Optional: The kind of request, like "summary" or "translation". The scheduler learns the completion length of each tag from the usage reported, see SchedulerOptions::ShortestPredictedFirst. If empty, the tag of the instance (see API::SetTag).
+		/// </summary>
+		std::optional<std::string> Tag;
+	};
+}
\ No newline at end of file
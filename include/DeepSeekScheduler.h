@@ -0,0 +1,436 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <unordered_map>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <array>
+#include <utility>
+#include <tuple>
+#include <cstddef>
+#include <cstdint>
+#include "DeepSeekRequestOptions.h"
+#include "DeepSeekUsage.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// The number of RequestPriority classes.
+	/// </summary>
+	constexpr size_t RequestPriorityCount = 3;
+
+	/// <summary>
+	/// The share of a tenant in a RequestScheduler, see RequestScheduler::SetTenant.
+	/// </summary>
+	class TenantOptions {
+	public:
+		/// <summary>
+		/// The share of the tenant when tenants compete for the slots: a tenant of weight 2 sends twice the tokens of a tenant of weight 1.
+		/// </summary>
+		double Weight = 1;
+		/// <summary>
+		/// Optional: The number of requests of the tenant in flight at once, 0 for no limit beyond the one of the scheduler.
+		/// </summary>
+		size_t MaxInFlight = 0;
+		/// <summary>
+		/// Optional: The tokens the tenant may use per minute, prompts and completions, 0 for no budget.
+		/// <para>A request is charged its estimated prompt when it arrives, and corrected with its reported usage once it's done.
+		/// While the tenant is over its budget, its new requests are rejected: they throw std::runtime_error.</para>
+		/// </summary>
+		size_t TokensPerMinute = 0;
+		/// <summary>
+		/// Optional: The number of requests of the tenant waiting at once, 0 for no limit. The requests beyond it are rejected.
+		/// </summary>
+		size_t MaxQueued = 0;
+	};
+
+	/// <summary>
+	/// The limits of a RequestScheduler.
+	/// </summary>
+	class SchedulerOptions {
+	public:
+		/// <summary>
+		/// The number of completion requests in flight at once, usually the concurrency limit of the API key. The others wait in the scheduler.
+		/// </summary>
+		size_t MaxInFlight = 8;
+		/// <summary>
+		/// The number of slots RequestPriority::Batch requests can't take, so an interactive request doesn't wait for a batch request to finish.
+		/// <para>At least a slot is always left to them.</para>
+		/// </summary>
+		size_t ReservedSlots = 1;
+		/// <summary>
+		/// The tokens a tenant of weight 1 may send per round when tenants compete for the slots. Smaller is fairer over short periods, larger takes fewer rounds for large requests.
+		/// </summary>
+		size_t Quantum = 1024;
+		/// <summary>
+		/// The share of the tenants without their own, see RequestScheduler::SetTenant.
+		/// </summary>
+		TenantOptions DefaultTenant;
+		/// <summary>
+		/// Sends the waiting requests of a tenant shortest first: by their prompt plus the completion predicted for their tag (see RequestOptions::Tag).
+		/// <para>A deadline is then a constraint rather than the order: a request goes ahead of the shorter ones once its slack (the time left before its deadline, minus its service time)
+		/// is below its service time, predicted for its tag like its completion. So it still has the time of a request to get a slot. The requests promoted that way go in the order they were.</para>
+		/// <para>It lowers the mean completion time of mixed workloads, a long request without deadline waits while shorter ones keep arriving though. Batch orders its requests by the same cost.</para>
+		/// <para>The predictions are learned either way, they also make the round robin and the budgets count the expected completion.</para>
+		/// </summary>
+		bool ShortestPredictedFirst = false;
+	};
+
+	/// <summary>
+	/// Represents the requests of a RequestPriority class that went through a scheduler, see SchedulerStats.
+	/// </summary>
+	class PriorityStats {
+	public:
+		/// <summary>
+		/// The number of requests that got a slot.
+		/// </summary>
+		size_t Granted = 0;
+		/// <summary>
+		/// The number of requests waiting for a slot.
+		/// </summary>
+		size_t Waiting = 0;
+		/// <summary>
+		/// The number of times a request of a higher class arrived while requests of this class were waiting, and went ahead of them.
+		/// </summary>
+		size_t Preempted = 0;
+		/// <summary>
+		/// The mean time the requests waited for their slot, in milliseconds (the ones that got it right away included).
+		/// </summary>
+		double MeanWaitMs = 0;
+		/// <summary>
+		/// The longest time a request waited for its slot, in milliseconds.
+		/// </summary>
+		double MaxWaitMs = 0;
+	};
+
+	/// <summary>
+	/// Represents the requests of a tenant that went through a scheduler, see SchedulerStats.
+	/// </summary>
+	class TenantStats {
+	public:
+		/// <summary>
+		/// The number of requests that got a slot.
+		/// </summary>
+		size_t Granted = 0;
+		/// <summary>
+		/// The number of requests done with a reported usage.
+		/// </summary>
+		size_t Completed = 0;
+		/// <summary>
+		/// The number of requests rejected: over the token budget, or beyond the queue limit of the tenant.
+		/// </summary>
+		size_t Rejected = 0;
+		/// <summary>
+		/// The number of requests waiting for a slot.
+		/// </summary>
+		size_t Waiting = 0;
+		/// <summary>
+		/// The number of requests holding a slot.
+		/// </summary>
+		size_t InFlight = 0;
+		/// <summary>
+		/// The tokens reported for the completed requests, prompts and completions.
+		/// </summary>
+		size_t Tokens = 0;
+		/// <summary>
+		/// The throughput of the tenant: Tokens per second since its first request.
+		/// </summary>
+		double TokensPerSecond = 0;
+		/// <summary>
+		/// The mean time the requests waited for their slot, in milliseconds.
+		/// </summary>
+		double MeanWaitMs = 0;
+		/// <summary>
+		/// The longest time a request waited for its slot, in milliseconds.
+		/// </summary>
+		double MaxWaitMs = 0;
+	};
+
+	/// <summary>
+	/// Represents what a scheduler learned about the requests of a tag, see SchedulerStats.
+	/// </summary>
+	class TagStats {
+	public:
+		/// <summary>
+		/// The number of requests of the tag done with a reported usage.
+		/// </summary>
+		size_t Completed = 0;
+		/// <summary>
+		/// The completion tokens predicted for the next request of the tag: a moving average of the recent ones.
+		/// </summary>
+		double PredictedCompletionTokens = 0;
+		/// <summary>
+		/// The time predicted for the next request of the tag from the moment it gets its slot, in milliseconds: a moving average of the recent ones.
+		/// </summary>
+		double PredictedServiceMs = 0;
+	};
+
+	/// <summary>
+	/// Represents the activity of a RequestScheduler, see RequestScheduler::GetStats.
+	/// </summary>
+	class SchedulerStats {
+	public:
+		/// <summary>
+		/// The number of requests holding a slot.
+		/// </summary>
+		size_t InFlight = 0;
+		/// <summary>
+		/// The statistics of every class, indexed by RequestPriority.
+		/// </summary>
+		std::array<PriorityStats, RequestPriorityCount> Classes;
+		/// <summary>
+		/// The statistics of every tenant that sent a request, by id.
+		/// </summary>
+		std::map<std::string, TenantStats> Tenants;
+		/// <summary>
+		/// The predictions of every tag of a completed request, by tag.
+		/// </summary>
+		std::map<std::string, TagStats> Tags;
+
+		const PriorityStats& operator[](RequestPriority priority) const { return Classes[static_cast<size_t>(priority)]; }
+	};
+
+	/// <summary>
+	/// Shares the concurrency limit of an API key between the completion requests of the API instances using it (see API::SetScheduler), blocking and asynchronous alike.
+	/// <para>A request takes a slot before it's sent, and gives it back once it's done (retries included). When the slots are all taken, the requests wait in a queue per RequestPriority class:
+	/// a free slot goes to the highest class waiting, and within a class to the tenant whose turn it is, then to its request with the earliest deadline (the oldest one without), or its shortest one with SchedulerOptions::ShortestPredictedFirst.
+	/// So the batch requests waiting to be sent are overtaken by every interactive one, only the batch requests already in flight are waited for.</para>
+	/// <para>Within a class, the tenants of the requests (see RequestOptions::Tenant) share the slots by deficit round robin: they take turns, each sending up to its weight in
+	/// SchedulerOptions::Quantum tokens per turn, so a tenant sending many or large requests doesn't hold up the others. A tenant can also be capped in requests in flight and in tokens per minute.</para>
+	/// <para>A blocking request waits on its thread, an asynchronous one in its reactor without holding any thread. All methods are thread-safe.</para>
+	/// </summary>
+	class RequestScheduler {
+		struct TenantState;
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		/// <summary>
+		/// (internal) The place of a request in the scheduler, a member of its transfer.
+		/// </summary>
+		class Ticket {
+		public:
+			Ticket() = default;
+			Ticket(const Ticket&) = delete;
+			Ticket& operator=(const Ticket&) = delete;
+
+			RequestPriority Priority = RequestPriority::Normal;
+			/// <summary>
+			/// Orders the requests of a tenant in a class, the ones without a deadline come last (with SchedulerOptions::ShortestPredictedFirst, promotes the request as it gets close).
+			/// </summary>
+			Clock::time_point Deadline = Clock::time_point::max();
+			std::string Tenant;
+			/// <summary>
+			/// The kind of request, whose completion length is learned from the usage reported.
+			/// </summary>
+			std::string Tag;
+			/// <summary>
+			/// The prompt tokens of the request, as its API instance counts them for the context window (with its tokenizer, or the estimate).
+			/// </summary>
+			size_t PromptTokens = 0;
+		private:
+			friend class RequestScheduler;
+
+			enum class State {
+				Idle,
+				Waiting,
+				Granted
+			};
+
+			State Status = State::Idle;
+			/// <summary>
+			/// (internal) The prompt plus the predicted completion, what the round robin and the budget of its tenant count.
+			/// </summary>
+			size_t Cost = 0;
+			/// <summary>
+			/// (internal) The deadline and the cost the queue is ordered by, kept to find the request again: the deadline and 0, or no deadline and the cost if SchedulerOptions::ShortestPredictedFirst.
+			/// </summary>
+			Clock::time_point QueuedDeadline;
+			size_t QueuedCost = 0;
+			std::uint64_t Sequence = 0;
+			/// <summary>
+			/// (internal) When a request sent shortest first goes ahead of the shorter ones: its deadline minus twice its predicted service time.
+			/// </summary>
+			Clock::time_point PromoteAt;
+			Clock::time_point Enqueued;
+			Clock::time_point GrantedAt;
+			/// <summary>
+			/// (internal) The tenant, set once the request arrived. The tenants are never removed.
+			/// </summary>
+			TenantState* Owner = nullptr;
+			/// <summary>
+			/// (internal) The tokens charged to the budget of the tenant so far.
+			/// </summary>
+			double Charged = 0;
+			/// <summary>
+			/// (internal) Called once the waiting request got its slot, or wakes the blocked thread if empty.
+			/// </summary>
+			std::function<void()> OnGranted;
+			std::condition_variable Woken;
+		};
+
+		/// <summary>
+		/// Creates a scheduler with no request in flight.
+		/// </summary>
+		explicit RequestScheduler(SchedulerOptions options = {});
+		RequestScheduler(const RequestScheduler&) = delete;
+		RequestScheduler& operator=(const RequestScheduler&) = delete;
+
+		/// <summary>
+		/// Sets the share of a tenant, replacing SchedulerOptions::DefaultTenant for it. It applies to the requests waiting too.
+		/// </summary>
+		/// <param name="tenant">The id of the tenant, see RequestOptions::Tenant</param>
+		/// <param name="options">Its weight, caps and budget</param>
+		void SetTenant(std::string_view tenant, TenantOptions options);
+
+		/// <summary>
+		/// (internal) Takes a slot for the request, blocking until one is free.
+		/// <para>Throws std::runtime_error if the tenant rejects the request.</para>
+		/// </summary>
+		void Acquire(Ticket& ticket);
+
+		/// <summary>
+		/// (internal) Takes a slot for the request if one is free and no request goes before it, otherwise queues it.
+		/// <para>on_granted is then called once the request got its slot, under the lock of the scheduler: it must only hand the request over.</para>
+		/// <para>Throws std::runtime_error if the tenant rejects the request.</para>
+		/// </summary>
+		/// <returns>Whether the request got its slot right away</returns>
+		bool TryAcquire(Ticket& ticket, std::function<void()> on_granted);
+
+		/// <summary>
+		/// (internal) Gives the slot of the request back, or takes it out of the queue, once it's done. It does nothing if the request holds no slot.
+		/// <para>Once it returned, the on_granted of the request is never called.</para>
+		/// </summary>
+		void Leave(Ticket& ticket);
+
+		/// <summary>
+		/// (internal) Records the usage reported for a completed request, for the throughput and the budget of its tenant, and the predictions of its tag.
+		/// </summary>
+		void Complete(Ticket& ticket, const Usage& usage);
+
+		/// <summary>
+		/// Returns the completion tokens predicted for a request of the tag, learned from the usage reported for the previous ones.
+		/// <para>An unknown tag is predicted like the mean of all the requests, 0 before the first one completed.</para>
+		/// </summary>
+		double PredictCompletionTokens(std::string_view tag) const;
+
+		/// <summary>
+		/// Returns the activity of the scheduler so far: the slots taken, and the requests waiting and their wait times per class and per tenant, and the predictions per tag.
+		/// </summary>
+		SchedulerStats GetStats() const;
+
+		const SchedulerOptions& GetOptions() const { return Options; }
+	private:
+		/// <summary>
+		/// (internal) The waiting requests of a tenant in a class, by deadline (or by cost if they're sent shortest first), then by arrival.
+		/// </summary>
+		using Queue = std::map<std::tuple<Clock::time_point, size_t, std::uint64_t>, Ticket*>;
+		/// <summary>
+		/// (internal) The waiting requests of a tenant in a class that have a deadline, by the time they're promoted, if they're sent shortest first.
+		/// </summary>
+		using Promotions = std::map<std::pair<Clock::time_point, std::uint64_t>, Ticket*>;
+
+		/// <summary>
+		/// (internal) The completion tokens reported for a tag.
+		/// </summary>
+		struct TagState {
+			size_t Completed = 0;
+			double MeanCompletionTokens = 0;
+			double MeanServiceSeconds = 0;
+
+			void Add(double completion_tokens, double service_seconds);
+		};
+
+		struct TenantState {
+			TenantOptions Options;
+			std::array<Queue, RequestPriorityCount> Waiting;
+			std::array<Promotions, RequestPriorityCount> Deadlines;
+			/// <summary>
+			/// (internal) The tokens the tenant may still send in its turn, per class.
+			/// </summary>
+			std::array<double, RequestPriorityCount> Deficit{};
+			size_t Queued = 0;
+			size_t InFlight = 0;
+			/// <summary>
+			/// (internal) The tokens left in the budget, negative once over it.
+			/// </summary>
+			double Budget = 0;
+			Clock::time_point Refilled;
+			Clock::time_point FirstRequest;
+			size_t Granted = 0;
+			size_t Completed = 0;
+			size_t Rejected = 0;
+			size_t Tokens = 0;
+			Clock::duration TotalWait{};
+			Clock::duration MaxWait{};
+		};
+
+		struct ClassState {
+			/// <summary>
+			/// (internal) The tenants with requests waiting in the class, in the order of their turns. The one in front has the turn.
+			/// </summary>
+			std::deque<TenantState*> Round;
+			size_t Waiting = 0;
+			size_t Granted = 0;
+			size_t Preempted = 0;
+			Clock::duration TotalWait{};
+			Clock::duration MaxWait{};
+		};
+
+		/// <summary>
+		/// (internal) Returns whether a request of the class can take a free slot.
+		/// </summary>
+		bool HasSlot(RequestPriority priority) const;
+		/// <summary>
+		/// (internal) Checks the caps and the budget of the tenant and queues the request, then hands out the free slots. Returns whether the request got one.
+		/// </summary>
+		bool Enter(Ticket& ticket);
+		/// <summary>
+		/// (internal) Returns the request of the tenant that goes next in the class: the first one promoted by its deadline, otherwise the first one of its queue.
+		/// </summary>
+		Ticket& Front(TenantState& tenant, size_t index, Clock::time_point now) const;
+		/// <summary>
+		/// (internal) Takes a waiting request out of the queues of its tenant.
+		/// </summary>
+		void Remove(TenantState& tenant, size_t index, Ticket& ticket);
+		/// <summary>
+		/// (internal) Picks the next request of the class by deficit round robin and takes it out of its queue, nullptr if every tenant waiting is at its cap.
+		/// </summary>
+		Ticket* PickNext(size_t index, Clock::time_point now);
+		/// <summary>
+		/// (internal) Records the request as holding a slot.
+		/// </summary>
+		void Grant(Ticket& ticket, Clock::time_point now);
+		/// <summary>
+		/// (internal) Hands the free slots to the waiting requests, highest class first. The entering request is only marked as granted.
+		/// </summary>
+		void Dispatch(const Ticket* entering = nullptr);
+		/// <summary>
+		/// (internal) Refills the token budget of the tenant for the time elapsed.
+		/// </summary>
+		void Refill(TenantState& tenant, Clock::time_point now) const;
+		/// <summary>
+		/// (internal) PredictCompletionTokens, under the lock.
+		/// </summary>
+		double Predict(std::string_view tag) const;
+		/// <summary>
+		/// (internal) Returns the time predicted for a request of the tag from the moment it gets its slot, in seconds, under the lock.
+		/// </summary>
+		double PredictService(std::string_view tag) const;
+
+		SchedulerOptions Options;
+		mutable std::mutex Mutex;
+		size_t InFlight = 0;
+		std::uint64_t NextSequence = 0;
+		std::array<ClassState, RequestPriorityCount> Classes;
+		std::unordered_map<std::string, TenantState> Tenants;
+		std::unordered_map<std::string, TagState> Tags;
+		/// <summary>
+		/// (internal) All the tags together, predicting the unknown ones.
+		/// </summary>
+		TagState AllTags;
+	};
+}
\ No newline at end of file
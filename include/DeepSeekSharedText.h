@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Immutable, reference-counted message content, shared by every message using it.
+	/// <para>Use Intern for texts repeated across conversations (system prompts, templated messages):
+	/// identical texts are then stored once per process, however many sessions use them.</para>
+	/// <para>The text is escaped for the request bodies only once, the first time it's sent. All methods are thread-safe.</para>
+	/// </summary>
+	class SharedText {
+	public:
+		/// <summary>
+		/// Returns the process-wide shared copy of the text, creating it if no live copy exists.
+		/// <para>The copy is released when the last message using it is destroyed.</para>
+		/// </summary>
+		/// <param name="text">The text</param>
+		/// <returns></returns>
+		static std::shared_ptr<const SharedText> Intern(std::string_view text);
+
+		/// <summary>
+		/// Creates a shared text that is not interned (use Intern to deduplicate it).
+		/// </summary>
+		/// <param name="text">The text</param>
+		explicit SharedText(std::string text)
+			: Text(std::move(text)) {}
+
+		SharedText(const SharedText&) = delete;
+		SharedText& operator=(const SharedText&) = delete;
+
+		/// <summary>
+		/// Returns the text.
+		/// </summary>
+		std::string_view View() const { return Text; }
+
+		/// <summary>
+		/// (internal) Returns the text as a JSON string (quotes included), escaped on the first call and cached.
+		/// </summary>
+		const std::string& GetEscapedJSON() const;
+
+		/// <summary>
+		/// Returns the number of interned texts currently alive in the process.
+		/// </summary>
+		static size_t GetInternedCount();
+	private:
+		friend class Tokenizer;
+
+		/// <summary>
+		/// (internal) Removes the text from the intern table, called by the deleter of interned texts.
+		/// </summary>
+		void Unintern() const;
+
+		const std::string Text;
+		mutable std::once_flag EscapedOnce;
+		mutable std::string Escaped;
+		/// <summary>
+		/// (internal) The token count of the text memoized by Tokenizer, shared by all the messages using the text (see Message).
+		/// </summary>
+		mutable std::atomic<std::uint64_t> TokenMemo{ 0 };
+	};
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define INX_DEEPSEEK_X86 1
+#endif
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// (internal) The vector instruction sets used by the text processing routines.
+	/// <para>The best one supported by the CPU is picked at runtime, the scalar versions are always available as a fallback.</para>
+	/// </summary>
+	enum class InstructionSet {
+		/// <summary>
+		/// Plain C++, no vector instructions.
+		/// </summary>
+		Scalar,
+		/// <summary>
+		/// 16 bytes at a time, using the SSE4.2 string instructions.
+		/// </summary>
+		SSE42,
+		/// <summary>
+		/// 32 bytes at a time.
+		/// </summary>
+		AVX2
+	};
+
+	/// <summary>
+	/// (internal) Returns the instruction set currently used by the text processing routines.
+	/// </summary>
+	InstructionSet GetInstructionSet();
+
+	/// <summary>
+	/// (internal) Restricts the text processing routines to the given instruction set, mostly useful for benchmarks and tests.
+	/// <para>Requesting an instruction set the CPU doesn't support falls back to the best supported one below it.</para>
+	/// </summary>
+	void SetInstructionSet(InstructionSet instruction_set);
+
+	/// <summary>
+	/// (internal) A set of ASCII bytes, precomputed in the forms the scalar and vector routines need.
+	/// </summary>
+	class AsciiSet {
+	public:
+		/// <summary>
+		/// Builds the set from inclusive byte ranges, every byte must be below 0x80.
+		/// </summary>
+		constexpr AsciiSet(std::initializer_list<std::pair<unsigned char, unsigned char>> ranges) {
+			for (const auto& [first, last] : ranges) {
+				for (unsigned c = first; c <= last; c++) {
+					Bitmap[c >> 6] |= 1ull << (c & 63);
+					LowNibbles[c & 15] |= static_cast<unsigned char>(1u << (c >> 4));
+				}
+			}
+			for (unsigned c = 0; c < 128; c++) {
+				bool member = Contains(static_cast<unsigned char>(c));
+				bool previous = c > 0 && Contains(static_cast<unsigned char>(c - 1));
+				if (member && !previous) {
+					RangeCount++;
+				}
+				if (member && RangeCount <= 8) {
+					if (!previous) {
+						Ranges[RangeCount * 2 - 2] = static_cast<char>(c);
+					}
+					Ranges[RangeCount * 2 - 1] = static_cast<char>(c);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Returns whether the byte is in the set (never true for bytes above 0x7F).
+		/// </summary>
+		constexpr bool Contains(unsigned char c) const {
+			return c < 128 && (Bitmap[c >> 6] >> (c & 63)) & 1;
+		}
+
+		/// <summary>
+		/// 128 bits, one per ASCII byte.
+		/// </summary>
+		std::uint64_t Bitmap[2] = {};
+		/// <summary>
+		/// For every low nibble, one bit per high nibble (0-7) that makes a member (used with byte shuffles).
+		/// </summary>
+		unsigned char LowNibbles[16] = {};
+		/// <summary>
+		/// The set as up to 8 inclusive ranges (used with the SSE4.2 range comparisons).
+		/// </summary>
+		char Ranges[16] = {};
+		/// <summary>
+		/// The number of ranges, sets needing more than 8 ranges don't use the SSE4.2 path.
+		/// </summary>
+		int RangeCount = 0;
+	};
+
+	/// <summary>
+	/// (internal) The vectorized part of SpanAscii, dispatched to the active instruction set.
+	/// </summary>
+	size_t SpanAsciiBlocks(const char* data, size_t size, const AsciiSet& set);
+
+	/// <summary>
+	/// (internal) Returns the length of the multi-byte UTF-8 sequence starting the data, 0 if it's invalid
+	/// (truncated, overlong, a surrogate or above U+10FFFF, like nlohmann::json rejects them) or if the data starts with ASCII. The data must not be empty.
+	/// </summary>
+	size_t Utf8SequenceLength(const char* data, size_t size);
+
+	/// <summary>
+	/// (internal) Returns whether the data is valid UTF-8, with the same rules as Utf8SequenceLength.
+	/// <para>Dispatched to the active instruction set, the vector versions classify 16 or 32 bytes at a time with table lookups and skip ASCII blocks.</para>
+	/// </summary>
+	bool IsValidUtf8(const char* data, size_t size);
+
+	/// <summary>
+	/// (internal) Returns the length of the longest prefix of the data that is copied as is into a JSON string:
+	/// printable ASCII (0x7F included) except the quote and the backslash.
+	/// <para>Dispatched to the active instruction set, the vector versions test a whole block with 3 comparisons.</para>
+	/// </summary>
+	size_t SpanJsonPlain(const char* data, size_t size);
+
+	/// <summary>
+	/// (internal) Returns the length of the longest prefix of the data made only of bytes in the set.
+	/// <para>Most runs in text are short words, so the first bytes are checked inline before switching to vector instructions.</para>
+	/// </summary>
+	inline size_t SpanAscii(const char* data, size_t size, const AsciiSet& set) {
+		constexpr size_t inline_bytes = 16;
+		size_t limit = size < inline_bytes ? size : inline_bytes;
+		for (size_t i = 0; i < limit; i++) {
+			if (!set.Contains(static_cast<unsigned char>(data[i]))) {
+				return i;
+			}
+		}
+		return limit + (size > limit ? SpanAsciiBlocks(data + limit, size - limit, set) : 0);
+	}
+}
\ No newline at end of file
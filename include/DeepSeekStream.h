@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Receives the pieces of a streamed completion as they're generated, see API::StreamCompletion.
+	/// <para>A delta is never empty and always made of whole UTF-8 code points.</para>
+	/// </summary>
+	using DeltaCallback = std::function<void(std::string_view delta)>;
+
+	/// <summary>
+	/// (internal) Decodes the server-sent events of a streamed completion as curl receives them.
+	/// <para>Every received chunk is validated as UTF-8 (see IsValidUtf8). A sequence split between two chunks is carried over and checked with the next one,
+	/// and the events are only parsed once their line is complete, so the deltas handed out never contain a broken character.</para>
+	/// </summary>
+	class StreamDecoder {
+	public:
+		/// <summary>
+		/// Creates a decoder calling on_delta, with a buffer for the bytes waiting for the end of their line (the response buffer of the connection, to reuse its memory).
+		/// </summary>
+		StreamDecoder(const DeltaCallback& on_delta, std::string& pending)
+			: OnDelta(on_delta), Pending(pending) {}
+
+		/// <summary>
+		/// Decodes the next bytes received, calling the delta callback for the complete events.
+		/// <para>Throws std::runtime_error if the bytes aren't valid UTF-8, or if an event is malformed or reports an error.</para>
+		/// </summary>
+		void Feed(std::string_view chunk);
+
+		/// <summary>
+		/// Checks that the stream ended properly, to call once the transfer is over.
+		/// <para>Throws std::runtime_error if the stream was cut, or with the error message if the server answered with an error instead of a stream.</para>
+		/// </summary>
+		void Finish();
+
+		/// <summary>
+		/// Returns the whole content received so far.
+		/// </summary>
+		const std::string& GetContent() const { return Content; }
+
+		/// <summary>
+		/// Returns the event carrying the usage (sent last), null if none was received.
+		/// </summary>
+		const nlohmann::json& GetUsageEvent() const { return UsageEvent; }
+	private:
+		/// <summary>
+		/// (internal) Handles a complete line of the stream, without its line break.
+		/// </summary>
+		void ProcessLine(std::string_view line);
+
+		const DeltaCallback& OnDelta;
+		/// <summary>
+		/// (internal) The received bytes not processed yet: the beginning of the next line.
+		/// </summary>
+		std::string& Pending;
+		/// <summary>
+		/// (internal) The incomplete UTF-8 sequence ending the last chunk, validated once the next chunk completes it.
+		/// </summary>
+		char Carry[4] = {};
+		size_t CarrySize = 0;
+		std::string Content;
+		nlohmann::json UsageEvent;
+		/// <summary>
+		/// (internal) The lines that aren't events, an error response when the server doesn't stream.
+		/// </summary>
+		std::string Unparsed;
+		bool Done = false;
+	};
+}
\ No newline at end of file
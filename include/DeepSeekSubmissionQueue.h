@@ -0,0 +1,134 @@
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include "DeepSeekTransfer.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// What submitting a request to a reactor does when its submission queue is full, see SubmissionOptions.
+	/// </summary>
+	enum class Backpressure {
+		/// <summary>
+		/// The submitting thread waits until the reactor made room. A coroutine resumed on the reactor thread can't wait for itself, it fails instead.
+		/// </summary>
+		Block,
+		/// <summary>
+		/// co_await throws std::runtime_error right away.
+		/// </summary>
+		Fail,
+		/// <summary>
+		/// The oldest request of the queue is dropped to make room: its co_await throws std::runtime_error.
+		/// </summary>
+		DropOldest
+	};
+
+	/// <summary>
+	/// The submission queue of a reactor, through which the asynchronous requests reach its thread, see the Reactor constructors.
+	/// </summary>
+	class SubmissionOptions {
+	public:
+		/// <summary>
+		/// The number of requests waiting for the reactor to pick them up, rounded up to a power of two.
+		/// <para>A reactor picks up the whole queue at every wakeup, so it only fills when the requests are submitted faster than the reactor thread starts them.</para>
+		/// </summary>
+		size_t Capacity = 16384;
+		/// <summary>
+		/// What submitting does when the queue is full.
+		/// </summary>
+		Backpressure WhenFull = Backpressure::Block;
+	};
+
+	/// <summary>
+	/// Represents the activity of the submission queue of a reactor, see Reactor::GetSubmissionStats.
+	/// </summary>
+	class SubmissionStats {
+	public:
+		/// <summary>
+		/// The number of requests the queue holds.
+		/// </summary>
+		size_t Capacity = 0;
+		/// <summary>
+		/// The number of requests waiting in the queue (approximate while they're submitted).
+		/// </summary>
+		size_t Queued = 0;
+		/// <summary>
+		/// The number of times a submission waited for room (Backpressure::Block).
+		/// </summary>
+		size_t Blocked = 0;
+		/// <summary>
+		/// The number of requests that failed because the queue was full.
+		/// </summary>
+		size_t Rejected = 0;
+		/// <summary>
+		/// The number of queued requests dropped to make room for newer ones (Backpressure::DropOldest).
+		/// </summary>
+		size_t Dropped = 0;
+	};
+
+	/// <summary>
+	/// (internal) A bounded lock-free queue of transfers, filled by any thread and emptied by the reactor thread.
+	/// <para>It's a ring of cells numbered with sequence counters: a producer claims a cell by advancing the tail with a single compare-and-swap, fills it, then publishes it by setting its sequence.
+	/// The consumer takes the cells in order the same way from the head. The submitting threads never wait for each other, and neither does the reactor thread.</para>
+	/// <para>Popping is also safe from the producers, which drop the oldest transfer with Backpressure::DropOldest.</para>
+	/// </summary>
+	class SubmissionQueue {
+	public:
+		enum class PushResult {
+			Pushed,
+			Full,
+			Closed
+		};
+
+		/// <summary>
+		/// Creates an empty queue of at least capacity cells.
+		/// </summary>
+		explicit SubmissionQueue(size_t capacity);
+		SubmissionQueue(const SubmissionQueue&) = delete;
+		SubmissionQueue& operator=(const SubmissionQueue&) = delete;
+
+		/// <summary>
+		/// Appends the transfer, which is only moved from if it returns PushResult::Pushed.
+		/// </summary>
+		PushResult TryPush(std::shared_ptr<Transfer>& transfer);
+
+		/// <summary>
+		/// Takes the oldest transfer, returns false if the queue is empty (or its oldest cell is still being filled).
+		/// </summary>
+		bool TryPop(std::shared_ptr<Transfer>& transfer);
+
+		/// <summary>
+		/// Makes every following push return PushResult::Closed.
+		/// </summary>
+		void Close();
+
+		/// <summary>
+		/// Returns whether every claimed cell was popped. Once closed, nothing can be pushed after that.
+		/// </summary>
+		bool IsDrained() const;
+
+		/// <summary>
+		/// Returns the number of transfers queued, approximate while they're pushed and popped.
+		/// </summary>
+		size_t size() const;
+
+		size_t capacity() const { return Mask + 1; }
+	private:
+		struct Cell {
+			std::atomic<size_t> Sequence;
+			std::shared_ptr<Transfer> Item;
+		};
+
+		/// <summary>
+		/// (internal) Set in the tail once closed, so the producers see it with the compare-and-swap they claim a cell with.
+		/// </summary>
+		static constexpr size_t ClosedBit = ~(~size_t(0) >> 1);
+
+		std::unique_ptr<Cell[]> Cells;
+		size_t Mask = 0;
+		// On their own cache lines, the producers hammer the tail while the consumer advances the head
+		alignas(64) std::atomic<size_t> Head = 0;
+		alignas(64) std::atomic<size_t> Tail = 0;
+	};
+}
\ No newline at end of file
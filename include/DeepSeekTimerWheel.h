@@ -0,0 +1,186 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <atomic>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Represents the activity of the timers of a reactor (deadlines, first token timeouts, retry backoffs), see Reactor::GetTimerStats.
+	/// </summary>
+	class TimerStats {
+	public:
+		/// <summary>
+		/// The number of timers scheduled.
+		/// </summary>
+		size_t Scheduled = 0;
+		/// <summary>
+		/// The number of timers cancelled before firing (usually requests done before their deadline).
+		/// </summary>
+		size_t Cancelled = 0;
+		/// <summary>
+		/// The number of timers fired.
+		/// </summary>
+		size_t Fired = 0;
+		/// <summary>
+		/// The number of timers waiting to fire.
+		/// </summary>
+		size_t Pending = 0;
+		/// <summary>
+		/// The number of times a timer was moved down a level of the wheel as its due time came closer.
+		/// </summary>
+		size_t Cascades = 0;
+		/// <summary>
+		/// The mean delay between the due time of the timers and the time they actually fired, in milliseconds.
+		/// <para>The wheel has a resolution of TimerWheel::Tick, a lag well above it means the reactor thread is overloaded.</para>
+		/// </summary>
+		double MeanLagMs = 0;
+		/// <summary>
+		/// The largest delay between the due time of a timer and the time it fired, in milliseconds.
+		/// </summary>
+		double MaxLagMs = 0;
+	};
+
+	/// <summary>
+	/// (internal) A hierarchical timer wheel: scheduling and cancelling a timer is O(1), whatever the number of timers.
+	/// <para>There are Levels wheels of Slots slots. A timer goes into the lowest level whose span covers its delay, and moves down a level each time
+	/// the level above turns to its slot, until it fires from the first level. So a timer is touched at most Levels times, and firing the due timers only visits their slot.</para>
+	/// <para>The timers are intrusive (they're usually members of the transfer they time), and not thread-safe: a wheel is used by its reactor thread only. GetStats is thread-safe.</para>
+	/// </summary>
+	class TimerWheel {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		/// <summary>
+		/// The resolution of the wheel.
+		/// </summary>
+		static constexpr std::chrono::milliseconds Tick{ 1 };
+		static constexpr size_t SlotBits = 6;
+		static constexpr size_t Slots = size_t(1) << SlotBits;
+		/// <summary>
+		/// With 1 ms ticks, 5 levels of 64 slots span about 12 days. Longer delays wait in the last level until they're in range.
+		/// </summary>
+		static constexpr size_t Levels = 5;
+
+		/// <summary>
+		/// (internal) The links of the circular list of a slot. The slot heads are plain links and the timers derive from it, so the lists need no special case for their ends.
+		/// </summary>
+		struct Link {
+			Link* Previous = nullptr;
+			Link* Next = nullptr;
+		};
+
+		/// <summary>
+		/// A timer, which must stay at the same address and not be destroyed while it's scheduled.
+		/// </summary>
+		class Timer : private Link {
+		public:
+			Timer() = default;
+			Timer(const Timer&) = delete;
+			Timer& operator=(const Timer&) = delete;
+
+			/// <summary>
+			/// Returns whether the timer is scheduled and didn't fire yet.
+			/// </summary>
+			bool IsScheduled() const { return Previous != nullptr; }
+		private:
+			friend class TimerWheel;
+
+			std::uint64_t DueTick = 0;
+			std::uint8_t Level = 0;
+			std::uint8_t SlotIndex = 0;
+			Clock::time_point Due;
+			std::function<void()> OnFired;
+		};
+
+		/// <summary>
+		/// Creates an empty wheel whose first tick starts at the time given (the current time by default).
+		/// </summary>
+		explicit TimerWheel(Clock::time_point start = Clock::now());
+		TimerWheel(const TimerWheel&) = delete;
+		TimerWheel& operator=(const TimerWheel&) = delete;
+
+		/// <summary>
+		/// Schedules the timer (rescheduling it if it's already scheduled). It fires on the first Advance at or after due, at the earliest on the next tick.
+		/// </summary>
+		/// <param name="timer">The timer</param>
+		/// <param name="due">When the timer fires</param>
+		/// <param name="on_fired">Called by Advance when the timer fires, it can schedule and cancel timers (itself included)</param>
+		void Schedule(Timer& timer, Clock::time_point due, std::function<void()> on_fired);
+
+		/// <summary>
+		/// Cancels the timer if it's scheduled.
+		/// </summary>
+		void Cancel(Timer& timer);
+
+		/// <summary>
+		/// Fires the timers due by now.
+		/// </summary>
+		/// <returns>The number of timers fired</returns>
+		size_t Advance(Clock::time_point now);
+
+		/// <summary>
+		/// Returns when Advance should be called next: the due time of the earliest timer, or earlier for the timers that still have to move down a level. nullopt if no timer is scheduled.
+		/// </summary>
+		std::optional<Clock::time_point> GetNextDue() const;
+
+		/// <summary>
+		/// Returns the number of timers scheduled.
+		/// </summary>
+		size_t size() const { return Count; }
+
+		/// <summary>
+		/// Returns the activity of the wheel so far. Thread-safe.
+		/// </summary>
+		TimerStats GetStats() const;
+	private:
+		/// <summary>
+		/// (internal) Links the timer in the slot matching its due tick, or the earliest tick if it's due before.
+		/// <para>The earliest tick is the next one when scheduling, and the current one when cascading: Advance fires the current slot right after cascading into it.</para>
+		/// </summary>
+		void Insert(Timer& timer, std::uint64_t earliest);
+		/// <summary>
+		/// (internal) Unlinks the timer from its slot.
+		/// </summary>
+		void Unlink(Timer& timer);
+		/// <summary>
+		/// (internal) Moves the timers of a slot of a higher level down, once the current tick reached the start of the slot.
+		/// </summary>
+		void Cascade(size_t level, size_t slot);
+		/// <summary>
+		/// (internal) Returns the tick containing the time point.
+		/// </summary>
+		std::uint64_t ToTick(Clock::time_point time) const;
+		/// <summary>
+		/// (internal) Returns the head of the list of a slot.
+		/// </summary>
+		Link* Head(size_t level, size_t slot) { return &Wheels[level][slot]; }
+		/// <summary>
+		/// (internal) Returns the timer of a link which isn't a slot head.
+		/// </summary>
+		static Timer& ToTimer(Link* link) { return static_cast<Timer&>(*link); }
+
+		Clock::time_point Start;
+		/// <summary>
+		/// (internal) The last tick processed by Advance.
+		/// </summary>
+		std::uint64_t Current = 0;
+		size_t Count = 0;
+		std::array<std::array<Link, Slots>, Levels> Wheels;
+		/// <summary>
+		/// (internal) A bit per slot telling whether it holds timers, so GetNextDue finds the next one without visiting the slots.
+		/// </summary>
+		std::array<std::uint64_t, Levels> Occupied{};
+
+		std::atomic<size_t> ScheduledCount = 0;
+		std::atomic<size_t> CancelledCount = 0;
+		std::atomic<size_t> FiredCount = 0;
+		std::atomic<size_t> CascadeCount = 0;
+		std::atomic<long long> TotalLagMicroseconds = 0;
+		std::atomic<long long> MaxLagMicroseconds = 0;
+	};
+}
\ No newline at end of file
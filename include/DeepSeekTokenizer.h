@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include "DeepSeekMessage.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// A local byte-level BPE tokenizer, used to know how many tokens a message or a history costs before sending it.
+	/// <para>It loads the DeepSeek tokenizer files from disk, you can find them in the model repositories on Hugging Face (tokenizer.json).</para>
+	/// <para>The pre-tokenization follows the DeepSeek-V3 split rules (digit groups of up to 3, CJK runs, words, punctuation, whitespace).</para>
+	/// <para>All methods are thread-safe.</para>
+	/// </summary>
+	class Tokenizer {
+	public:
+		/// <summary>
+		/// Loads the tokenizer from a Hugging Face tokenizer.json file.
+		/// </summary>
+		/// <param name="tokenizer_json_path">The path to tokenizer.json</param>
+		Tokenizer(const std::string& tokenizer_json_path);
+
+		/// <summary>
+		/// Loads the tokenizer from a vocabulary file (JSON object mapping tokens to ids) and a merges file (one "left right" pair per line).
+		/// </summary>
+		/// <param name="vocab_path">The path to vocab.json</param>
+		/// <param name="merges_path">The path to merges.txt</param>
+		Tokenizer(const std::string& vocab_path, const std::string& merges_path);
+
+		/// <summary>
+		/// Converts text to token ids.
+		/// </summary>
+		/// <param name="text">UTF-8 text</param>
+		/// <returns></returns>
+		std::vector<int> Encode(std::string_view text) const;
+
+		/// <summary>
+		/// Splits the text into the pieces the merges run on, following the DeepSeek-V3 split rules.
+		/// </summary>
+		/// <param name="text">UTF-8 text</param>
+		/// <returns>Views of the text</returns>
+		static std::vector<std::string_view> Split(std::string_view text);
+
+		/// <summary>
+		/// Counts the tokens of the text, without the chat template.
+		/// </summary>
+		/// <param name="text">UTF-8 text</param>
+		/// <returns></returns>
+		size_t CountTokens(std::string_view text) const;
+
+		/// <summary>
+		/// Counts the tokens a message costs in a request, including its role markers from the chat template.
+		/// <para>The count is memoized on the message, so counting it again is free until its content changes.</para>
+		/// </summary>
+		/// <param name="message">The message</param>
+		/// <returns></returns>
+		size_t CountTokens(const Message& message) const;
+
+		/// <summary>
+		/// Counts the prompt tokens a whole history costs in a request, including the chat template.
+		/// </summary>
+		/// <param name="messages">The history</param>
+		/// <returns></returns>
+		size_t CountTokens(const std::vector<Message>& messages) const;
+
+		/// <summary>
+		/// (internal) The tokens added by the chat template around a message with the given role.
+		/// </summary>
+		static size_t MessageOverhead(Message::Role role);
+
+		/// <summary>
+		/// (internal) The tokens added by the chat template around the whole history (begin of sentence + the assistant prompt).
+		/// </summary>
+		static constexpr size_t HistoryOverhead = 2;
+	private:
+		struct StringHash {
+			using is_transparent = void;
+			size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+		};
+		using VocabMap = std::unordered_map<std::string, int, StringHash, std::equal_to<>>;
+
+		struct MergeRule {
+			int Rank;
+			int Merged;
+		};
+
+		struct CacheShard {
+			std::mutex Mutex;
+			std::unordered_map<std::string, std::vector<int>, StringHash, std::equal_to<>> Tokens;
+		};
+
+		/// <summary>
+		/// (internal) Resolves the merges and the byte tokens once the vocabulary is loaded.
+		/// </summary>
+		void Initialize(const std::vector<std::pair<std::string, std::string>>& merges);
+		/// <summary>
+		/// (internal) Runs the BPE merges on a single piece.
+		/// </summary>
+		void EncodePiece(std::string_view piece, std::vector<int>& output) const;
+		/// <summary>
+		/// (internal) Encodes a single piece, going through the vocabulary and the cache before running the merges.
+		/// </summary>
+		void EncodeCached(std::string_view piece, std::vector<int>& output) const;
+		/// <summary>
+		/// (internal) Counts the tokens of a single piece, going through the vocabulary and the cache before running the merges.
+		/// </summary>
+		size_t CountPiece(std::string_view piece) const;
+		/// <summary>
+		/// (internal) Returns the cache shard responsible for the piece.
+		/// </summary>
+		CacheShard& ShardFor(std::string_view piece) const;
+
+		static constexpr size_t CacheShards = 16;
+		static constexpr size_t MaxCacheEntriesPerShard = 8192;
+
+		/// <summary>
+		/// (internal) Identifies the tokenizer in the counts memoized on messages, never reused by another tokenizer. 0 once the ids ran out: nothing is memoized.
+		/// </summary>
+		std::uint32_t Id = 0;
+		VocabMap Vocab;
+		std::unordered_map<unsigned long long, MergeRule> Merges;
+		int ByteTokens[256];
+		std::unique_ptr<CacheShard[]> Cache;
+	};
+}
\ No newline at end of file
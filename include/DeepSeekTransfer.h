@@ -0,0 +1,174 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <optional>
+#include <exception>
+#include <atomic>
+#include "DeepSeekConnection.h"
+#include "DeepSeekHeaders.h"
+#include "DeepSeekRequestBody.h"
+#include "DeepSeekStream.h"
+#include "DeepSeekUsage.h"
+#include "DeepSeekBalance.h"
+#include "DeepSeekRequestOptions.h"
+#include "DeepSeekTimerWheel.h"
+#include "DeepSeekScheduler.h"
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// (internal) The curl callbacks of a Transfer, defined with the transfer.
+	/// </summary>
+	struct TransferCallbacks;
+
+	/// <summary>
+	/// (internal) A request on a borrowed connection: configures its curl handle, and decodes the response once curl is done with it.
+	/// <para>The blocking calls perform it on their own thread, the asynchronous ones hand it to a Reactor.</para>
+	/// </summary>
+	class Transfer : public std::enable_shared_from_this<Transfer> {
+	public:
+		/// <summary>
+		/// Borrows a connection from the pool for the request.
+		/// </summary>
+		/// <param name="pool">The connections of the API instance</param>
+		/// <param name="headers">The header lists of the API instance, kept alive until the request is done</param>
+		Transfer(std::shared_ptr<ConnectionPool> pool, std::shared_ptr<const RequestHeaders> headers);
+		Transfer(const Transfer&) = delete;
+		Transfer& operator=(const Transfer&) = delete;
+		/// <summary>
+		/// Gives the slot of its scheduler back, if it still holds one.
+		/// </summary>
+		virtual ~Transfer();
+
+		/// <summary>
+		/// Prepares a completion request uploading the body.
+		/// <para>With on_delta, the body must request a streamed response, which is decoded as it arrives. on_delta is called on the thread performing the transfer.</para>
+		/// </summary>
+		void PrepareCompletion(RequestBody body, DeltaCallback on_delta = {});
+
+		/// <summary>
+		/// Prepares a balance request.
+		/// </summary>
+		void PrepareBalance();
+
+		/// <summary>
+		/// Returns the prepared curl easy handle (a CURL*).
+		/// </summary>
+		void* GetHandle() const { return Borrowed->GetHandle(); }
+
+		/// <summary>
+		/// Makes the request take a slot of the scheduler before it's sent: Perform waits for it, a reactor queues the request until it got it.
+		/// <para>Call it once the request is prepared.</para>
+		/// </summary>
+		/// <param name="scheduler">The scheduler of the API instance</param>
+		/// <param name="priority">The class of the request</param>
+		/// <param name="tenant">The tenant of the request</param>
+		/// <param name="tag">The tag of the request</param>
+		/// <param name="prompt_tokens">The prompt tokens of the request, as counted for the context window: its cost along with the completion predicted for its tag</param>
+		void SetScheduler(std::shared_ptr<RequestScheduler> scheduler, RequestPriority priority, std::string tenant, std::string tag, size_t prompt_tokens);
+
+		/// <summary>
+		/// Performs the transfer on the calling thread and returns its CURLcode, once it got a slot of its scheduler (if any).
+		/// </summary>
+		int Perform();
+
+		/// <summary>
+		/// Returns the content of the first choice once the completion request is done.
+		/// <para>Rethrows the exception that stopped the transfer (invalid body, delta callback), or throws std::runtime_error if it failed or the server answered with an error.</para>
+		/// </summary>
+		/// <param name="result">The CURLcode the transfer ended with</param>
+		/// <param name="usage">Optional: Receives the token usage reported for the request.</param>
+		std::string GetCompletion(int result, Usage* usage);
+
+		/// <summary>
+		/// Returns the balance once the balance request is done, throws std::runtime_error if it failed.
+		/// </summary>
+		/// <param name="result">The CURLcode the transfer ended with</param>
+		Balance GetBalance(int result);
+
+		/// <summary>
+		/// Stops the transfer at its next callback, it then ends with an error. Thread-safe.
+		/// </summary>
+		void Cancel() { Cancelled = true; }
+
+		/// <summary>
+		/// Called by the Reactor on its thread once curl is done with the transfer.
+		/// </summary>
+		/// <param name="result">The CURLcode the transfer ended with</param>
+		virtual void OnDone(int result) noexcept { (void)result; }
+
+		/// <summary>
+		/// The deadlines and retries of the request, applied by the reactor (a blocking request ignores them).
+		/// </summary>
+		RequestOptions Options;
+	private:
+		friend struct TransferCallbacks;
+		friend class ReactorCore;
+
+		/// <summary>
+		/// (internal) Decides whether the attempt that ended with result is retried (a transient failure, before any delta was handed out, with retries left),
+		/// and if so rewinds the body and clears the response for the next attempt.
+		/// </summary>
+		bool PrepareRetry(int result);
+		/// <summary>
+		/// (internal) Records why the reactor aborts the transfer: it's the error thrown unless the attempt is retried (if retryable allows it).
+		/// </summary>
+		void Expire(const std::string& message, bool retryable);
+		/// <summary>
+		/// (internal) Called by the write callbacks when the first token of the attempt arrived.
+		/// </summary>
+		void OnFirstToken();
+
+		/// <summary>
+		/// (internal) Throws the error the transfer ended with, if any.
+		/// </summary>
+		void CheckResult(int result) const;
+
+		// The pool is declared first to be destroyed last, after the connection went back to it
+		std::shared_ptr<ConnectionPool> Pool;
+		ConnectionPool::Lease Borrowed;
+		std::shared_ptr<const RequestHeaders> Headers;
+		std::optional<RequestBody> Body;
+		DeltaCallback OnDelta;
+		std::optional<StreamDecoder> Decoder;
+		/// <summary>
+		/// (internal) The exception thrown by a callback, which aborted the transfer.
+		/// </summary>
+		std::exception_ptr Error;
+		/// <summary>
+		/// (internal) Set when Error is an expired first token timeout, which doesn't prevent a retry.
+		/// </summary>
+		bool ErrorRetryable = false;
+		std::atomic<bool> Cancelled = false;
+
+		// The timing of an asynchronous request, only used by the reactor thread
+		TimerWheel* Timers = nullptr;
+		TimerWheel::Clock::time_point SubmitTime;
+		TimerWheel::Timer DeadlineTimer;
+		/// <summary>
+		/// (internal) Times out the first token of the attempt in flight, then the backoff before the next one.
+		/// </summary>
+		TimerWheel::Timer AttemptTimer;
+		size_t Attempts = 0;
+		bool Received = false;
+		/// <summary>
+		/// (internal) Links and keeps alive a transfer dropped from the submission queue, until the reactor thread fails it.
+		/// </summary>
+		Transfer* NextDropped = nullptr;
+		std::shared_ptr<Transfer> DroppedSelf;
+
+		std::shared_ptr<RequestScheduler> Scheduler;
+		RequestScheduler::Ticket Ticket;
+		/// <summary>
+		/// (internal) Links and keeps alive a transfer that got its slot while it waited in the scheduler, until the reactor thread starts it.
+		/// </summary>
+		Transfer* NextGranted = nullptr;
+		std::shared_ptr<Transfer> GrantedSelf;
+		/// <summary>
+		/// (internal) Links and keeps alive a transfer cancelled through ReactorCore::Cancel, until the reactor thread ends it. Set once, by the first call.
+		/// </summary>
+		std::atomic<bool> CancelPushed = false;
+		Transfer* NextCancelled = nullptr;
+		std::shared_ptr<Transfer> CancelledSelf;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+namespace inx::DeepSeek {
+	/// <summary>
+	/// Represents the token usage reported by the API for a single completion request.
+	/// <para>DeepSeek caches prompt prefixes on its side, the cache hit and miss counters tell you how much of the prompt was served from that cache.</para>
+	/// </summary>
+	class Usage {
+	public:
+		/// <summary>
+		/// The number of tokens in the prompt (cache hits + cache misses).
+		/// </summary>
+		int PromptTokens = 0;
+		/// <summary>
+		/// The number of tokens generated for the completion.
+		/// </summary>
+		int CompletionTokens = 0;
+		/// <summary>
+		/// The total number of tokens used by the request (prompt + completion).
+		/// </summary>
+		int TotalTokens = 0;
+		/// <summary>
+		/// The number of prompt tokens that were served from the provider's prefix cache.
+		/// </summary>
+		int PromptCacheHitTokens = 0;
+		/// <summary>
+		/// The number of prompt tokens that were not found in the provider's prefix cache.
+		/// </summary>
+		int PromptCacheMissTokens = 0;
+		/// <summary>
+		/// The number of prompt tokens the context window dropped before sending the request (see API::SetContextWindow).
+		/// <para>Unlike the other counters, this one is computed locally, with the tokenizer if one is set and estimated otherwise.</para>
+		/// </summary>
+		int TrimmedPromptTokens = 0;
+	};
+}
\ No newline at end of file
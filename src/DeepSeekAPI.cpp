@@ -1,10 +1,99 @@
 #include "DeepSeekAPI.h"
-#include <curl/curl.h>
+#include "DeepSeekJson.h"
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+// Views the messages of a vector or a conversation, to walk them with random access without copying them
+template <class Messages>
+static std::vector<inx::DeepSeek::MessageView> ViewMessages(const Messages& messages)
+{
+	std::vector<inx::DeepSeek::MessageView> views;
+	views.reserve(messages.size());
+	for (const auto& message : messages) {
+		views.emplace_back(message);
+	}
+	return views;
+}
+
+// The summary request, sent through the reactor of the instance
+struct inx::DeepSeek::API::CompactionTask : public CompletionOperation {
+	using CompletionOperation::CompletionOperation;
+
+	std::mutex ResultMutex;
+	std::condition_variable Condition;
+	bool Done = false;
+	std::optional<std::string> Summary;
+	Usage SummaryUsage;
+	// The summarized messages are History[Begin, End)
+	size_t Begin = 0;
+	size_t End = 0;
+	Message::Role SummaryRole = Message::Role::System;
+	std::string SummaryHeader;
+
+	// A failed summary only leaves the history as it is
+	void Fail()
+	{
+		std::lock_guard lock(ResultMutex);
+		Done = true;
+		Condition.notify_all();
+	}
+
+	void Finish(int result) override
+	{
+		std::optional<std::string> summary;
+		Usage usage;
+		try {
+			summary = GetCompletion(result, &usage);
+		}
+		catch (const std::exception&) {
+		}
+		std::lock_guard lock(ResultMutex);
+		Summary = std::move(summary);
+		SummaryUsage = usage;
+		Done = true;
+		Condition.notify_all();
+	}
+};
+
+inx::DeepSeek::API::CompactionHandle& inx::DeepSeek::API::CompactionHandle::operator=(const CompactionHandle& other)
+{
+	if (this != &other) {
+		Cancel();
+	}
+	return *this;
+}
+
+inx::DeepSeek::API::CompactionHandle& inx::DeepSeek::API::CompactionHandle::operator=(CompactionHandle&& other) noexcept
+{
+	if (this != &other) {
+		Cancel();
+		Task = std::move(other.Task);
+	}
+	return *this;
+}
+
+inx::DeepSeek::API::CompactionHandle::~CompactionHandle()
+{
+	Cancel();
+}
+
+void inx::DeepSeek::API::CompactionHandle::Cancel()
+{
+	if (Task) {
+		// Does nothing once the summary arrived
+		Task->Abandon();
+		Task.reset();
+	}
+}
 
 inx::DeepSeek::API::API(std::string_view api_key, Model model, std::string_view system_prompt)
 {
 	APIKey = api_key;
-	SystemPrompt = system_prompt;
+	Headers = std::make_shared<const RequestHeaders>(APIKey, std::vector<CustomHeader>());
+	SystemPrompt = SharedText::Intern(system_prompt);
     SelectedModel = model;
 	ResetMessageHistory();
 }
@@ -21,17 +110,48 @@ std::string inx::DeepSeek::API::SingleRequest(const std::string& api_key, Model
 	if (top_p.has_value()) {
 		instance.SetTopP(top_p);
 	}
-	return instance.AddMessageAndGetCompletion(user_message);
+	return instance.GetSingleCompletion(system_prompt, user_message);
 }
 
 void inx::DeepSeek::API::AddMessage(const std::string& message)
 {
-	History.emplace_back(Message::Role::User, message);
+	if (History.GetArena()) {
+		History.push_back(History.GetArena()->MakeMessage(Message::Role::User, message));
+	}
+	else {
+		History.emplace_back(Message::Role::User, message);
+	}
+	HistoryTokens += CountMessageTokens(History.back());
+	OnHistoryAppended();
+}
+
+void inx::DeepSeek::API::AddMessage(std::string&& message)
+{
+	History.push_back(Message(Message::Role::User, std::move(message)));
+	HistoryTokens += CountMessageTokens(History.back());
+	OnHistoryAppended();
 }
 
 void inx::DeepSeek::API::AddCustomMessage(const Message& message)
 {
-	History.push_back(message);
+	// Copied straight into the arena, the copy is external content that push_back keeps as it is
+	History.push_back(History.GetArena() ? History.GetArena()->Adopt(message) : message);
+	HistoryTokens += CountMessageTokens(History.back());
+	OnHistoryAppended();
+}
+
+void inx::DeepSeek::API::AddCustomMessage(Message&& message)
+{
+	History.push_back(std::move(message));
+	HistoryTokens += CountMessageTokens(History.back());
+	OnHistoryAppended();
+}
+
+void inx::DeepSeek::API::AddFile(const std::string& path, Message::Role role)
+{
+	std::shared_ptr<const MappedFile> file = MappedFile::Open(path);
+	std::string_view content = file->View();
+	AddCustomMessage(Message(role, content, std::move(file)));
 }
 
 std::string inx::DeepSeek::API::AddMessageAndGetCompletion(const std::string& message)
@@ -40,99 +160,609 @@ std::string inx::DeepSeek::API::AddMessageAndGetCompletion(const std::string& me
 	return GetCompletion();
 }
 
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-    std::string* s = static_cast<std::string*>(userp);
-    size_t totalSize = size * nmemb;
-    s->append(static_cast<char*>(contents), totalSize);
-    return totalSize;
+std::string inx::DeepSeek::API::GetCompletion() {
+	ApplyCompaction();
+	std::string response_message = Complete(ViewMessages(History), &LastUsage, HistoryTokens);
+
+	History.emplace_back(Message::Role::Assistant, response_message);
+	HistoryTokens += CountMessageTokens(History.back());
+	OnHistoryAppended();
+
+	return response_message;
 }
 
-std::string inx::DeepSeek::API::GetCompletion() {
-    CURL* curl = curl_easy_init();
-    if (!curl) {
-        throw std::runtime_error("Failed to initialize CURL");
-    }
+std::string inx::DeepSeek::API::GetCompletion(const std::vector<Message>& messages, Usage* usage) const
+{
+	return Complete(ViewMessages(messages), usage);
+}
 
-    std::string url = "https://api.deepseek.com/chat/completions";
-    std::string response_string;
-    std::string body_str;
+std::string inx::DeepSeek::API::GetCompletion(const Conversation& conversation, Usage* usage) const
+{
+	return Complete(ViewMessages(conversation), usage);
+}
 
-    nlohmann::json body;
-    body["model"] = ModelToString(SelectedModel);
+std::string inx::DeepSeek::API::GetCompletion(std::span<const MessageView> messages, Usage* usage) const
+{
+	return Complete(messages, usage);
+}
+
+std::string inx::DeepSeek::API::StreamCompletion(const DeltaCallback& on_delta)
+{
+	ApplyCompaction();
+	std::string response_message = Complete(ViewMessages(History), &LastUsage, HistoryTokens, {}, &on_delta);
+
+	History.emplace_back(Message::Role::Assistant, response_message);
+	HistoryTokens += CountMessageTokens(History.back());
+	OnHistoryAppended();
+
+	return response_message;
+}
+
+std::string inx::DeepSeek::API::StreamCompletion(std::span<const MessageView> messages, const DeltaCallback& on_delta, Usage* usage) const
+{
+	return Complete(messages, usage, {}, {}, &on_delta);
+}
 
-	if (MaxTokens.has_value()) {
-		body["max_tokens"] = MaxTokens.value();
+inx::DeepSeek::CompletionAwaitable inx::DeepSeek::API::GetCompletionAsync(std::span<const MessageView> messages, Usage* usage, const RequestOptions& options) const
+{
+	auto operation = std::make_shared<CompletionOperation>(Connections, Headers);
+	operation->Options = options;
+	operation->Views.assign(messages.begin(), messages.end());
+	return PrepareCompletionAsync(std::move(operation), usage);
+}
+
+inx::DeepSeek::CompletionAwaitable inx::DeepSeek::API::GetCompletionAsync(Conversation conversation, Usage* usage, const RequestOptions& options) const
+{
+	auto operation = std::make_shared<CompletionOperation>(Connections, Headers);
+	operation->Options = options;
+	operation->Messages = std::move(conversation);
+	operation->Views = ViewMessages(operation->Messages);
+	return PrepareCompletionAsync(std::move(operation), usage);
+}
+
+inx::DeepSeek::DeltaStream inx::DeepSeek::API::StreamCompletionAsync(std::span<const MessageView> messages, const RequestOptions& options) const
+{
+	auto operation = std::make_shared<StreamOperation>(Connections, Headers);
+	operation->Options = options;
+	operation->Views.assign(messages.begin(), messages.end());
+	return PrepareStreamAsync(std::move(operation));
+}
+
+inx::DeepSeek::DeltaStream inx::DeepSeek::API::StreamCompletionAsync(Conversation conversation, const RequestOptions& options) const
+{
+	auto operation = std::make_shared<StreamOperation>(Connections, Headers);
+	operation->Options = options;
+	operation->Messages = std::move(conversation);
+	operation->Views = ViewMessages(operation->Messages);
+	return PrepareStreamAsync(std::move(operation));
+}
+
+void inx::DeepSeek::API::PrepareOperation(CompletionOperation& operation) const
+{
+	WindowSelection window = SelectWindow(operation.Views);
+	PrepareTransfer(operation, operation.Views, window, GetRequestSettings(operation.Options));
+	operation.TrimmedTokens = window.TrimmedTokens;
+}
+
+void inx::DeepSeek::API::PrepareTransfer(Transfer& transfer, std::span<const MessageView> messages, const WindowSelection& window, const RequestSettings& settings, DeltaCallback on_delta) const
+{
+	bool stream = static_cast<bool>(on_delta);
+	transfer.PrepareCompletion(BuildRequestBody(messages, window, settings, stream), std::move(on_delta));
+	if (Scheduler) {
+		transfer.SetScheduler(Scheduler, settings.Priority, settings.Tenant, settings.Tag, CountWindowTokens(messages, window));
 	}
-	if (Temperature.has_value()) {
-		body["temperature"] = Temperature.value();
+}
+
+inx::DeepSeek::CompletionAwaitable inx::DeepSeek::API::PrepareCompletionAsync(std::shared_ptr<CompletionOperation> operation, Usage* usage) const
+{
+	PrepareOperation(*operation);
+	operation->UsageOutput = usage;
+	return CompletionAwaitable(std::move(operation), GetReactorCore());
+}
+
+inx::DeepSeek::DeltaStream inx::DeepSeek::API::PrepareStreamAsync(std::shared_ptr<StreamOperation> operation) const
+{
+	WindowSelection window = SelectWindow(operation->Views);
+	StreamOperation* stream = operation.get();
+	PrepareTransfer(*operation, operation->Views, window, GetRequestSettings(operation->Options), [stream](std::string_view delta) { stream->Deliver(delta); });
+	operation->TrimmedTokens = window.TrimmedTokens;
+	return DeltaStream(std::move(operation), GetReactorCore());
+}
+
+std::string inx::DeepSeek::API::Complete(std::span<const MessageView> messages, Usage* usage, std::optional<size_t> known_tokens, std::optional<int> max_tokens, const DeltaCallback* on_delta) const
+{
+	return Complete(messages, SelectWindow(messages, known_tokens), usage, max_tokens, on_delta);
+}
+
+std::string inx::DeepSeek::API::Complete(std::span<const MessageView> messages, const WindowSelection& window, Usage* usage, std::optional<int> max_tokens, const DeltaCallback* on_delta) const
+{
+	RequestSettings settings = GetRequestSettings();
+	if (max_tokens.has_value()) {
+		settings.MaxTokens = max_tokens;
 	}
-	if (TopP.has_value()) {
-		body["top_p"] = TopP.value();
+	Transfer transfer(Connections, Headers);
+	PrepareTransfer(transfer, messages, window, settings, on_delta ? DeltaCallback(std::ref(*on_delta)) : DeltaCallback());
+	std::string response_message = transfer.GetCompletion(transfer.Perform(), usage);
+	if (usage) {
+		usage->TrimmedPromptTokens = static_cast<int>(window.TrimmedTokens);
 	}
+	return response_message;
+}
 
-    nlohmann::json messages = nlohmann::json::array();
-    for (const auto& message : History) {
-        messages.push_back(message.ToJSON());
-    }
-    body["messages"] = messages;
-    body_str = body.dump();
+inx::DeepSeek::API::RequestSettings inx::DeepSeek::API::GetRequestSettings(const RequestOptions& options) const
+{
+	return RequestSettings{ SelectedModel, MaxTokens, Temperature, TopP, options.Priority.value_or(Priority), options.Tenant.value_or(Tenant), options.Tag.value_or(Tag) };
+}
 
-    struct curl_slist* headers = nullptr;
-    std::string auth_header = "Authorization: Bearer " + APIKey;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
-    headers = curl_slist_append(headers, auth_header.c_str());
+inx::DeepSeek::API::WindowSelection inx::DeepSeek::API::SelectWindow(std::span<const MessageView> messages, std::optional<size_t> known_tokens) const
+{
+	const size_t count = messages.size();
+	WindowSelection selection{ count, count, 0, std::nullopt };
+	if (!Window.has_value() || Window->MaxPromptTokens == 0 || count == 0) {
+		return selection;
+	}
+	const size_t budget = Window->MaxPromptTokens;
+	if (known_tokens.has_value() && known_tokens.value() <= budget) {
+		selection.PromptTokens = known_tokens;
+		return selection;
+	}
+
+	// prefix[i] is the token count of the messages before i, the counts are memoized so this is cheap after the first request
+	std::vector<size_t> prefix(count + 1, 0);
+	for (size_t i = 0; i < count; i++) {
+		prefix[i + 1] = prefix[i] + CountMessageTokens(messages[i]);
+	}
+	const size_t total = Tokenizer::HistoryOverhead + prefix[count];
+	if (total <= budget) {
+		selection.PromptTokens = total;
+		return selection;
+	}
+	auto cost = [&](size_t head_end, size_t tail_begin) {
+		return Tokenizer::HistoryOverhead + prefix[head_end] + (prefix[count] - prefix[tail_begin]);
+	};
+
+	size_t system_end = 0;
+	while (system_end < count && messages[system_end].role == Message::Role::System) {
+		system_end++;
+	}
+	std::vector<size_t> turns;
+	for (size_t i = system_end; i < count; i++) {
+		if (i == system_end || messages[i].role == Message::Role::User) {
+			turns.push_back(i);
+		}
+	}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body_str.c_str());
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, body_str.size());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
+	// Every strategy comes down to keeping a head and the longest tail that fits: the one from the earliest allowed tail start that fits
+	std::vector<size_t> tail_starts;
+	size_t head_end = system_end;
+	switch (Window->Strategy) {
+	case TruncationStrategy::DropOldest:
+		tail_starts = turns;
+		break;
+	case TruncationStrategy::KeepFirstAndLast: {
+		size_t keep_last = std::max<size_t>(Window->KeepLastTurns, 1);
+		head_end = Window->KeepFirstTurns < turns.size() ? turns[Window->KeepFirstTurns] : count;
+		size_t last_start = keep_last <= turns.size() ? turns[turns.size() - keep_last] : system_end;
+		for (size_t start : turns) {
+			if (start >= head_end && start <= last_start) {
+				tail_starts.push_back(start);
+			}
+		}
+		break;
+	}
+	case TruncationStrategy::SlidingWindow:
+		for (size_t i = system_end; i < count; i++) {
+			tail_starts.push_back(i);
+		}
+		break;
+	}
+	if (tail_starts.empty()) {
+		tail_starts.push_back(head_end);
+	}
 
-    CURLcode res = curl_easy_perform(curl);
+	for (size_t start : tail_starts) {
+		if (cost(head_end, start) <= budget) {
+			selection.HeadEnd = head_end;
+			selection.TailBegin = start;
+			selection.TrimmedTokens = total - cost(head_end, start);
+			selection.PromptTokens = cost(head_end, start);
+			return selection;
+		}
+	}
+	throw std::runtime_error("The request doesn't fit in the context window: " + std::to_string(cost(head_end, tail_starts.back()))
+		+ " prompt tokens after truncation, the budget is " + std::to_string(budget));
+}
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+size_t inx::DeepSeek::API::CountWindowTokens(std::span<const MessageView> messages, const WindowSelection& window) const
+{
+	if (window.PromptTokens.has_value()) {
+		return window.PromptTokens.value();
+	}
+	size_t total = Tokenizer::HistoryOverhead;
+	for (size_t i = 0; i < messages.size(); i++) {
+		if (i < window.HeadEnd || i >= window.TailBegin) {
+			total += CountMessageTokens(messages[i]);
+		}
+	}
+	return total;
+}
 
-    if (res != CURLE_OK) {
-        throw std::runtime_error("CURL request failed: " + std::string(curl_easy_strerror(res)));
-    }
+inx::DeepSeek::RequestBody inx::DeepSeek::API::BuildRequestBody(std::span<const MessageView> messages, const WindowSelection& window, const RequestSettings& settings, bool stream) const
+{
+	// Written directly from the views, with the keys in the order nlohmann::json would dump them.
+	// The contents are only viewed, they're escaped while curl uploads the body.
+	RequestBody body;
+	body.AppendLiteral("{");
+	if (settings.MaxTokens.has_value()) {
+		body.AppendLiteral("\"max_tokens\":");
+		body.AppendLiteral(std::to_string(settings.MaxTokens.value()));
+		body.AppendLiteral(",");
+	}
+	body.AppendLiteral("\"messages\":[");
+	bool first = true;
+	auto write_message = [&](const MessageView& message) {
+		if (!first) {
+			body.AppendLiteral(",");
+		}
+		first = false;
+		body.AppendLiteral("{\"content\":");
+		if (message.Shared) {
+			body.AppendView(message.Shared->GetEscapedJSON());
+		}
+		else {
+			body.AppendString(message.content);
+		}
+		body.AppendLiteral(",\"role\":\"");
+		body.AppendLiteral(RoleToString(message.role));
+		body.AppendLiteral("\"}");
+	};
+	for (size_t i = 0; i < window.HeadEnd; i++) {
+		write_message(messages[i]);
+	}
+	for (size_t i = window.TailBegin; i < messages.size(); i++) {
+		write_message(messages[i]);
+	}
+	body.AppendLiteral("],\"model\":");
+	std::string model;
+	AppendJsonString(model, ModelToString(settings.SelectedModel));
+	body.AppendLiteral(model);
+	if (stream) {
+		body.AppendLiteral(",\"stream\":true,\"stream_options\":{\"include_usage\":true}");
+	}
+	if (settings.Temperature.has_value()) {
+		body.AppendLiteral(",\"temperature\":");
+		body.AppendLiteral(nlohmann::json(settings.Temperature.value()).dump());
+	}
+	if (settings.TopP.has_value()) {
+		body.AppendLiteral(",\"top_p\":");
+		body.AppendLiteral(nlohmann::json(settings.TopP.value()).dump());
+	}
+	body.AppendLiteral("}");
+	return body;
+}
 
-    nlohmann::json json_response = nlohmann::json::parse(response_string);
-    std::string response_message = json_response["choices"][0]["message"]["content"].get<std::string>();
-    
-    History.emplace_back(Message::Role::Assistant, response_message);
+std::string inx::DeepSeek::API::GetSingleCompletion(std::string_view system_prompt, std::string_view user_message, Usage* usage) const
+{
+	const MessageView messages[] = { { Message::Role::System, system_prompt }, { Message::Role::User, user_message } };
+	return Complete(messages, usage);
+}
 
-    return response_message;
+inx::DeepSeek::Usage inx::DeepSeek::API::WarmPrefix(const std::vector<Message>& messages) const
+{
+	// Sent whole, without the window: the point is to cache exactly this prefix
+	std::vector<MessageView> views = ViewMessages(messages);
+	Usage usage;
+	Complete(views, WindowSelection{ views.size(), views.size(), 0, std::nullopt }, &usage, 1);
+	return usage;
 }
 
-std::string inx::DeepSeek::API::GetSingleCompletion(const std::string& system_prompt, const std::string& user_message)
+std::shared_future<inx::DeepSeek::Usage> inx::DeepSeek::API::WarmPrefixAsync(std::vector<Message> messages) const
 {
-    std::vector<Message> previous_history = History;
-	ResetMessageHistory(system_prompt);
-	AddMessage(user_message);
-	std::string response = GetCompletion();
-	History = previous_history;
-	return response;
+	return std::async(std::launch::async, [this, messages = std::move(messages)]() {
+		return WarmPrefix(messages);
+	}).share();
 }
 
 void inx::DeepSeek::API::SetMessageHistory(const std::vector<Message>& new_history)
 {
-	History = new_history;
+	Conversation history = NewHistory();
+	for (const auto& message : new_history) {
+		history.push_back(message);
+	}
+	SetMessageHistory(std::move(history));
+}
+
+void inx::DeepSeek::API::SetMessageHistory(std::vector<Message>&& new_history)
+{
+	if (!HistoryArenaBytes.has_value()) {
+		SetMessageHistory(Conversation(std::move(new_history)));
+		return;
+	}
+	Conversation history = NewHistory();
+	for (auto& message : new_history) {
+		history.push_back(std::move(message));
+	}
+	SetMessageHistory(std::move(history));
+}
+
+void inx::DeepSeek::API::SetMessageHistory(Conversation new_history)
+{
+	History = std::move(new_history);
+	PendingCompaction.Cancel();
+	SummaryPosition.reset();
+	RecountHistory();
 }
 
 void inx::DeepSeek::API::ResetMessageHistory(std::optional<std::string> new_system_prompt)
 {
-	History.clear();
+	History = NewHistory();
 	if (new_system_prompt.has_value()) {
-		SystemPrompt = new_system_prompt.value();
+		SystemPrompt = SharedText::Intern(new_system_prompt.value());
 	}
 	History.emplace_back(Message::Role::System, SystemPrompt);
+	PendingCompaction.Cancel();
+	SummaryPosition.reset();
+	RecountHistory();
+}
+
+std::vector<inx::DeepSeek::Message> inx::DeepSeek::API::GetMessageHistory() const
+{
+	return History.ToVector();
+}
+
+void inx::DeepSeek::API::SetHistoryArena(std::optional<size_t> initial_bytes)
+{
+	HistoryArenaBytes = initial_bytes;
+	Conversation history = NewHistory();
+	for (const auto& message : History) {
+		history.push_back(message);
+	}
+	History = std::move(history);
+}
+
+inx::DeepSeek::Conversation inx::DeepSeek::API::NewHistory() const
+{
+	if (HistoryArenaBytes.has_value()) {
+		return Conversation(MessageArena::Create(HistoryArenaBytes.value()));
+	}
+	return Conversation();
+}
+
+void inx::DeepSeek::API::SetTokenizer(std::shared_ptr<const Tokenizer> tokenizer)
+{
+	TokenCounter = std::move(tokenizer);
+	RecountHistory();
+}
+
+size_t inx::DeepSeek::API::GetHistoryTokenCount() const
+{
+	return HistoryTokens;
 }
 
-const std::vector<inx::DeepSeek::Message>& inx::DeepSeek::API::GetMessageHistory() const
+size_t inx::DeepSeek::API::CountPromptTokens(std::span<const Message> messages) const
 {
-	return History;
+	size_t total = Tokenizer::HistoryOverhead;
+	for (const Message& message : messages) {
+		total += CountMessageTokens(message);
+	}
+	return total;
+}
+
+size_t inx::DeepSeek::API::CountMessageTokens(const MessageView& message) const
+{
+	if (message.Source) {
+		return CountMessageTokens(*message.Source);
+	}
+	if (TokenCounter) {
+		return TokenCounter->CountTokens(message.content) + Tokenizer::MessageOverhead(message.role);
+	}
+	return (message.content.size() + 3) / 4 + Tokenizer::MessageOverhead(message.role);
+}
+
+size_t inx::DeepSeek::API::CountMessageTokens(const Message& message) const
+{
+	if (TokenCounter) {
+		return TokenCounter->CountTokens(message);
+	}
+	return (message.GetContent().size() + 3) / 4 + Tokenizer::MessageOverhead(message.role);
+}
+
+void inx::DeepSeek::API::RecountHistory()
+{
+	// Below this, starting threads costs more than counting
+	constexpr size_t parallel_bytes = 256 * 1024;
+
+	size_t bytes = 0;
+	for (const auto& message : History) {
+		bytes += message.GetContent().size();
+	}
+	size_t thread_count = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), History.size());
+
+	size_t total = Tokenizer::HistoryOverhead;
+	if (!TokenCounter || bytes < parallel_bytes || thread_count < 2) {
+		for (const auto& message : History) {
+			total += CountMessageTokens(message);
+		}
+		HistoryTokens = total;
+		return;
+	}
+
+	// The messages are handed out one at a time, so a few huge ones don't leave the other threads idle
+	std::vector<MessageView> messages = ViewMessages(History);
+	std::atomic<size_t> next{ 0 };
+	std::vector<size_t> totals(thread_count, 0);
+	std::vector<std::exception_ptr> errors(thread_count);
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < thread_count; t++) {
+		threads.emplace_back([&, t]() {
+			try {
+				for (size_t i = next++; i < messages.size(); i = next++) {
+					totals[t] += CountMessageTokens(messages[i]);
+				}
+			}
+			catch (...) {
+				errors[t] = std::current_exception();
+				next = messages.size();
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	for (size_t t = 0; t < thread_count; t++) {
+		if (errors[t]) {
+			std::rethrow_exception(errors[t]);
+		}
+		total += totals[t];
+	}
+	HistoryTokens = total;
+}
+
+void inx::DeepSeek::API::OnHistoryAppended()
+{
+	ApplyCompaction();
+	StartCompaction();
+}
+
+void inx::DeepSeek::API::StartCompaction()
+{
+	if (!Compaction.has_value() || PendingCompaction.Task) {
+		return;
+	}
+	const CompactionPolicy& policy = Compaction.value();
+	bool over_tokens = policy.TriggerTokens > 0 && HistoryTokens > policy.TriggerTokens;
+	bool over_messages = policy.TriggerMessages > 0 && History.size() > policy.TriggerMessages;
+	if (!over_tokens && !over_messages) {
+		return;
+	}
+
+	// The previous summary sits right after the system prompt, it's folded into the new one
+	std::vector<MessageView> messages = ViewMessages(History);
+	size_t begin = 0;
+	if (SummaryPosition.has_value()) {
+		begin = SummaryPosition.value();
+	}
+	else {
+		while (begin < messages.size() && messages[begin].role == Message::Role::System) {
+			begin++;
+		}
+	}
+	size_t end = messages.size();
+	size_t kept_turns = 0;
+	while (end > begin && kept_turns < policy.KeepLastTurns) {
+		end--;
+		if (messages[end].role == Message::Role::User) {
+			kept_turns++;
+		}
+	}
+	if (end <= begin || end - begin < 2) {
+		return;
+	}
+
+	std::string transcript;
+	for (size_t i = begin; i < end; i++) {
+		const MessageView& message = messages[i];
+		transcript += message.role == Message::Role::User ? "User: " : message.role == Message::Role::Assistant ? "Assistant: " : "System: ";
+		transcript += message.content;
+		transcript += "\n\n";
+	}
+
+	// Sent like the asynchronous requests of the instance, through its connections, reactor and scheduler, with its model,
+	// in the batch class for its tenant. The tag of the policy keeps the summaries apart in the completion predictions of the scheduler.
+	// Without sampling settings or context window, and the request owns its messages, so it can outlive a reset history; it's cancelled with the instance.
+	auto task = std::make_shared<CompactionTask>(Connections, Headers);
+	task->Begin = begin;
+	task->End = end;
+	task->SummaryRole = policy.SummaryRole;
+	task->SummaryHeader = policy.SummaryHeader;
+	task->Messages.emplace_back(Message::Role::System, policy.SummaryPrompt);
+	task->Messages.emplace_back(Message::Role::User, std::move(transcript));
+	task->Views = ViewMessages(task->Messages);
+	RequestSettings settings{ SelectedModel, policy.SummaryMaxTokens, std::nullopt, std::nullopt, RequestPriority::Batch, Tenant, policy.SummaryTag };
+	WindowSelection window{ task->Views.size(), task->Views.size(), 0, std::nullopt };
+	PendingCompaction.Task = task;
+	try {
+		PrepareTransfer(*task, task->Views, window, settings);
+		task->Start(GetReactorCore(), {});
+	}
+	catch (const std::exception&) {
+		// A stopped reactor or a full submission queue
+		task->Fail();
+	}
+}
+
+void inx::DeepSeek::API::ApplyCompaction()
+{
+	if (!PendingCompaction.Task) {
+		return;
+	}
+	std::shared_ptr<CompactionTask> task = PendingCompaction.Task;
+	{
+		std::lock_guard lock(task->ResultMutex);
+		if (!task->Done) {
+			return;
+		}
+	}
+	PendingCompaction.Cancel();
+	CompactionMetrics.SummaryTokens += task->SummaryUsage.PromptTokens + task->SummaryUsage.CompletionTokens;
+	if (!task->Summary.has_value()) {
+		CompactionMetrics.FailedCompactions++;
+		return;
+	}
+
+	// The history only grew at the end since the request started, so the summarized range is still in place.
+	// It's rebuilt rather than forked from its prefix, so that the summarized messages can be freed.
+	Message summary(task->SummaryRole, task->SummaryHeader + task->Summary.value());
+	size_t summary_tokens = CountMessageTokens(summary);
+	size_t removed_tokens = 0;
+	Conversation compacted = NewHistory();
+	size_t index = 0;
+	for (const auto& message : History) {
+		if (index == task->Begin) {
+			compacted.push_back(std::move(summary));
+		}
+		if (index >= task->Begin && index < task->End) {
+			removed_tokens += CountMessageTokens(message);
+		}
+		else {
+			compacted.push_back(message);
+		}
+		index++;
+	}
+	History = std::move(compacted);
+	HistoryTokens = HistoryTokens - removed_tokens + summary_tokens;
+	SummaryPosition = task->Begin;
+
+	CompactionMetrics.Compactions++;
+	CompactionMetrics.MessagesCompacted += task->End - task->Begin;
+	CompactionMetrics.TokensSaved += static_cast<long long>(removed_tokens) - static_cast<long long>(summary_tokens);
+}
+
+bool inx::DeepSeek::API::IsCompacting() const
+{
+	if (!PendingCompaction.Task) {
+		return false;
+	}
+	std::lock_guard lock(PendingCompaction.Task->ResultMutex);
+	return !PendingCompaction.Task->Done;
+}
+
+void inx::DeepSeek::API::WaitForCompaction()
+{
+	if (!PendingCompaction.Task) {
+		return;
+	}
+	{
+		CompactionTask& task = *PendingCompaction.Task;
+		std::unique_lock lock(task.ResultMutex);
+		task.Condition.wait(lock, [&task]() { return task.Done; });
+	}
+	ApplyCompaction();
+}
+
+const inx::DeepSeek::Usage& inx::DeepSeek::API::GetLastUsage() const
+{
+	return LastUsage;
 }
 
 void inx::DeepSeek::API::SetModel(Model model)
@@ -140,34 +770,33 @@ void inx::DeepSeek::API::SetModel(Model model)
 	SelectedModel = model;
 }
 
+void inx::DeepSeek::API::SetAPIKey(std::string_view api_key)
+{
+	Headers = std::make_shared<const RequestHeaders>(api_key, Headers->GetCustomHeaders());
+	APIKey = api_key;
+}
+
+void inx::DeepSeek::API::SetCustomHeaders(std::vector<CustomHeader> headers)
+{
+	Headers = std::make_shared<const RequestHeaders>(APIKey, std::move(headers));
+}
+
 inx::DeepSeek::Balance inx::DeepSeek::API::GetBalance()
 {
-	CURL* curl = curl_easy_init();
-	if (!curl) {
-		throw std::runtime_error("Failed to initialize CURL");
-	}
-	std::string url = "https://api.deepseek.com/user/balance";
-	std::string response_string;
-	struct curl_slist* headers = nullptr;
-	std::string auth_header = "Authorization: Bearer " + APIKey;
-	headers = curl_slist_append(headers, auth_header.c_str());
-	headers = curl_slist_append(headers, "Accept: application/json");
-	curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
-	CURLcode res = curl_easy_perform(curl);
-	curl_slist_free_all(headers);
-	curl_easy_cleanup(curl);
-	if (res != CURLE_OK) {
-		throw std::runtime_error("CURL request failed: " + std::string(curl_easy_strerror(res)));
-	}
-	nlohmann::json json_response = nlohmann::json::parse(response_string);
-	Balance balance;
-	balance.IsAvailable = json_response["is_available"].get<bool>();
-	balance.Currency = json_response["balance_infos"][0]["currency"].get<std::string>();
-	balance.TotalBalance = std::stod(json_response["balance_infos"][0]["total_balance"].get<std::string>());
-	balance.GrantedBalance = std::stod(json_response["balance_infos"][0]["granted_balance"].get<std::string>());
-	balance.ToppedUpBalance = std::stod(json_response["balance_infos"][0]["topped_up_balance"].get<std::string>());
-	return balance;
+	Transfer transfer(Connections, Headers);
+	transfer.PrepareBalance();
+	return transfer.GetBalance(transfer.Perform());
+}
+
+inx::DeepSeek::BalanceAwaitable inx::DeepSeek::API::GetBalanceAsync(const RequestOptions& options) const
+{
+	auto operation = std::make_shared<BalanceOperation>(Connections, Headers);
+	operation->Options = options;
+	operation->PrepareBalance();
+	return BalanceAwaitable(std::move(operation), GetReactorCore());
+}
+
+std::shared_ptr<inx::DeepSeek::ReactorCore> inx::DeepSeek::API::GetReactorCore() const
+{
+	return (AsyncReactor ? AsyncReactor : Reactor::GetDefault())->GetCore();
 }
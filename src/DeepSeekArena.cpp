@@ -0,0 +1,77 @@
+#include "DeepSeekArena.h"
+#include <algorithm>
+#include <cstring>
+
+void* inx::DeepSeek::MessageArena::CountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+	std::unique_lock<std::mutex> lock;
+	if (Mutex) {
+		lock = std::unique_lock(*Mutex);
+	}
+	void* pointer = Upstream->allocate(bytes, alignment);
+	Allocations++;
+	Bytes += bytes;
+	return pointer;
+}
+
+void inx::DeepSeek::MessageArena::CountingResource::do_deallocate(void* pointer, size_t bytes, size_t alignment)
+{
+	std::unique_lock<std::mutex> lock;
+	if (Mutex) {
+		lock = std::unique_lock(*Mutex);
+	}
+	Upstream->deallocate(pointer, bytes, alignment);
+}
+
+inx::DeepSeek::MessageArena::MessageArena(size_t initial_bytes)
+	: HeapCounter(std::pmr::new_delete_resource(), nullptr),
+	Monotonic(std::max<size_t>(initial_bytes, 1), &HeapCounter),
+	Front(&Monotonic, &Mutex)
+{
+}
+
+std::shared_ptr<inx::DeepSeek::MessageArena> inx::DeepSeek::MessageArena::Create(size_t initial_bytes)
+{
+	return std::shared_ptr<MessageArena>(new MessageArena(initial_bytes));
+}
+
+inx::DeepSeek::Message inx::DeepSeek::MessageArena::MakeMessage(Message::Role role, std::string_view content)
+{
+	if (content.empty() || content.size() > MaxAdoptedBytes) {
+		return Message(role, std::string(content));
+	}
+	char* stored = static_cast<char*>(Front.allocate(content.size(), 1));
+	std::memcpy(stored, content.data(), content.size());
+	return Message(role, std::string_view(stored, content.size()), shared_from_this());
+}
+
+inx::DeepSeek::Message inx::DeepSeek::MessageArena::Adopt(Message&& message)
+{
+	if (message.SharedContent || message.HasExternalContent || message.OwnedContent.empty() || message.OwnedContent.size() > MaxAdoptedBytes) {
+		return std::move(message);
+	}
+	Message adopted = MakeMessage(message.role, message.OwnedContent);
+	adopted.TokenMemo.store(message.TokenMemo.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	return adopted;
+}
+
+inx::DeepSeek::Message inx::DeepSeek::MessageArena::Adopt(const Message& message)
+{
+	if (message.SharedContent || message.HasExternalContent || message.OwnedContent.empty() || message.OwnedContent.size() > MaxAdoptedBytes) {
+		return message;
+	}
+	Message adopted = MakeMessage(message.role, message.OwnedContent);
+	adopted.TokenMemo.store(message.TokenMemo.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	return adopted;
+}
+
+inx::DeepSeek::ArenaStats inx::DeepSeek::MessageArena::GetStats() const
+{
+	std::lock_guard lock(Mutex);
+	ArenaStats stats;
+	stats.Allocations = Front.Allocations;
+	stats.AllocatedBytes = Front.Bytes;
+	stats.HeapAllocations = HeapCounter.Allocations;
+	stats.HeapBytes = HeapCounter.Bytes;
+	return stats;
+}
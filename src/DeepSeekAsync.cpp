@@ -0,0 +1,173 @@
+#include "DeepSeekAsync.h"
+
+void inx::DeepSeek::AsyncOperation::Start(std::shared_ptr<ReactorCore> reactor, std::coroutine_handle<> awaiting)
+{
+	{
+		std::lock_guard lock(Mutex);
+		Driver = reactor.get();
+		Awaiting = awaiting;
+		Started = true;
+	}
+	// The coroutine may be resumed (and this operation released) before Submit returns, nothing is touched after it
+	reactor->Submit(std::static_pointer_cast<AsyncOperation>(shared_from_this()));
+}
+
+void inx::DeepSeek::AsyncOperation::Abandon()
+{
+	std::lock_guard lock(Mutex);
+	Awaiting = {};
+	if (Started && !Done) {
+		// Ended by the reactor thread, which takes it out of its scheduler if it still waits for a slot
+		Driver->Cancel(shared_from_this());
+	}
+}
+
+void inx::DeepSeek::AsyncOperation::RethrowError() const
+{
+	if (Failure) {
+		std::rethrow_exception(Failure);
+	}
+}
+
+void inx::DeepSeek::AsyncOperation::OnDone(int result) noexcept
+{
+	std::exception_ptr failure;
+	try {
+		Finish(result);
+	}
+	catch (...) {
+		failure = std::current_exception();
+	}
+	std::coroutine_handle<> awaiting;
+	{
+		std::lock_guard lock(Mutex);
+		Failure = failure;
+		Done = true;
+		awaiting = std::exchange(Awaiting, {});
+	}
+	if (awaiting) {
+		Driver->Resume(awaiting);
+	}
+}
+
+void inx::DeepSeek::CompletionOperation::Finish(int result)
+{
+	Content = GetCompletion(result, UsageOutput);
+	if (UsageOutput) {
+		UsageOutput->TrimmedPromptTokens = static_cast<int>(TrimmedTokens);
+	}
+}
+
+std::string inx::DeepSeek::CompletionOperation::TakeResult()
+{
+	RethrowError();
+	return std::move(Content);
+}
+
+void inx::DeepSeek::BalanceOperation::Finish(int result)
+{
+	Result = GetBalance(result);
+}
+
+inx::DeepSeek::Balance inx::DeepSeek::BalanceOperation::TakeResult()
+{
+	RethrowError();
+	return std::move(Result);
+}
+
+void inx::DeepSeek::StreamOperation::Deliver(std::string_view delta)
+{
+	std::coroutine_handle<> consumer;
+	{
+		std::lock_guard lock(Mutex);
+		Buffered.append(delta);
+		consumer = std::exchange(Consumer, {});
+	}
+	// Called from the curl write callback, so the coroutine is only resumed once curl returned
+	if (consumer) {
+		Driver->Resume(consumer);
+	}
+}
+
+bool inx::DeepSeek::StreamOperation::Wait(const std::shared_ptr<ReactorCore>& reactor, std::coroutine_handle<> consumer)
+{
+	{
+		std::lock_guard lock(Mutex);
+		if (Started) {
+			if (!Buffered.empty() || Ended) {
+				return false;
+			}
+			Consumer = consumer;
+			return true;
+		}
+		Driver = reactor.get();
+		Consumer = consumer;
+		Started = true;
+	}
+	reactor->Submit(std::static_pointer_cast<StreamOperation>(shared_from_this()));
+	return true;
+}
+
+bool inx::DeepSeek::StreamOperation::Take(std::string& delta)
+{
+	std::lock_guard lock(Mutex);
+	if (!Buffered.empty()) {
+		delta.clear();
+		delta.swap(Buffered);
+		return true;
+	}
+	if (Failure) {
+		std::rethrow_exception(Failure);
+	}
+	return false;
+}
+
+void inx::DeepSeek::StreamOperation::Abandon()
+{
+	std::lock_guard lock(Mutex);
+	Consumer = {};
+	if (Started && !Ended) {
+		Driver->Cancel(shared_from_this());
+	}
+}
+
+void inx::DeepSeek::StreamOperation::OnDone(int result) noexcept
+{
+	std::exception_ptr failure;
+	std::string content;
+	Usage usage;
+	try {
+		content = GetCompletion(result, &usage);
+		usage.TrimmedPromptTokens = static_cast<int>(TrimmedTokens);
+	}
+	catch (...) {
+		failure = std::current_exception();
+	}
+	std::coroutine_handle<> consumer;
+	{
+		std::lock_guard lock(Mutex);
+		Content = std::move(content);
+		FinalUsage = usage;
+		Failure = failure;
+		Ended = true;
+		consumer = std::exchange(Consumer, {});
+	}
+	if (consumer) {
+		Driver->Resume(consumer);
+	}
+}
+
+std::optional<std::string_view> inx::DeepSeek::DeltaStream::NextAwaitable::await_resume()
+{
+	if (!Stream.Pending->Take(Stream.Current)) {
+		return std::nullopt;
+	}
+	return std::string_view(Stream.Current);
+}
+
+inx::DeepSeek::DeltaStream::~DeltaStream()
+{
+	if (Pending) {
+		Pending->Abandon();
+	}
+}
\ No newline at end of file
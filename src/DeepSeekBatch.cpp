@@ -0,0 +1,245 @@
+#include "DeepSeekBatch.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <thread>
+
+inx::DeepSeek::Batch::Batch(const API& api, size_t max_concurrency)
+	: Client(api), MaxConcurrency(std::max<size_t>(max_concurrency, 1))
+{
+}
+
+size_t inx::DeepSeek::Batch::Add(std::vector<Message> messages, std::string tag)
+{
+	Requests.push_back(std::move(messages));
+	Tags.push_back(std::move(tag));
+	return Requests.size() - 1;
+}
+
+void inx::DeepSeek::Batch::BuildTrie()
+{
+	Trie.clear();
+	Trie.emplace_back();
+	Paths.assign(Requests.size(), {});
+	RequestBytes.assign(Requests.size(), 0);
+
+	for (size_t request = 0; request < Requests.size(); request++) {
+		size_t node = 0;
+		Trie[node].Count++;
+		for (const auto& message : Requests[request]) {
+			// The messages are compared in place, the size approximates the serialized one ({"content":"","role":""} is 24 bytes)
+			MessageKey key{ message.role, message.GetContent() };
+			size_t key_size = key.Content.size() + RoleToString(message.role).size() + 24;
+			auto it = Trie[node].Children.find(key);
+			size_t child;
+			if (it == Trie[node].Children.end()) {
+				child = Trie.size();
+				TrieNode created;
+				created.Bytes = Trie[node].Bytes + key_size + 1;
+				created.Depth = Trie[node].Depth + 1;
+				created.FirstRequest = request;
+				Trie[node].Children.emplace(key, child);
+				Trie.push_back(std::move(created));
+			}
+			else {
+				child = it->second;
+			}
+			node = child;
+			Trie[node].Count++;
+			Paths[request].push_back(node);
+		}
+		RequestBytes[request] = Trie[node].Bytes;
+	}
+
+	// A node only gets a leader if it's the end of a large shared prefix:
+	// if all of its requests continue into the same child, the child shares a longer prefix.
+	for (auto& node : Trie) {
+		if (node.Count < 2 || node.Bytes < MinSharedPrefixBytes) {
+			continue;
+		}
+		bool extends = false;
+		for (const auto& [key, child] : node.Children) {
+			if (Trie[child].Count == node.Count) {
+				extends = true;
+			}
+		}
+		node.IsGroup = !extends;
+	}
+}
+
+bool inx::DeepSeek::Batch::PassesThrough(size_t request, size_t node) const
+{
+	size_t depth = Trie[node].Depth;
+	return depth > 0 && Paths[request].size() >= depth && Paths[request][depth - 1] == node;
+}
+
+void inx::DeepSeek::Batch::AssignLeaders(size_t node, std::optional<size_t> current_leader)
+{
+	TrieNode& current = Trie[node];
+	if (current.IsGroup) {
+		// Keep the leader of the enclosing prefix if possible, its request warms this prefix too
+		if (current_leader.has_value() && PassesThrough(current_leader.value(), node)) {
+			current.Leader = current_leader.value();
+		}
+		else {
+			current.Leader = current.FirstRequest;
+		}
+		current_leader = current.Leader;
+	}
+	std::vector<size_t> children;
+	for (const auto& [key, child] : current.Children) {
+		children.push_back(child);
+	}
+	for (size_t child : children) {
+		AssignLeaders(child, current_leader);
+	}
+}
+
+inx::DeepSeek::BatchReport inx::DeepSeek::Batch::Run()
+{
+	const size_t count = Requests.size();
+	Results.assign(count, {});
+	BatchReport report;
+	report.Requests = count;
+	if (count == 0) {
+		return report;
+	}
+
+	BuildTrie();
+	AssignLeaders(0, {});
+
+	// Every request waits for the leader of the deepest shared prefix it doesn't lead itself
+	std::vector<std::vector<size_t>> dependents(count);
+	std::vector<size_t> pending(count, 0);
+	for (size_t request = 0; request < count; request++) {
+		const auto& path = Paths[request];
+		for (auto it = path.rbegin(); it != path.rend(); ++it) {
+			const TrieNode& node = Trie[*it];
+			if (!node.IsGroup) {
+				continue;
+			}
+			if (node.Leader == request) {
+				Results[request].IsLeader = true;
+				continue;
+			}
+			dependents[node.Leader].push_back(request);
+			pending[request] = 1;
+			break;
+		}
+	}
+
+	// The ready requests by predicted cost if the scheduler sends the shortest first, then in the order they got ready
+	using ReadyQueue = std::set<std::tuple<size_t, size_t, size_t>>;
+	ReadyQueue ready_leaders, ready_followers;
+	size_t next_ready = 0;
+	const std::shared_ptr<RequestScheduler>& scheduler = Client.GetScheduler();
+	bool shortest_first = scheduler && scheduler->GetOptions().ShortestPredictedFirst;
+	// The prompt tokens as the instance counts them for its scheduler, with its tokenizer if it has one
+	std::vector<size_t> prompt_costs(shortest_first ? count : 0);
+	for (size_t request = 0; request < prompt_costs.size(); request++) {
+		prompt_costs[request] = Client.CountPromptTokens(Requests[request]);
+	}
+	auto make_ready = [&](size_t request) {
+		size_t cost = 0;
+		if (shortest_first) {
+			cost = prompt_costs[request] + static_cast<size_t>(scheduler->PredictCompletionTokens(Tags[request]));
+		}
+		(Results[request].IsLeader ? ready_leaders : ready_followers).emplace(cost, next_ready++, request);
+	};
+	for (size_t request = 0; request < count; request++) {
+		if (pending[request] == 0) {
+			make_ready(request);
+		}
+	}
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	size_t completed = 0;
+
+	auto worker = [&]() {
+		// Shares the connections and the scheduler of the instance, with the class of the batch
+		API client = Client;
+		client.SetPriority(Priority);
+		std::unique_lock lock(mutex);
+		while (true) {
+			condition.wait(lock, [&]() {
+				return completed == count || !ready_leaders.empty() || !ready_followers.empty();
+			});
+			if (ready_leaders.empty() && ready_followers.empty()) {
+				return;
+			}
+			ReadyQueue& queue = ready_leaders.empty() ? ready_followers : ready_leaders;
+			size_t request = std::get<2>(*queue.begin());
+			queue.erase(queue.begin());
+			lock.unlock();
+
+			BatchResult& result = Results[request];
+			client.SetTag(Tags[request]);
+			try {
+				result.Response = client.GetCompletion(Requests[request], &result.TokenUsage);
+			}
+			catch (const std::exception& e) {
+				result.Error = e.what();
+			}
+
+			lock.lock();
+			completed++;
+			for (size_t dependent : dependents[request]) {
+				if (--pending[dependent] == 0) {
+					make_ready(dependent);
+				}
+			}
+			condition.notify_all();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < std::min(MaxConcurrency, count); i++) {
+		threads.emplace_back(worker);
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+
+	long long prompt_tokens = 0;
+	long long prompt_bytes = 0;
+	for (size_t request = 0; request < count; request++) {
+		const BatchResult& result = Results[request];
+		if (result.IsLeader) {
+			report.Leaders++;
+		}
+		if (result.Error.has_value()) {
+			report.Failed++;
+			continue;
+		}
+		report.CacheHitTokens += result.TokenUsage.PromptCacheHitTokens;
+		report.CacheMissTokens += result.TokenUsage.PromptCacheMissTokens;
+		prompt_tokens += result.TokenUsage.PromptTokens;
+		prompt_bytes += RequestBytes[request];
+	}
+
+	// In the original order, a request can only hit the cache for a prefix shared
+	// with a request that was started at least MaxConcurrency requests before it.
+	long long naive_shared_bytes = 0;
+	for (size_t request = 0; request < count; request++) {
+		if (Results[request].Error.has_value()) {
+			continue;
+		}
+		const auto& path = Paths[request];
+		for (auto it = path.rbegin(); it != path.rend(); ++it) {
+			if (Trie[*it].FirstRequest + MaxConcurrency <= request) {
+				naive_shared_bytes += Trie[*it].Bytes;
+				break;
+			}
+		}
+	}
+	if (prompt_bytes > 0) {
+		double tokens_per_byte = static_cast<double>(prompt_tokens) / static_cast<double>(prompt_bytes);
+		report.EstimatedNaiveCacheHitTokens = static_cast<long long>(naive_shared_bytes * tokens_per_byte);
+	}
+	report.CacheHitTokensGained = report.CacheHitTokens - report.EstimatedNaiveCacheHitTokens;
+
+	return report;
+}
@@ -0,0 +1,107 @@
+#include "DeepSeekConnection.h"
+#include <curl/curl.h>
+#include <algorithm>
+#include <stdexcept>
+
+inx::DeepSeek::Connection::Connection()
+{
+	Handle = curl_easy_init();
+	if (!Handle) {
+		throw std::runtime_error("Failed to initialize CURL");
+	}
+}
+
+inx::DeepSeek::Connection::~Connection()
+{
+	curl_easy_cleanup(static_cast<CURL*>(Handle));
+}
+
+void inx::DeepSeek::Connection::Reserve(size_t bytes)
+{
+	if (bytes > Response.capacity()) {
+		Response.reserve(bytes);
+		Allocations++;
+	}
+}
+
+void inx::DeepSeek::Connection::Receive(const char* data, size_t size)
+{
+	if (Response.empty()) {
+		curl_off_t length = -1;
+		if (curl_easy_getinfo(static_cast<CURL*>(Handle), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length) == CURLE_OK && length > 0) {
+			Reserve(static_cast<size_t>(std::min<curl_off_t>(length, MaxReservedBytes)));
+		}
+	}
+	if (Response.size() + size > Response.capacity()) {
+		// Grows geometrically, like append would, but counted
+		Reserve(std::max(Response.size() + size, Response.capacity() * 2));
+	}
+	Response.append(data, size);
+}
+
+inx::DeepSeek::ConnectionPool::Lease inx::DeepSeek::ConnectionPool::Acquire()
+{
+	std::unique_ptr<Connection> connection;
+	{
+		std::lock_guard lock(Mutex);
+		Stats.Requests++;
+		if (!Idle.empty()) {
+			connection = std::move(Idle.back());
+			Idle.pop_back();
+			Stats.RetainedBufferBytes -= connection->Response.capacity();
+		}
+		else {
+			Stats.Connections++;
+		}
+	}
+	if (!connection) {
+		connection = std::make_unique<Connection>();
+	}
+	return Lease(*this, std::move(connection));
+}
+
+void inx::DeepSeek::ConnectionPool::Release(std::unique_ptr<Connection> connection)
+{
+	// Forgets the options of the request (they point to its state), the connection to the server stays open
+	curl_easy_reset(static_cast<CURL*>(connection->Handle));
+	connection->Response.clear();
+
+	std::lock_guard lock(Mutex);
+	Stats.BufferAllocations += connection->Allocations;
+	connection->Allocations = 0;
+	if (Idle.size() >= MaxIdleConnections) {
+		return;
+	}
+	Stats.RetainedBufferBytes += connection->Response.capacity();
+	Idle.push_back(std::move(connection));
+	while (Stats.RetainedBufferBytes > MaxRetainedBytes) {
+		auto largest = std::max_element(Idle.begin(), Idle.end(), [](const auto& a, const auto& b) {
+			return a->Response.capacity() < b->Response.capacity();
+		});
+		Stats.RetainedBufferBytes -= (*largest)->Response.capacity();
+		std::string().swap((*largest)->Response);
+		Stats.RetainedBufferBytes += (*largest)->Response.capacity();
+		Stats.BufferTrims++;
+	}
+}
+
+void inx::DeepSeek::ConnectionPool::Trim()
+{
+	std::lock_guard lock(Mutex);
+	for (auto& connection : Idle) {
+		if (connection->Response.capacity() > std::string().capacity()) {
+			std::string().swap(connection->Response);
+			Stats.BufferTrims++;
+		}
+	}
+	Stats.RetainedBufferBytes = 0;
+	for (const auto& connection : Idle) {
+		Stats.RetainedBufferBytes += connection->Response.capacity();
+	}
+}
+
+inx::DeepSeek::TransportStats inx::DeepSeek::ConnectionPool::GetStats() const
+{
+	std::lock_guard lock(Mutex);
+	return Stats;
+}
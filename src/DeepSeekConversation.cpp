@@ -0,0 +1,150 @@
+#include "DeepSeekConversation.h"
+
+inx::DeepSeek::Conversation::Conversation(const std::vector<Message>& messages)
+	: Conversation(std::vector<Message>(messages))
+{
+}
+
+inx::DeepSeek::Conversation::Conversation(std::vector<Message>&& messages)
+{
+	if (messages.empty()) {
+		return;
+	}
+	Tail = MakeChunk();
+	Tail->Messages.assign(std::make_move_iterator(messages.begin()), std::make_move_iterator(messages.end()));
+	Count = Tail->Messages.size();
+}
+
+inx::DeepSeek::Conversation::Conversation(std::shared_ptr<MessageArena> arena)
+	: Arena(std::move(arena))
+{
+}
+
+// The chunks are released before the arena they may live in
+inx::DeepSeek::Conversation& inx::DeepSeek::Conversation::operator=(const Conversation& other)
+{
+	std::shared_ptr<MessageArena> previous_arena = std::move(Arena);
+	Tail = other.Tail;
+	Count = other.Count;
+	Arena = other.Arena;
+	return *this;
+}
+
+inx::DeepSeek::Conversation& inx::DeepSeek::Conversation::operator=(Conversation&& other) noexcept
+{
+	std::shared_ptr<MessageArena> previous_arena = std::move(Arena);
+	Tail = std::move(other.Tail);
+	Count = other.Count;
+	Arena = std::move(other.Arena);
+	other.Count = 0;
+	return *this;
+}
+
+std::shared_ptr<inx::DeepSeek::Conversation::Chunk> inx::DeepSeek::Conversation::MakeChunk() const
+{
+	std::pmr::memory_resource* resource = GetResource();
+	return std::allocate_shared<Chunk>(std::pmr::polymorphic_allocator<Chunk>(resource), resource);
+}
+
+const inx::DeepSeek::Message& inx::DeepSeek::Conversation::operator[](size_t index) const
+{
+	const Chunk* chunk = Tail.get();
+	while (chunk->Base > index) {
+		chunk = chunk->Parent.get();
+	}
+	return chunk->Messages[index - chunk->Base];
+}
+
+inx::DeepSeek::Conversation::const_iterator& inx::DeepSeek::Conversation::const_iterator::operator++()
+{
+	Index++;
+	Offset++;
+	// A chunk ends where the next one starts, the messages after that belong to another branch
+	if (ChunkIndex + 1 < Spine->size() && Index == (*Spine)[ChunkIndex + 1]->Base) {
+		ChunkIndex++;
+		Offset = 0;
+	}
+	return *this;
+}
+
+inx::DeepSeek::Conversation::const_iterator inx::DeepSeek::Conversation::begin() const
+{
+	const_iterator it;
+	it.End = Count;
+	if (Count == 0) {
+		return it;
+	}
+	auto spine = std::make_shared<std::vector<const Chunk*>>(Tail->Depth);
+	for (const Chunk* chunk = Tail.get(); chunk; chunk = chunk->Parent.get()) {
+		(*spine)[chunk->Depth - 1] = chunk;
+	}
+	it.Spine = std::move(spine);
+	return it;
+}
+
+inx::DeepSeek::Conversation::const_iterator inx::DeepSeek::Conversation::end() const
+{
+	const_iterator it;
+	it.Index = Count;
+	it.End = Count;
+	return it;
+}
+
+void inx::DeepSeek::Conversation::push_back(Message message)
+{
+	if (Arena) {
+		message = Arena->Adopt(std::move(message));
+	}
+	if (Tail && Tail.use_count() == 1) {
+		// Nobody else sees this chunk, the messages past Count (left by Prefix) can be dropped
+		Tail->Messages.erase(Tail->Messages.begin() + (Count - Tail->Base), Tail->Messages.end());
+	}
+	else if (Tail && Tail->Depth >= MaxChunks) {
+		auto flat = MakeChunk();
+		flat->Messages.reserve(Count + 1);
+		for (const auto& existing : *this) {
+			flat->Messages.push_back(existing);
+		}
+		Tail = std::move(flat);
+	}
+	else {
+		auto chunk = MakeChunk();
+		chunk->Base = Count;
+		chunk->Depth = Tail ? Tail->Depth + 1 : 1;
+		chunk->Parent = std::move(Tail);
+		Tail = std::move(chunk);
+	}
+	Tail->Messages.push_back(std::move(message));
+	Count++;
+}
+
+void inx::DeepSeek::Conversation::clear()
+{
+	Tail.reset();
+	Count = 0;
+}
+
+inx::DeepSeek::Conversation inx::DeepSeek::Conversation::Prefix(size_t count) const
+{
+	Conversation prefix(Arena);
+	if (count == 0 || count > Count) {
+		return count > Count ? *this : prefix;
+	}
+	std::shared_ptr<Chunk> chunk = Tail;
+	while (chunk->Base >= count) {
+		chunk = chunk->Parent;
+	}
+	prefix.Tail = std::move(chunk);
+	prefix.Count = count;
+	return prefix;
+}
+
+std::vector<inx::DeepSeek::Message> inx::DeepSeek::Conversation::ToVector() const
+{
+	std::vector<Message> messages;
+	messages.reserve(Count);
+	for (const auto& message : *this) {
+		messages.push_back(message);
+	}
+	return messages;
+}
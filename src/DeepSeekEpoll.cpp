@@ -0,0 +1,146 @@
+#include "DeepSeekEpoll.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+static std::runtime_error SystemError(const char* what)
+{
+	return std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+}
+
+inx::DeepSeek::EpollEventLoop::EpollEventLoop(SubmissionOptions options)
+{
+	Epoll = epoll_create1(EPOLL_CLOEXEC);
+	Timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	Wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (Epoll < 0 || Timer < 0 || Wakeup < 0) {
+		std::runtime_error error = SystemError("Failed to create the epoll loop");
+		for (int descriptor : { Epoll, Timer, Wakeup }) {
+			if (descriptor >= 0) {
+				close(descriptor);
+			}
+		}
+		throw error;
+	}
+	for (int descriptor : { Timer, Wakeup }) {
+		epoll_event event{};
+		event.events = EPOLLIN;
+		event.data.fd = descriptor;
+		epoll_ctl(Epoll, EPOLL_CTL_ADD, descriptor, &event);
+	}
+
+	EventLoopHooks hooks;
+	hooks.WatchSocket = [this](SocketHandle socket, SocketInterest interest) { WatchSocket(socket, interest); };
+	hooks.SetTimer = [this](long timeout_ms) { SetTimer(timeout_ms); };
+	hooks.Wakeup = [wakeup = Wakeup]() {
+		std::uint64_t one = 1;
+		(void)!write(wakeup, &one, sizeof(one));
+	};
+	Driver = std::make_shared<Reactor>(std::move(hooks), options);
+}
+
+inx::DeepSeek::EpollEventLoop::~EpollEventLoop()
+{
+	// The hooks point to this loop, the reactor never calls them once stopped
+	Driver->Stop();
+	close(Wakeup);
+	close(Timer);
+	close(Epoll);
+}
+
+void inx::DeepSeek::EpollEventLoop::WatchSocket(SocketHandle socket, SocketInterest interest)
+{
+	auto found = Watched.find(socket);
+	if (interest == SocketInterest::None) {
+		if (found != Watched.end()) {
+			// Fails harmlessly if curl already closed the socket, which removed it from the set
+			epoll_ctl(Epoll, EPOLL_CTL_DEL, socket, nullptr);
+			Watched.erase(found);
+		}
+		return;
+	}
+	std::uint32_t flags = 0;
+	if (interest != SocketInterest::Write) {
+		flags |= EPOLLIN;
+	}
+	if (interest != SocketInterest::Read) {
+		flags |= EPOLLOUT;
+	}
+	epoll_event event{};
+	event.events = flags;
+	event.data.fd = socket;
+	if (found == Watched.end()) {
+		epoll_ctl(Epoll, EPOLL_CTL_ADD, socket, &event);
+		Watched.emplace(socket, flags);
+	}
+	else if (found->second != flags) {
+		epoll_ctl(Epoll, EPOLL_CTL_MOD, socket, &event);
+		found->second = flags;
+	}
+}
+
+void inx::DeepSeek::EpollEventLoop::SetTimer(long timeout_ms)
+{
+	itimerspec delay{};
+	if (timeout_ms == 0) {
+		// A zero delay would disarm the timer
+		delay.it_value.tv_nsec = 1;
+	}
+	else if (timeout_ms > 0) {
+		delay.it_value.tv_sec = timeout_ms / 1000;
+		delay.it_value.tv_nsec = (timeout_ms % 1000) * 1000000;
+	}
+	timerfd_settime(Timer, 0, &delay, nullptr);
+}
+
+size_t inx::DeepSeek::EpollEventLoop::Poll(int timeout_ms)
+{
+	epoll_event events[256];
+	int count = epoll_wait(Epoll, events, 256, timeout_ms);
+	if (count < 0) {
+		if (errno == EINTR) {
+			return 0;
+		}
+		throw SystemError("epoll_wait failed");
+	}
+	for (int i = 0; i < count; i++) {
+		int descriptor = events[i].data.fd;
+		std::uint64_t value = 0;
+		if (descriptor == Wakeup) {
+			(void)!read(Wakeup, &value, sizeof(value));
+			Driver->ProcessSubmitted();
+		}
+		else if (descriptor == Timer) {
+			(void)!read(Timer, &value, sizeof(value));
+			Driver->OnTimeout();
+		}
+		else {
+			std::uint32_t flags = events[i].events;
+			Driver->OnSocketEvent(descriptor, (flags & (EPOLLIN | EPOLLHUP)) != 0, (flags & EPOLLOUT) != 0, (flags & EPOLLERR) != 0);
+		}
+	}
+	return static_cast<size_t>(count);
+}
+
+void inx::DeepSeek::EpollEventLoop::Run()
+{
+	while (!Stopping) {
+		Poll(-1);
+	}
+	Stopping = false;
+}
+
+void inx::DeepSeek::EpollEventLoop::Stop()
+{
+	Stopping = true;
+	std::uint64_t one = 1;
+	(void)!write(Wakeup, &one, sizeof(one));
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "DeepSeekHeaders.h"
+#include <curl/curl.h>
+#include <stdexcept>
+#include <string_view>
+
+// The tchar set of RFC 9110, the characters of a token
+static bool IsTokenChar(char c)
+{
+	if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+		return true;
+	}
+	return std::string_view("!#$%&'*+-.^_`|~").find(c) != std::string_view::npos;
+}
+
+// A header name is a token (RFC 9110), the value must stay on its line.
+// This also keeps ';' out of the names, it would mix with curl's "Name;" syntax for empty values.
+static void ValidateHeader(const inx::DeepSeek::CustomHeader& header)
+{
+	if (header.first.empty()) {
+		throw std::runtime_error("Custom header with an empty name");
+	}
+	for (char c : header.first) {
+		if (!IsTokenChar(c)) {
+			throw std::runtime_error("Invalid custom header name: " + header.first);
+		}
+	}
+	if (header.second.find_first_of(std::string_view("\r\n\0", 3)) != std::string::npos) {
+		throw std::runtime_error("Invalid value for the custom header " + header.first);
+	}
+}
+
+inx::DeepSeek::RequestHeaders::RequestHeaders(std::string_view api_key, std::vector<CustomHeader> custom_headers)
+	: Custom(std::move(custom_headers))
+{
+	for (const CustomHeader& header : Custom) {
+		ValidateHeader(header);
+	}
+	try {
+		std::string auth_header = "Authorization: Bearer ";
+		auth_header += api_key;
+		Completion = Append(Completion, "Content-Type: application/json");
+		Completion = Append(Completion, auth_header);
+		Balance = Append(Balance, auth_header);
+		Balance = Append(Balance, "Accept: application/json");
+		for (const CustomHeader& header : Custom) {
+			// "Name;" is curl's syntax for a header sent with an empty value, "Name:" would remove it
+			std::string line = header.second.empty() ? header.first + ";" : header.first + ": " + header.second;
+			Completion = Append(Completion, line);
+			Balance = Append(Balance, line);
+		}
+	}
+	catch (...) {
+		curl_slist_free_all(static_cast<curl_slist*>(Completion));
+		curl_slist_free_all(static_cast<curl_slist*>(Balance));
+		throw;
+	}
+}
+
+inx::DeepSeek::RequestHeaders::~RequestHeaders()
+{
+	curl_slist_free_all(static_cast<curl_slist*>(Completion));
+	curl_slist_free_all(static_cast<curl_slist*>(Balance));
+}
+
+void* inx::DeepSeek::RequestHeaders::Append(void* list, const std::string& line)
+{
+	curl_slist* appended = curl_slist_append(static_cast<curl_slist*>(list), line.c_str());
+	if (!appended) {
+		throw std::runtime_error("Failed to allocate the request headers");
+	}
+	return appended;
+}
@@ -0,0 +1,105 @@
+#include "DeepSeekJson.h"
+#include "DeepSeekSimd.h"
+#include <stdexcept>
+
+// Validates the run of UTF-8 sequences starting at the index and returns the index of the next ASCII byte (or the end)
+static size_t SkipSequences(std::string_view text, size_t index)
+{
+	do {
+		size_t length = inx::DeepSeek::Utf8SequenceLength(text.data() + index, text.size() - index);
+		if (length == 0) {
+			throw std::runtime_error("Invalid UTF-8 at byte " + std::to_string(index) + " of a JSON string");
+		}
+		index += length;
+	} while (index < text.size() && static_cast<unsigned char>(text[index]) >= 0x80);
+	return index;
+}
+
+void inx::DeepSeek::AppendJsonString(std::string& output, std::string_view text)
+{
+	output.reserve(output.size() + text.size() + 2);
+	output += '"';
+	AppendJsonEscaped(output, text);
+	output += '"';
+}
+
+void inx::DeepSeek::AppendJsonEscaped(std::string& output, std::string_view text)
+{
+	static constexpr char hex[] = "0123456789abcdef";
+
+	// The plain runs are found 16 or 32 bytes at a time and copied in bulk, only the bytes ending them are looked at one by one
+	size_t run = 0; // start of the bytes that are copied as is
+	size_t i = 0;
+	while (true) {
+		i += SpanJsonPlain(text.data() + i, text.size() - i);
+		if (i == text.size()) {
+			break;
+		}
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		if (c >= 0x80) {
+			i = SkipSequences(text, i);
+			continue;
+		}
+		char escape[6] = { '\\', static_cast<char>(c), 0, 0, 0, 0 };
+		size_t length = 2;
+		switch (c) {
+		case '"':
+		case '\\':
+			break;
+		case '\b':
+			escape[1] = 'b';
+			break;
+		case '\f':
+			escape[1] = 'f';
+			break;
+		case '\n':
+			escape[1] = 'n';
+			break;
+		case '\r':
+			escape[1] = 'r';
+			break;
+		case '\t':
+			escape[1] = 't';
+			break;
+		default:
+			escape[1] = 'u';
+			escape[2] = '0';
+			escape[3] = '0';
+			escape[4] = hex[c >> 4];
+			escape[5] = hex[c & 15];
+			length = 6;
+			break;
+		}
+		output.append(text.data() + run, i - run);
+		output.append(escape, length);
+		i++;
+		run = i;
+	}
+	output.append(text.data() + run, text.size() - run);
+}
+
+size_t inx::DeepSeek::JsonStringLength(std::string_view text)
+{
+	size_t length = text.size() + 2;
+	size_t i = 0;
+	while (true) {
+		i += SpanJsonPlain(text.data() + i, text.size() - i);
+		if (i == text.size()) {
+			break;
+		}
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		if (c >= 0x80) {
+			i = SkipSequences(text, i);
+			continue;
+		}
+		if (c < 0x20) {
+			// The short escapes take 2 bytes, the others \u00xx 6
+			length += (c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') ? 1 : 5;
+		}
+		else {
+			length++;
+		}
+		i++;
+	}
+	return length;
+}
@@ -0,0 +1,98 @@
+#include "DeepSeekMappedFile.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+std::shared_ptr<const inx::DeepSeek::MappedFile> inx::DeepSeek::MappedFile::Open(const std::string& path)
+{
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Failed to open file: " + path);
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("Failed to get the size of file: " + path);
+	}
+	std::shared_ptr<MappedFile> mapped(new MappedFile());
+	mapped->Size = static_cast<size_t>(size.QuadPart);
+	if (mapped->Size == 0) {
+		// Empty files can't be mapped
+		CloseHandle(file);
+		return mapped;
+	}
+	// The mapping keeps the file open, the handle isn't needed past this point
+	mapped->Mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapped->Mapping) {
+		throw std::runtime_error("Failed to map file: " + path);
+	}
+	mapped->Data = static_cast<const char*>(MapViewOfFile(mapped->Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mapped->Data) {
+		throw std::runtime_error("Failed to map file: " + path);
+	}
+	return mapped;
+}
+
+inx::DeepSeek::MappedFile::~MappedFile()
+{
+	if (Data) {
+		UnmapViewOfFile(Data);
+	}
+	if (Mapping) {
+		CloseHandle(Mapping);
+	}
+}
+#else
+std::shared_ptr<const inx::DeepSeek::MappedFile> inx::DeepSeek::MappedFile::Open(const std::string& path)
+{
+	int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (file < 0) {
+		throw std::runtime_error("Failed to open file: " + path);
+	}
+	struct stat info;
+	if (fstat(file, &info) != 0) {
+		close(file);
+		throw std::runtime_error("Failed to get the size of file: " + path);
+	}
+	std::shared_ptr<MappedFile> mapped(new MappedFile());
+	mapped->Size = static_cast<size_t>(info.st_size);
+	if (mapped->Size == 0) {
+		// Empty files can't be mapped
+		close(file);
+		return mapped;
+	}
+	// The mapping keeps the file open, the descriptor isn't needed past this point
+	void* data = mmap(nullptr, mapped->Size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED) {
+		mapped->Size = 0;
+		throw std::runtime_error("Failed to map file: " + path);
+	}
+	// It's read once from start to end while the body is written
+	madvise(data, mapped->Size, MADV_SEQUENTIAL);
+	mapped->Data = static_cast<const char*>(data);
+	return mapped;
+}
+
+inx::DeepSeek::MappedFile::~MappedFile()
+{
+	if (Data) {
+		munmap(const_cast<char*>(Data), Size);
+	}
+}
+#endif
@@ -1,6 +1,6 @@
 #include "DeepSeekMessage.h"
 
-std::string RoleToString(inx::DeepSeek::Message::Role role)
+std::string inx::DeepSeek::RoleToString(Message::Role role)
 {
 	switch (role) {
 	case inx::DeepSeek::Message::Role::System:
@@ -18,6 +18,48 @@ nlohmann::json inx::DeepSeek::Message::ToJSON() const
 {
 	nlohmann::json object;
 	object["role"] = RoleToString(role);
-	object["content"] = content;
+	object["content"] = std::string(GetContent());
 	return object;
 }
+
+inx::DeepSeek::Message& inx::DeepSeek::Message::operator=(const Message& other)
+{
+	role = other.role;
+	OwnedContent = other.OwnedContent;
+	SharedContent = other.SharedContent;
+	ExternalContent = other.ExternalContent;
+	ContentOwner = other.ContentOwner;
+	HasExternalContent = other.HasExternalContent;
+	TokenMemo.store(other.TokenMemo.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	return *this;
+}
+
+inx::DeepSeek::Message& inx::DeepSeek::Message::operator=(Message&& other) noexcept
+{
+	role = other.role;
+	OwnedContent = std::move(other.OwnedContent);
+	SharedContent = std::move(other.SharedContent);
+	ExternalContent = other.ExternalContent;
+	ContentOwner = std::move(other.ContentOwner);
+	HasExternalContent = other.HasExternalContent;
+	TokenMemo.store(other.TokenMemo.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	return *this;
+}
+
+void inx::DeepSeek::Message::SetContent(std::string new_content)
+{
+	OwnedContent = std::move(new_content);
+	SharedContent.reset();
+	ContentOwner.reset();
+	HasExternalContent = false;
+	InvalidateTokenCount();
+}
+
+void inx::DeepSeek::Message::SetContent(std::shared_ptr<const SharedText> new_content)
+{
+	OwnedContent.clear();
+	SharedContent = std::move(new_content);
+	ContentOwner.reset();
+	HasExternalContent = false;
+	InvalidateTokenCount();
+}
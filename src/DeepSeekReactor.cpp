@@ -0,0 +1,560 @@
+#include "DeepSeekReactor.h"
+#include <curl/curl.h>
+#include <stdexcept>
+#include <algorithm>
+#include <string>
+#include <thread>
+
+using Clock = inx::DeepSeek::TimerWheel::Clock;
+
+// The delay until the time point in whole milliseconds, rounded up so the timer isn't early
+static long MillisecondsUntil(Clock::time_point due, Clock::time_point now)
+{
+	if (due <= now) {
+		return 0;
+	}
+	return static_cast<long>(std::chrono::ceil<std::chrono::milliseconds>(due - now).count());
+}
+
+inx::DeepSeek::ReactorCore::ReactorCore(SubmissionOptions options)
+	: Queue(options.Capacity), WhenFull(options.WhenFull)
+{
+	Multi = curl_multi_init();
+	if (!Multi) {
+		throw std::runtime_error("Failed to initialize CURL");
+	}
+}
+
+// The socket and timer callbacks of curl, forwarded to the hooks of the event loop
+struct inx::DeepSeek::ReactorCallbacks {
+	static int Socket(CURL*, curl_socket_t socket, int what, void* userp, void*)
+	{
+		ReactorCore* core = static_cast<ReactorCore*>(userp);
+		SocketInterest interest = what == CURL_POLL_IN ? SocketInterest::Read
+			: what == CURL_POLL_OUT ? SocketInterest::Write
+			: what == CURL_POLL_INOUT ? SocketInterest::ReadWrite
+			: SocketInterest::None;
+		core->Hooks->WatchSocket(static_cast<SocketHandle>(socket), interest);
+		return 0;
+	}
+
+	// Merged with the timers of the transfers, as the loop has a single timer
+	static int Timer(CURLM*, long timeout_ms, void* userp)
+	{
+		ReactorCore* core = static_cast<ReactorCore*>(userp);
+		if (timeout_ms < 0) {
+			core->CurlDue.reset();
+		}
+		else {
+			core->CurlDue = Clock::now() + std::chrono::milliseconds(timeout_ms);
+		}
+		core->UpdateTimer();
+		return 0;
+	}
+};
+
+inx::DeepSeek::ReactorCore::ReactorCore(EventLoopHooks hooks, SubmissionOptions options)
+	: ReactorCore(options)
+{
+	if (!hooks.WatchSocket || !hooks.SetTimer || !hooks.Wakeup) {
+		throw std::runtime_error("The event loop hooks must all be set");
+	}
+	Hooks = std::move(hooks);
+	CURLM* multi = static_cast<CURLM*>(Multi);
+	curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, ReactorCallbacks::Socket);
+	curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+	curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, ReactorCallbacks::Timer);
+	curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+}
+
+inx::DeepSeek::ReactorCore::~ReactorCore()
+{
+	// Cancelled after the reactor stopped, they only keep themselves alive
+	for (Transfer* cancelled = CancelledTransfers.exchange(nullptr); cancelled;) {
+		Transfer* next = cancelled->NextCancelled;
+		cancelled->CancelledSelf.reset();
+		cancelled = next;
+	}
+	curl_multi_cleanup(static_cast<CURLM*>(Multi));
+}
+
+void inx::DeepSeek::ReactorCore::Submit(std::shared_ptr<Transfer> transfer)
+{
+	transfer->SubmitTime = Clock::now();
+	// Counted first, the reactor thread may be done with the transfer before the push returns
+	ActiveCount++;
+	while (true) {
+		SubmissionQueue::PushResult result = Queue.TryPush(transfer);
+		if (result == SubmissionQueue::PushResult::Pushed) {
+			Wakeup();
+			return;
+		}
+		if (result == SubmissionQueue::PushResult::Closed) {
+			ActiveCount--;
+			throw std::runtime_error("The reactor is stopped");
+		}
+
+		if (WhenFull == Backpressure::DropOldest) {
+			// Counted so a stopping reactor waits for the transfer dropped in between
+			BlockedProducers.fetch_add(1);
+			std::shared_ptr<Transfer> oldest;
+			if (Queue.TryPop(oldest)) {
+				PushDropped(std::move(oldest));
+			}
+			BlockedProducers.fetch_sub(1);
+			continue;
+		}
+		if (WhenFull == Backpressure::Fail || ConsumerThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+			RejectedCount.fetch_add(1, std::memory_order_relaxed);
+			ActiveCount--;
+			throw std::runtime_error("The submission queue of the reactor is full");
+		}
+
+		// Backpressure::Block: waits for the reactor thread to empty the queue, it bumps Drains if it sees a blocked producer
+		BlockedCount.fetch_add(1, std::memory_order_relaxed);
+		BlockedProducers.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		std::uint32_t drains = Drains.load();
+		result = Queue.TryPush(transfer);
+		if (result == SubmissionQueue::PushResult::Full) {
+			Drains.wait(drains);
+		}
+		BlockedProducers.fetch_sub(1);
+		if (result == SubmissionQueue::PushResult::Pushed) {
+			Wakeup();
+			return;
+		}
+	}
+}
+
+void inx::DeepSeek::ReactorCore::Cancel(std::shared_ptr<Transfer> transfer)
+{
+	transfer->Cancel();
+	if (transfer->CancelPushed.exchange(true)) {
+		return;
+	}
+	Transfer* cancelled = transfer.get();
+	cancelled->CancelledSelf = std::move(transfer);
+	Transfer* head = CancelledTransfers.load(std::memory_order_relaxed);
+	do {
+		cancelled->NextCancelled = head;
+	} while (!CancelledTransfers.compare_exchange_weak(head, cancelled, std::memory_order_release, std::memory_order_relaxed));
+	Wakeup();
+}
+
+void inx::DeepSeek::ReactorCore::Wakeup()
+{
+	// Pairs with the fence of AddSubmitted: either it sees the transfer just pushed, or this sees the flag it cleared
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (WakeupPending.load(std::memory_order_relaxed) || WakeupPending.exchange(true)) {
+		return;
+	}
+	// Counted before checking Stopping, and Stop sets Stopping before FailActive waits for the count: either this sees the reactor stopping,
+	// or the stop waits for this wakeup, so the event loop can't be gone (its eventfd closed) under it
+	WakeupsInFlight.fetch_add(1);
+	if (!Stopping.load()) {
+		if (Hooks) {
+			Hooks->Wakeup();
+		}
+		else {
+			curl_multi_wakeup(static_cast<CURLM*>(Multi));
+		}
+	}
+	WakeupsInFlight.fetch_sub(1);
+}
+
+void inx::DeepSeek::ReactorCore::PushDropped(std::shared_ptr<Transfer> transfer)
+{
+	DroppedCount.fetch_add(1, std::memory_order_relaxed);
+	Transfer* dropped = transfer.get();
+	dropped->DroppedSelf = std::move(transfer);
+	Transfer* head = Dropped.load(std::memory_order_relaxed);
+	do {
+		dropped->NextDropped = head;
+	} while (!Dropped.compare_exchange_weak(head, dropped, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void inx::DeepSeek::ReactorCore::PushGranted(std::shared_ptr<Transfer> transfer)
+{
+	Transfer* granted = transfer.get();
+	granted->GrantedSelf = std::move(transfer);
+	Transfer* head = Granted.load(std::memory_order_relaxed);
+	do {
+		granted->NextGranted = head;
+	} while (!Granted.compare_exchange_weak(head, granted, std::memory_order_release, std::memory_order_relaxed));
+	Wakeup();
+}
+
+inx::DeepSeek::SubmissionStats inx::DeepSeek::ReactorCore::GetSubmissionStats() const
+{
+	SubmissionStats stats;
+	stats.Capacity = Queue.capacity();
+	stats.Queued = Queue.size();
+	stats.Blocked = BlockedCount.load(std::memory_order_relaxed);
+	stats.Rejected = RejectedCount.load(std::memory_order_relaxed);
+	stats.Dropped = DroppedCount.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void inx::DeepSeek::ReactorCore::Stop()
+{
+	if (Stopping.exchange(true)) {
+		return;
+	}
+	// The submissions fail from now on, the blocked ones included
+	Queue.Close();
+	Drains.fetch_add(1);
+	Drains.notify_all();
+	if (!Hooks) {
+		curl_multi_wakeup(static_cast<CURLM*>(Multi));
+		return;
+	}
+	FailActive();
+	// The loop may be gone once it stopped the reactor, closing the connections must not reach it
+	CURLM* multi = static_cast<CURLM*>(Multi);
+	curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, nullptr);
+	curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, nullptr);
+}
+
+void inx::DeepSeek::ReactorCore::ProcessSubmitted()
+{
+	if (IsStopping()) {
+		return;
+	}
+	// Adding a transfer sets a timer of 0, the loop starts it through OnTimeout
+	AddSubmitted();
+	UpdateTimer();
+}
+
+void inx::DeepSeek::ReactorCore::OnSocketEvent(SocketHandle socket, int events)
+{
+	if (IsStopping()) {
+		return;
+	}
+	int running = 0;
+	curl_multi_socket_action(static_cast<CURLM*>(Multi), static_cast<curl_socket_t>(socket), events, &running);
+	CompleteFinished();
+	Timers.Advance(Clock::now());
+	ResumeReady();
+	UpdateTimer();
+}
+
+void inx::DeepSeek::ReactorCore::OnTimeout()
+{
+	if (IsStopping()) {
+		return;
+	}
+	// The loop timer is spent, a new one is asked for whatever is due next
+	RequestedDue.reset();
+	Clock::time_point now = Clock::now();
+	if (CurlDue && *CurlDue <= now) {
+		CurlDue.reset();
+		int running = 0;
+		curl_multi_socket_action(static_cast<CURLM*>(Multi), CURL_SOCKET_TIMEOUT, 0, &running);
+		CompleteFinished();
+	}
+	Timers.Advance(now);
+	ResumeReady();
+	UpdateTimer();
+}
+
+void inx::DeepSeek::ReactorCore::UpdateTimer()
+{
+	if (!Hooks) {
+		return;
+	}
+	std::optional<Clock::time_point> due = Timers.GetNextDue();
+	if (CurlDue && (!due || *CurlDue < *due)) {
+		due = CurlDue;
+	}
+	if (due == RequestedDue) {
+		return;
+	}
+	RequestedDue = due;
+	Hooks->SetTimer(due ? MillisecondsUntil(*due, Clock::now()) : -1);
+}
+
+void inx::DeepSeek::ReactorCore::AddSubmitted()
+{
+	WakeupPending.store(false, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	ConsumerThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+	for (Transfer* dropped = Dropped.exchange(nullptr, std::memory_order_acquire); dropped;) {
+		Transfer* next = dropped->NextDropped;
+		std::shared_ptr<Transfer> transfer = std::move(dropped->DroppedSelf);
+		transfer->Expire("The request was dropped: the submission queue of the reactor was full", false);
+		ActiveCount--;
+		transfer->OnDone(CURLE_ABORTED_BY_CALLBACK);
+		dropped = next;
+	}
+	StartGranted();
+
+	// At most a queue worth per call, so producers refilling it as fast as it empties don't hold the reactor thread
+	std::shared_ptr<Transfer> transfer;
+	size_t added_count = 0;
+	for (; added_count < Queue.capacity() && Queue.TryPop(transfer); added_count++) {
+		Transfer& added = *transfer;
+		added.Timers = &Timers;
+		Active.emplace(&added, std::move(transfer));
+		if (added.Options.Timeout) {
+			// Counted from the submission, the time waiting for the reactor included
+			Timers.Schedule(added.DeadlineTimer, added.SubmitTime + *added.Options.Timeout, [this, &added]() {
+				Abort(added, "The request didn't complete within " + std::to_string(added.Options.Timeout->count()) + " ms", false);
+			});
+		}
+		if (added.Cancelled) {
+			// Cancelled while it was queued, it doesn't wait for a slot to end
+			EndAttempt(added, CURLE_ABORTED_BY_CALLBACK);
+			continue;
+		}
+		if (added.Scheduler) {
+			added.Ticket.Deadline = added.Options.Timeout ? added.SubmitTime + *added.Options.Timeout : Clock::time_point::max();
+			// Otherwise started by StartGranted once it got its slot, its deadline runs meanwhile
+			bool granted = false;
+			try {
+				granted = added.Scheduler->TryAcquire(added.Ticket, [this, transfer = added.shared_from_this()]() mutable { PushGranted(std::move(transfer)); });
+			}
+			catch (const std::exception& e) {
+				// Rejected by its tenant
+				added.Expire(e.what(), false);
+				EndAttempt(added, CURLE_ABORTED_BY_CALLBACK);
+				continue;
+			}
+			if (!granted) {
+				continue;
+			}
+		}
+		StartAttempt(added);
+	}
+	EndCancelled();
+	if (added_count == Queue.capacity()) {
+		Wakeup();
+	}
+	if (added_count != 0) {
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (BlockedProducers.load() != 0) {
+			Drains.fetch_add(1);
+			Drains.notify_all();
+		}
+	}
+}
+
+void inx::DeepSeek::ReactorCore::StartGranted()
+{
+	// Reversed, so they start in the order the scheduler picked them
+	Transfer* granted = nullptr;
+	for (Transfer* pushed = Granted.exchange(nullptr, std::memory_order_acquire); pushed;) {
+		Transfer* next = pushed->NextGranted;
+		pushed->NextGranted = granted;
+		granted = pushed;
+		pushed = next;
+	}
+	while (granted) {
+		Transfer* next = granted->NextGranted;
+		std::shared_ptr<Transfer> transfer = std::move(granted->GrantedSelf);
+		// Ended in between if its deadline expired, its slot was given back then
+		if (!IsStopping() && Active.contains(transfer.get())) {
+			StartAttempt(*transfer);
+		}
+		granted = next;
+	}
+}
+
+void inx::DeepSeek::ReactorCore::EndCancelled()
+{
+	for (Transfer* cancelled = CancelledTransfers.exchange(nullptr, std::memory_order_acquire); cancelled;) {
+		Transfer* next = cancelled->NextCancelled;
+		std::shared_ptr<Transfer> transfer = std::move(cancelled->CancelledSelf);
+		// Not active anymore if it ended in between, or if the reactor is stopping: FailActive ends it then
+		if (!IsStopping() && Active.contains(transfer.get())) {
+			// Harmless if it waits for its slot or its next attempt outside of the multi handle, EndAttempt takes it out of its scheduler
+			curl_multi_remove_handle(static_cast<CURLM*>(Multi), static_cast<CURL*>(transfer->GetHandle()));
+			EndAttempt(*transfer, CURLE_ABORTED_BY_CALLBACK);
+		}
+		cancelled = next;
+	}
+}
+
+void inx::DeepSeek::ReactorCore::StartAttempt(Transfer& transfer)
+{
+	if (transfer.Cancelled) {
+		// Abandoned during a backoff, curl wouldn't notice it
+		EndAttempt(transfer, CURLE_ABORTED_BY_CALLBACK);
+		return;
+	}
+	transfer.Attempts++;
+	transfer.Received = false;
+	CURL* curl = static_cast<CURL*>(transfer.GetHandle());
+	curl_easy_setopt(curl, CURLOPT_PRIVATE, &transfer);
+	if (curl_multi_add_handle(static_cast<CURLM*>(Multi), curl) != CURLM_OK) {
+		EndAttempt(transfer, CURLE_FAILED_INIT);
+		return;
+	}
+	if (transfer.Options.FirstTokenTimeout) {
+		Timers.Schedule(transfer.AttemptTimer, Clock::now() + *transfer.Options.FirstTokenTimeout, [this, &transfer]() {
+			Abort(transfer, "The first token didn't arrive within " + std::to_string(transfer.Options.FirstTokenTimeout->count()) + " ms", true);
+		});
+	}
+}
+
+void inx::DeepSeek::ReactorCore::EndAttempt(Transfer& transfer, int result)
+{
+	Timers.Cancel(transfer.AttemptTimer);
+	if (transfer.Options.MaxRetries != 0 && !IsStopping() && transfer.PrepareRetry(result)) {
+		// Doubled for every retry, drawn between the half and the whole of it
+		std::chrono::milliseconds backoff = transfer.Options.RetryBackoff * (1LL << std::min<size_t>(transfer.Attempts - 1, 20));
+		std::uniform_int_distribution<long long> draw(backoff.count() / 2, backoff.count());
+		Timers.Schedule(transfer.AttemptTimer, Clock::now() + std::chrono::milliseconds(draw(Jitter)), [this, &transfer]() { StartAttempt(transfer); });
+		return;
+	}
+	Timers.Cancel(transfer.DeadlineTimer);
+	auto found = Active.find(&transfer);
+	if (found == Active.end()) {
+		return;
+	}
+	std::shared_ptr<Transfer> done = std::move(found->second);
+	Active.erase(found);
+	ActiveCount--;
+	if (done->Scheduler) {
+		// Before its coroutine resumes, which may take a while
+		done->Scheduler->Leave(done->Ticket);
+	}
+	done->OnDone(result);
+}
+
+void inx::DeepSeek::ReactorCore::Abort(Transfer& transfer, const std::string& message, bool retryable)
+{
+	transfer.Expire(message, retryable);
+	// Harmless while the transfer waits for its retry outside of the multi handle
+	curl_multi_remove_handle(static_cast<CURLM*>(Multi), static_cast<CURL*>(transfer.GetHandle()));
+	EndAttempt(transfer, CURLE_OPERATION_TIMEDOUT);
+}
+
+void inx::DeepSeek::ReactorCore::CompleteFinished()
+{
+	int queued = 0;
+	while (CURLMsg* message = curl_multi_info_read(static_cast<CURLM*>(Multi), &queued)) {
+		if (message->msg != CURLMSG_DONE) {
+			continue;
+		}
+		CURL* curl = message->easy_handle;
+		CURLcode result = message->data.result;
+		Transfer* key = nullptr;
+		curl_easy_getinfo(curl, CURLINFO_PRIVATE, &key);
+		curl_multi_remove_handle(static_cast<CURLM*>(Multi), curl);
+		EndAttempt(*key, result);
+	}
+}
+
+void inx::DeepSeek::ReactorCore::ResumeReady()
+{
+	// A coroutine stopping a reactor driven by an event loop fails the transfers left from here, the outer call resumes their coroutines
+	if (IsResuming) {
+		return;
+	}
+	IsResuming = true;
+	while (!Ready.empty()) {
+		Resuming.swap(Ready);
+		for (std::coroutine_handle<> coroutine : Resuming) {
+			coroutine.resume();
+		}
+		Resuming.clear();
+	}
+	IsResuming = false;
+}
+
+void inx::DeepSeek::ReactorCore::Run()
+{
+	CURLM* multi = static_cast<CURLM*>(Multi);
+	while (!Stopping) {
+		AddSubmitted();
+		int running = 0;
+		curl_multi_perform(multi, &running);
+		CompleteFinished();
+		Clock::time_point now = Clock::now();
+		Timers.Advance(now);
+		ResumeReady();
+		// curl_multi_poll also waits for the timeouts of curl
+		long timeout_ms = 1000;
+		if (std::optional<Clock::time_point> due = Timers.GetNextDue()) {
+			timeout_ms = std::min(timeout_ms, MillisecondsUntil(*due, now));
+		}
+		curl_multi_poll(multi, nullptr, 0, static_cast<int>(timeout_ms), nullptr);
+	}
+
+	FailActive();
+}
+
+void inx::DeepSeek::ReactorCore::FailActive()
+{
+	// Their coroutines can't submit new requests anymore. The submissions that claimed a cell before the queue closed are waited for
+	CURLM* multi = static_cast<CURLM*>(Multi);
+	AddSubmitted();
+	while (!Queue.IsDrained() || BlockedProducers != 0 || Dropped.load() != nullptr) {
+		std::this_thread::yield();
+		AddSubmitted();
+	}
+	// As are the wakeups of the producers that pushed just before, the hooks must not be called once stopped
+	while (WakeupsInFlight.load() != 0) {
+		std::this_thread::yield();
+	}
+	for (auto& [key, transfer] : Active) {
+		curl_multi_remove_handle(multi, static_cast<CURL*>(transfer->GetHandle()));
+		Timers.Cancel(transfer->DeadlineTimer);
+		Timers.Cancel(transfer->AttemptTimer);
+		transfer->Cancel();
+		if (transfer->Scheduler) {
+			transfer->Scheduler->Leave(transfer->Ticket);
+		}
+		transfer->OnDone(CURLE_ABORTED_BY_CALLBACK);
+	}
+	Active.clear();
+	ActiveCount = 0;
+	// Granted before they left their scheduler, or cancelled before they ended: nothing is pushed anymore
+	StartGranted();
+	EndCancelled();
+	ResumeReady();
+}
+
+inx::DeepSeek::Reactor::Reactor(SubmissionOptions options)
+	: Core(std::make_shared<ReactorCore>(options))
+{
+	Thread = std::thread([core = Core]() { core->Run(); });
+}
+
+inx::DeepSeek::Reactor::Reactor(EventLoopHooks hooks, SubmissionOptions options)
+	: Core(std::make_shared<ReactorCore>(std::move(hooks), options))
+{
+}
+
+inx::DeepSeek::Reactor::~Reactor()
+{
+	Stop();
+}
+
+void inx::DeepSeek::Reactor::Stop()
+{
+	Core->Stop();
+	if (!Thread.joinable()) {
+		return;
+	}
+	if (Thread.get_id() == std::this_thread::get_id()) {
+		// Stopped by a coroutine resumed on the reactor thread, which owns the core and finishes on its own
+		Thread.detach();
+	}
+	else {
+		Thread.join();
+	}
+}
+
+void inx::DeepSeek::Reactor::OnSocketEvent(SocketHandle socket, bool readable, bool writable, bool failed)
+{
+	Core->OnSocketEvent(socket, (readable ? CURL_CSELECT_IN : 0) | (writable ? CURL_CSELECT_OUT : 0) | (failed ? CURL_CSELECT_ERR : 0));
+}
+
+std::shared_ptr<inx::DeepSeek::Reactor> inx::DeepSeek::Reactor::GetDefault()
+{
+	static std::shared_ptr<Reactor> reactor = std::make_shared<Reactor>();
+	return reactor;
+}
\ No newline at end of file
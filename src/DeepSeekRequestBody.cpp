@@ -0,0 +1,107 @@
+#include "DeepSeekRequestBody.h"
+#include "DeepSeekJson.h"
+#include <algorithm>
+#include <cstring>
+
+void inx::DeepSeek::RequestBody::AppendLiteral(std::string_view text)
+{
+	if (text.empty()) {
+		return;
+	}
+	if (!Parts.empty() && Parts.back().Kind == PartKind::Literal) {
+		Parts.back().Length += text.size();
+	}
+	else {
+		Parts.push_back({ PartKind::Literal, nullptr, Literals.size(), text.size() });
+	}
+	Literals += text;
+	Size += text.size();
+}
+
+void inx::DeepSeek::RequestBody::AppendView(std::string_view text)
+{
+	if (text.empty()) {
+		return;
+	}
+	Parts.push_back({ PartKind::View, text.data(), 0, text.size() });
+	Size += text.size();
+}
+
+void inx::DeepSeek::RequestBody::AppendString(std::string_view text)
+{
+	AppendLiteral("\"");
+	if (!text.empty()) {
+		Parts.push_back({ PartKind::Escaped, text.data(), 0, text.size() });
+		Size += JsonStringLength(text) - 2;
+	}
+	AppendLiteral("\"");
+}
+
+size_t inx::DeepSeek::RequestBody::Read(char* buffer, size_t capacity)
+{
+	size_t written = 0;
+	while (written < capacity && PartIndex < Parts.size()) {
+		const Part& part = Parts[PartIndex];
+		if (part.Kind != PartKind::Escaped) {
+			const char* data = part.Kind == PartKind::Literal ? Literals.data() + part.Offset : part.Data;
+			size_t count = std::min(capacity - written, part.Length - PartPosition);
+			std::memcpy(buffer + written, data + PartPosition, count);
+			written += count;
+			PartPosition += count;
+		}
+		else {
+			if (PendingPosition == Pending.size()) {
+				if (PartPosition == part.Length) {
+					Pending.clear();
+					PendingPosition = 0;
+					PartIndex++;
+					PartPosition = 0;
+					continue;
+				}
+				// Escapes the next piece, ending it before a UTF-8 sequence it would split
+				size_t end = std::min(part.Length, PartPosition + ChunkSize);
+				if (end < part.Length) {
+					size_t boundary = end;
+					while (boundary > PartPosition && end - boundary < 4 && (static_cast<unsigned char>(part.Data[boundary]) & 0xC0) == 0x80) {
+						boundary--;
+					}
+					if (boundary > PartPosition) {
+						end = boundary;
+					}
+				}
+				Pending.clear();
+				PendingPosition = 0;
+				AppendJsonEscaped(Pending, std::string_view(part.Data + PartPosition, end - PartPosition));
+				PartPosition = end;
+			}
+			size_t count = std::min(capacity - written, Pending.size() - PendingPosition);
+			std::memcpy(buffer + written, Pending.data() + PendingPosition, count);
+			written += count;
+			PendingPosition += count;
+			continue;
+		}
+		if (PartPosition == part.Length) {
+			PartIndex++;
+			PartPosition = 0;
+		}
+	}
+	return written;
+}
+
+void inx::DeepSeek::RequestBody::Rewind()
+{
+	PartIndex = 0;
+	PartPosition = 0;
+	Pending.clear();
+	PendingPosition = 0;
+}
+
+std::string inx::DeepSeek::RequestBody::ToString()
+{
+	Rewind();
+	std::string body(Size, '\0');
+	size_t read = Read(body.data(), body.size());
+	body.resize(read);
+	Rewind();
+	return body;
+}
@@ -0,0 +1,397 @@
+#include "DeepSeekScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+// The smallest weight, so a tenant always gets a part of the quantum
+static constexpr double MinWeight = 1.0 / 1024;
+// The weight of the latest completion in the prediction of a tag once it has enough of them, so it follows the changes of the workload
+static constexpr double MinLearningRate = 1.0 / 16;
+
+inx::DeepSeek::RequestScheduler::RequestScheduler(SchedulerOptions options)
+	: Options(options)
+{
+	Options.MaxInFlight = std::max<size_t>(Options.MaxInFlight, 1);
+	Options.ReservedSlots = std::min(Options.ReservedSlots, Options.MaxInFlight - 1);
+	Options.Quantum = std::max<size_t>(Options.Quantum, 1);
+	Options.DefaultTenant.Weight = std::max(Options.DefaultTenant.Weight, MinWeight);
+}
+
+void inx::DeepSeek::RequestScheduler::SetTenant(std::string_view tenant, TenantOptions options)
+{
+	std::lock_guard lock(Mutex);
+	options.Weight = std::max(options.Weight, MinWeight);
+	auto [found, created] = Tenants.try_emplace(std::string(tenant));
+	TenantState& state = found->second;
+	Clock::time_point now = Clock::now();
+	if (created) {
+		state.Budget = static_cast<double>(options.TokensPerMinute);
+		state.Refilled = now;
+		state.FirstRequest = now;
+	}
+	else if (state.Options.TokensPerMinute == 0) {
+		// A new budget starts full
+		state.Budget = static_cast<double>(options.TokensPerMinute);
+		state.Refilled = now;
+	}
+	else {
+		Refill(state, now);
+		state.Budget = std::min(state.Budget, static_cast<double>(options.TokensPerMinute));
+	}
+	state.Options = options;
+	// A higher cap lets its waiting requests take the free slots
+	Dispatch();
+}
+
+bool inx::DeepSeek::RequestScheduler::HasSlot(RequestPriority priority) const
+{
+	size_t limit = Options.MaxInFlight;
+	if (priority == RequestPriority::Batch) {
+		limit -= Options.ReservedSlots;
+	}
+	return InFlight < limit;
+}
+
+void inx::DeepSeek::RequestScheduler::Refill(TenantState& tenant, Clock::time_point now) const
+{
+	if (tenant.Options.TokensPerMinute == 0) {
+		return;
+	}
+	double per_minute = static_cast<double>(tenant.Options.TokensPerMinute);
+	double refilled = per_minute * std::chrono::duration<double, std::ratio<60>>(now - tenant.Refilled).count();
+	tenant.Budget = std::min(per_minute, tenant.Budget + refilled);
+	tenant.Refilled = now;
+}
+
+bool inx::DeepSeek::RequestScheduler::Enter(Ticket& ticket)
+{
+	size_t index = static_cast<size_t>(ticket.Priority);
+	Clock::time_point now = Clock::now();
+	auto [found, created] = Tenants.try_emplace(ticket.Tenant);
+	TenantState& tenant = found->second;
+	if (created) {
+		tenant.Options = Options.DefaultTenant;
+		tenant.Budget = static_cast<double>(tenant.Options.TokensPerMinute);
+		tenant.Refilled = now;
+		tenant.FirstRequest = now;
+	}
+	ticket.Owner = &tenant;
+	ticket.Cost = ticket.PromptTokens + static_cast<size_t>(Predict(ticket.Tag));
+	bool shortest_first = Options.ShortestPredictedFirst;
+	ticket.QueuedDeadline = shortest_first ? Clock::time_point::max() : ticket.Deadline;
+	ticket.QueuedCost = shortest_first ? ticket.Cost : 0;
+
+	if (tenant.Options.MaxQueued != 0 && tenant.Queued >= tenant.Options.MaxQueued) {
+		tenant.Rejected++;
+		throw std::runtime_error("The request was rejected: the tenant \"" + ticket.Tenant + "\" already has "
+			+ std::to_string(tenant.Queued) + " requests waiting");
+	}
+	ticket.Charged = 0;
+	if (tenant.Options.TokensPerMinute != 0) {
+		Refill(tenant, now);
+		if (tenant.Budget <= 0) {
+			tenant.Rejected++;
+			throw std::runtime_error("The request was rejected: the tenant \"" + ticket.Tenant + "\" is over its budget of "
+				+ std::to_string(tenant.Options.TokensPerMinute) + " tokens per minute");
+		}
+		ticket.Charged = static_cast<double>(ticket.Cost);
+		tenant.Budget -= ticket.Charged;
+	}
+
+	for (size_t lower = index + 1; lower < RequestPriorityCount; lower++) {
+		if (Classes[lower].Waiting != 0) {
+			Classes[lower].Preempted++;
+		}
+	}
+
+	// Queued behind the requests going first, which got the free slots already unless their tenant is at its cap
+	Queue& waiting = tenant.Waiting[index];
+	if (waiting.empty()) {
+		// A new turn starts with its quantum
+		tenant.Deficit[index] = static_cast<double>(Options.Quantum) * tenant.Options.Weight;
+		Classes[index].Round.push_back(&tenant);
+	}
+	ticket.Sequence = NextSequence++;
+	ticket.Enqueued = now;
+	ticket.Status = Ticket::State::Waiting;
+	waiting.emplace(std::make_tuple(ticket.QueuedDeadline, ticket.QueuedCost, ticket.Sequence), &ticket);
+	if (shortest_first && ticket.Deadline != Clock::time_point::max()) {
+		// Once its slack is below the time it takes, it can't wait for the shorter ones anymore: it still needs a slot, which takes up to a request too
+		Clock::duration service = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(PredictService(ticket.Tag)));
+		ticket.PromoteAt = ticket.Deadline - 2 * service;
+		tenant.Deadlines[index].emplace(std::make_pair(ticket.PromoteAt, ticket.Sequence), &ticket);
+	}
+	tenant.Queued++;
+	Classes[index].Waiting++;
+	Dispatch(&ticket);
+	return ticket.Status == Ticket::State::Granted;
+}
+
+inx::DeepSeek::RequestScheduler::Ticket& inx::DeepSeek::RequestScheduler::Front(TenantState& tenant, size_t index, Clock::time_point now) const
+{
+	const Promotions& deadlines = tenant.Deadlines[index];
+	if (!deadlines.empty() && deadlines.begin()->first.first <= now) {
+		return *deadlines.begin()->second;
+	}
+	return *tenant.Waiting[index].begin()->second;
+}
+
+void inx::DeepSeek::RequestScheduler::Remove(TenantState& tenant, size_t index, Ticket& ticket)
+{
+	tenant.Waiting[index].erase(std::make_tuple(ticket.QueuedDeadline, ticket.QueuedCost, ticket.Sequence));
+	if (Options.ShortestPredictedFirst && ticket.Deadline != Clock::time_point::max()) {
+		tenant.Deadlines[index].erase(std::make_pair(ticket.PromoteAt, ticket.Sequence));
+	}
+	tenant.Queued--;
+	Classes[index].Waiting--;
+}
+
+inx::DeepSeek::RequestScheduler::Ticket* inx::DeepSeek::RequestScheduler::PickNext(size_t index, Clock::time_point now)
+{
+	std::deque<TenantState*>& round = Classes[index].Round;
+	while (true) {
+		bool eligible = false;
+		for (size_t turn = 0, count = round.size(); turn < count; turn++) {
+			TenantState& tenant = *round.front();
+			if (tenant.Options.MaxInFlight != 0 && tenant.InFlight >= tenant.Options.MaxInFlight) {
+				// At its cap, its turn passes without a quantum
+				round.push_back(round.front());
+				round.pop_front();
+				continue;
+			}
+			eligible = true;
+			Ticket& head = Front(tenant, index, now);
+			if (tenant.Deficit[index] >= static_cast<double>(head.Cost)) {
+				// Keeps its turn while its deficit covers its requests
+				tenant.Deficit[index] -= static_cast<double>(head.Cost);
+				Remove(tenant, index, head);
+				if (tenant.Waiting[index].empty()) {
+					tenant.Deficit[index] = 0;
+					round.pop_front();
+				}
+				return &head;
+			}
+			// Its turn is over, the next one adds a quantum
+			tenant.Deficit[index] += static_cast<double>(Options.Quantum) * tenant.Options.Weight;
+			round.push_back(round.front());
+			round.pop_front();
+		}
+		if (!eligible) {
+			return nullptr;
+		}
+		// A whole round served nobody: skips the rounds until the first eligible tenant can send its request, in one step rather than a pass each
+		// (with a small weight, a large request would otherwise take thousands of passes under the lock)
+		double rounds = std::numeric_limits<double>::max();
+		for (TenantState* tenant : round) {
+			if (tenant->Options.MaxInFlight != 0 && tenant->InFlight >= tenant->Options.MaxInFlight) {
+				continue;
+			}
+			double missing = static_cast<double>(Front(*tenant, index, now).Cost) - tenant->Deficit[index];
+			rounds = std::min(rounds, std::ceil(missing / (static_cast<double>(Options.Quantum) * tenant->Options.Weight)));
+		}
+		if (rounds > 0) {
+			for (TenantState* tenant : round) {
+				if (tenant->Options.MaxInFlight == 0 || tenant->InFlight < tenant->Options.MaxInFlight) {
+					tenant->Deficit[index] += rounds * static_cast<double>(Options.Quantum) * tenant->Options.Weight;
+				}
+			}
+		}
+	}
+}
+
+void inx::DeepSeek::RequestScheduler::Grant(Ticket& ticket, Clock::time_point now)
+{
+	ClassState& state = Classes[static_cast<size_t>(ticket.Priority)];
+	TenantState& tenant = *ticket.Owner;
+	ticket.Status = Ticket::State::Granted;
+	ticket.GrantedAt = now;
+	InFlight++;
+	tenant.InFlight++;
+	state.Granted++;
+	tenant.Granted++;
+	Clock::duration wait = now - ticket.Enqueued;
+	state.TotalWait += wait;
+	state.MaxWait = std::max(state.MaxWait, wait);
+	tenant.TotalWait += wait;
+	tenant.MaxWait = std::max(tenant.MaxWait, wait);
+}
+
+void inx::DeepSeek::RequestScheduler::Dispatch(const Ticket* entering)
+{
+	// A lower class only gets a slot once the higher ones have nothing left to send, or only tenants at their cap
+	Clock::time_point now = Clock::now();
+	for (size_t index = 0; index < RequestPriorityCount; index++) {
+		while (Classes[index].Waiting != 0 && HasSlot(static_cast<RequestPriority>(index))) {
+			Ticket* picked = PickNext(index, now);
+			if (!picked) {
+				break;
+			}
+			Ticket& ticket = *picked;
+			Grant(ticket, now);
+			if (&ticket == entering) {
+				continue;
+			}
+			if (ticket.OnGranted) {
+				std::function<void()> on_granted = std::move(ticket.OnGranted);
+				ticket.OnGranted = nullptr;
+				on_granted();
+			}
+			else {
+				// Under the lock, the thread can't return and destroy the ticket before it's notified
+				ticket.Woken.notify_one();
+			}
+		}
+	}
+}
+
+void inx::DeepSeek::RequestScheduler::Acquire(Ticket& ticket)
+{
+	std::unique_lock lock(Mutex);
+	ticket.OnGranted = nullptr;
+	if (Enter(ticket)) {
+		return;
+	}
+	ticket.Woken.wait(lock, [&ticket]() { return ticket.Status == Ticket::State::Granted; });
+}
+
+bool inx::DeepSeek::RequestScheduler::TryAcquire(Ticket& ticket, std::function<void()> on_granted)
+{
+	std::lock_guard lock(Mutex);
+	if (Enter(ticket)) {
+		return true;
+	}
+	ticket.OnGranted = std::move(on_granted);
+	return false;
+}
+
+void inx::DeepSeek::RequestScheduler::Leave(Ticket& ticket)
+{
+	// Destroyed once unlocked, it may hold the last reference to the request
+	std::function<void()> on_granted;
+	std::lock_guard lock(Mutex);
+	switch (ticket.Status) {
+	case Ticket::State::Idle:
+		return;
+	case Ticket::State::Waiting: {
+		size_t index = static_cast<size_t>(ticket.Priority);
+		TenantState& tenant = *ticket.Owner;
+		Remove(tenant, index, ticket);
+		if (tenant.Waiting[index].empty()) {
+			std::deque<TenantState*>& round = Classes[index].Round;
+			round.erase(std::find(round.begin(), round.end(), &tenant));
+			tenant.Deficit[index] = 0;
+		}
+		// Never sent, so not charged
+		tenant.Budget += ticket.Charged;
+		ticket.Charged = 0;
+		on_granted = std::move(ticket.OnGranted);
+		ticket.OnGranted = nullptr;
+		break;
+	}
+	case Ticket::State::Granted:
+		InFlight--;
+		ticket.Owner->InFlight--;
+		Dispatch();
+		break;
+	}
+	ticket.Status = Ticket::State::Idle;
+}
+
+void inx::DeepSeek::RequestScheduler::TagState::Add(double completion_tokens, double service_seconds)
+{
+	// The mean of the first ones, then a moving average
+	Completed++;
+	double rate = std::max(1.0 / static_cast<double>(Completed), MinLearningRate);
+	MeanCompletionTokens += (completion_tokens - MeanCompletionTokens) * rate;
+	MeanServiceSeconds += (service_seconds - MeanServiceSeconds) * rate;
+}
+
+double inx::DeepSeek::RequestScheduler::Predict(std::string_view tag) const
+{
+	auto found = Tags.find(std::string(tag));
+	return found != Tags.end() ? found->second.MeanCompletionTokens : AllTags.MeanCompletionTokens;
+}
+
+double inx::DeepSeek::RequestScheduler::PredictService(std::string_view tag) const
+{
+	auto found = Tags.find(std::string(tag));
+	return found != Tags.end() ? found->second.MeanServiceSeconds : AllTags.MeanServiceSeconds;
+}
+
+double inx::DeepSeek::RequestScheduler::PredictCompletionTokens(std::string_view tag) const
+{
+	std::lock_guard lock(Mutex);
+	return Predict(tag);
+}
+
+void inx::DeepSeek::RequestScheduler::Complete(Ticket& ticket, const Usage& usage)
+{
+	std::lock_guard lock(Mutex);
+	TenantState* tenant = ticket.Owner;
+	if (!tenant) {
+		return;
+	}
+	size_t total_tokens = static_cast<size_t>(std::max(usage.TotalTokens, 0));
+	if (total_tokens != 0) {
+		// Without a reported usage there's nothing to learn from
+		double completion_tokens = static_cast<double>(std::max(usage.CompletionTokens, 0));
+		// From the moment it got its slot, retries included
+		double service_seconds = std::chrono::duration<double>(Clock::now() - ticket.GrantedAt).count();
+		Tags[ticket.Tag].Add(completion_tokens, service_seconds);
+		AllTags.Add(completion_tokens, service_seconds);
+	}
+	tenant->Completed++;
+	tenant->Tokens += total_tokens;
+	if (tenant->Options.TokensPerMinute != 0) {
+		// The estimate charged on arrival is replaced by the actual usage
+		tenant->Budget -= static_cast<double>(total_tokens) - ticket.Charged;
+	}
+	ticket.Charged = 0;
+}
+
+inx::DeepSeek::SchedulerStats inx::DeepSeek::RequestScheduler::GetStats() const
+{
+	using Milliseconds = std::chrono::duration<double, std::milli>;
+	std::lock_guard lock(Mutex);
+	SchedulerStats stats;
+	stats.InFlight = InFlight;
+	for (size_t index = 0; index < RequestPriorityCount; index++) {
+		const ClassState& state = Classes[index];
+		PriorityStats& priority = stats.Classes[index];
+		priority.Granted = state.Granted;
+		priority.Waiting = state.Waiting;
+		priority.Preempted = state.Preempted;
+		if (state.Granted != 0) {
+			priority.MeanWaitMs = Milliseconds(state.TotalWait).count() / static_cast<double>(state.Granted);
+		}
+		priority.MaxWaitMs = Milliseconds(state.MaxWait).count();
+	}
+
+	Clock::time_point now = Clock::now();
+	for (const auto& [id, tenant] : Tenants) {
+		TenantStats& entry = stats.Tenants[id];
+		entry.Granted = tenant.Granted;
+		entry.Completed = tenant.Completed;
+		entry.Rejected = tenant.Rejected;
+		entry.Waiting = tenant.Queued;
+		entry.InFlight = tenant.InFlight;
+		entry.Tokens = tenant.Tokens;
+		double seconds = std::chrono::duration<double>(now - tenant.FirstRequest).count();
+		if (seconds > 0) {
+			entry.TokensPerSecond = static_cast<double>(tenant.Tokens) / seconds;
+		}
+		if (tenant.Granted != 0) {
+			entry.MeanWaitMs = Milliseconds(tenant.TotalWait).count() / static_cast<double>(tenant.Granted);
+		}
+		entry.MaxWaitMs = Milliseconds(tenant.MaxWait).count();
+	}
+
+	for (const auto& [tag, state] : Tags) {
+		TagStats& entry = stats.Tags[tag];
+		entry.Completed = state.Completed;
+		entry.PredictedCompletionTokens = state.MeanCompletionTokens;
+		entry.PredictedServiceMs = state.MeanServiceSeconds * 1000;
+	}
+	return stats;
+}
\ No newline at end of file
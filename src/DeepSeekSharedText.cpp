@@ -0,0 +1,72 @@
+#include "DeepSeekSharedText.h"
+#include "DeepSeekJson.h"
+#include <unordered_map>
+
+namespace {
+	struct InternEntry {
+		// Identifies the entry's owner, the weak pointer can't be compared once it expired
+		const inx::DeepSeek::SharedText* Text;
+		std::weak_ptr<const inx::DeepSeek::SharedText> Weak;
+	};
+
+	struct InternTable {
+		std::mutex Mutex;
+		// The keys view the text of their entry
+		std::unordered_map<std::string_view, InternEntry> Entries;
+	};
+
+	// Never destroyed, interned texts can outlive the static objects
+	InternTable& GetInternTable()
+	{
+		static InternTable* table = new InternTable();
+		return *table;
+	}
+}
+
+std::shared_ptr<const inx::DeepSeek::SharedText> inx::DeepSeek::SharedText::Intern(std::string_view text)
+{
+	InternTable& table = GetInternTable();
+	std::lock_guard lock(table.Mutex);
+	auto it = table.Entries.find(text);
+	if (it != table.Entries.end()) {
+		if (auto existing = it->second.Weak.lock()) {
+			return existing;
+		}
+		// Expired but its deleter hasn't run yet, the new text takes over the entry
+		table.Entries.erase(it);
+	}
+
+	std::shared_ptr<const SharedText> created(new SharedText(std::string(text)), [](const SharedText* dying) {
+		dying->Unintern();
+		delete dying;
+	});
+	table.Entries.emplace(created->View(), InternEntry{ created.get(), created });
+	return created;
+}
+
+void inx::DeepSeek::SharedText::Unintern() const
+{
+	InternTable& table = GetInternTable();
+	std::lock_guard lock(table.Mutex);
+	auto it = table.Entries.find(View());
+	if (it != table.Entries.end() && it->second.Text == this) {
+		table.Entries.erase(it);
+	}
+}
+
+size_t inx::DeepSeek::SharedText::GetInternedCount()
+{
+	InternTable& table = GetInternTable();
+	std::lock_guard lock(table.Mutex);
+	return table.Entries.size();
+}
+
+const std::string& inx::DeepSeek::SharedText::GetEscapedJSON() const
+{
+	std::call_once(EscapedOnce, [this]() {
+		std::string escaped;
+		AppendJsonString(escaped, Text);
+		Escaped = std::move(escaped);
+	});
+	return Escaped;
+}
@@ -0,0 +1,502 @@
+#include "DeepSeekSimd.h"
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+#ifdef INX_DEEPSEEK_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit vector instructions in functions that opt into them,
+// MSVC emits them anywhere, which is fine since the callers check the CPU first.
+#if defined(__GNUC__) || defined(__clang__)
+#define INX_DEEPSEEK_TARGET(features) __attribute__((target(features)))
+#else
+#define INX_DEEPSEEK_TARGET(features)
+#endif
+
+using SpanAsciiFunction = size_t (*)(const char*, size_t, const inx::DeepSeek::AsciiSet&);
+using SpanJsonPlainFunction = size_t (*)(const char*, size_t);
+using IsValidUtf8Function = bool (*)(const char*, size_t);
+
+size_t inx::DeepSeek::Utf8SequenceLength(const char* data, size_t size)
+{
+	unsigned char lead = static_cast<unsigned char>(data[0]);
+	size_t length;
+	unsigned char min_second = 0x80, max_second = 0xBF;
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+	}
+	else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		if (lead == 0xE0) {
+			min_second = 0xA0;
+		}
+		else if (lead == 0xED) {
+			max_second = 0x9F;
+		}
+	}
+	else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		if (lead == 0xF0) {
+			min_second = 0x90;
+		}
+		else if (lead == 0xF4) {
+			max_second = 0x8F;
+		}
+	}
+	else {
+		return 0;
+	}
+	if (length > size) {
+		return 0;
+	}
+	unsigned char second = static_cast<unsigned char>(data[1]);
+	if (second < min_second || second > max_second) {
+		return 0;
+	}
+	for (size_t i = 2; i < length; i++) {
+		unsigned char continuation = static_cast<unsigned char>(data[i]);
+		if (continuation < 0x80 || continuation > 0xBF) {
+			return 0;
+		}
+	}
+	return length;
+}
+
+
+static size_t SpanAsciiScalar(const char* data, size_t size, const inx::DeepSeek::AsciiSet& set)
+{
+	size_t i = 0;
+	while (i < size && set.Contains(static_cast<unsigned char>(data[i]))) {
+		i++;
+	}
+	return i;
+}
+
+#ifdef INX_DEEPSEEK_X86
+INX_DEEPSEEK_TARGET("sse4.2")
+static size_t SpanAsciiSSE42(const char* data, size_t size, const inx::DeepSeek::AsciiSet& set)
+{
+	size_t i = 0;
+	if (set.RangeCount <= 8) {
+		// One PCMPESTRI per block: the index of the first byte outside of the ranges, 16 if there's none
+		const __m128i ranges = _mm_loadu_si128(reinterpret_cast<const __m128i*>(set.Ranges));
+		const int range_length = set.RangeCount * 2;
+		for (; i + 16 <= size; i += 16) {
+			__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+			int index = _mm_cmpestri(ranges, range_length, block, 16,
+				_SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT);
+			if (index < 16) {
+				return i + index;
+			}
+		}
+	}
+	return i + SpanAsciiScalar(data + i, size - i, set);
+}
+
+INX_DEEPSEEK_TARGET("avx2")
+static size_t SpanAsciiAVX2(const char* data, size_t size, const inx::DeepSeek::AsciiSet& set)
+{
+	// A byte is a member if the bit of its high nibble is set in the entry of its low nibble.
+	// Bytes above 0x7F have a high nibble of 8 or more, which maps to no bit at all.
+	const __m256i low_table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(set.LowNibbles)));
+	const __m256i high_table = _mm256_setr_epi8(
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0,
+		1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+	const __m256i zero = _mm256_setzero_si256();
+
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		__m256i low = _mm256_and_si256(block, nibble);
+		__m256i high = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+		__m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(low_table, low), _mm256_shuffle_epi8(high_table, high));
+		unsigned outside = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, zero)));
+		if (outside != 0) {
+			return i + std::countr_zero(outside);
+		}
+	}
+	return i + SpanAsciiSSE42(data + i, size - i, set);
+}
+#endif
+
+static bool IsValidUtf8Scalar(const char* data, size_t size)
+{
+	size_t i = 0;
+	while (i < size) {
+		if (static_cast<unsigned char>(data[i]) < 0x80) {
+			i++;
+			continue;
+		}
+		size_t length = inx::DeepSeek::Utf8SequenceLength(data + i, size - i);
+		if (length == 0) {
+			return false;
+		}
+		i += length;
+	}
+	return true;
+}
+
+#ifdef INX_DEEPSEEK_X86
+// The lookup validation from "Validating UTF-8 In Less Than One Instruction Per Byte" (Keiser, Lemire):
+// every pair of consecutive bytes is classified with 3 table lookups on nibbles, the bits left set are errors,
+// except for the 3rd and 4th bytes of sequences, which are checked from the bytes 2 and 3 positions back.
+namespace Utf8Lookup {
+	constexpr char TooShort = 1 << 0;   // 11______ 0_______ or 11______ 11______
+	constexpr char TooLong = 1 << 1;    // 0_______ 10______
+	constexpr char Overlong3 = 1 << 2;  // 11100000 100_____
+	constexpr char TooLarge = 1 << 3;   // 11110100 1001____, 11110100 101_____, 11110101+ 1001____ or 101_____
+	constexpr char Surrogate = 1 << 4;  // 11101101 101_____
+	constexpr char Overlong2 = 1 << 5;  // 1100000_ 10______
+	constexpr char TooLarge1000 = 1 << 6; // 11110101+ 1000____
+	constexpr char Overlong4 = 1 << 6;  // 11110000 1000____
+	constexpr char TwoContinuations = static_cast<char>(1 << 7); // 10______ 10______
+	constexpr char Carry = TooShort | TooLong | TwoContinuations;
+
+	// Indexed by the high nibble of the first byte
+	constexpr char FirstHigh[16] = {
+		TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+		TwoContinuations, TwoContinuations, TwoContinuations, TwoContinuations,
+		TooShort | Overlong2,
+		TooShort,
+		TooShort | Overlong3 | Surrogate,
+		TooShort | TooLarge | TooLarge1000 | Overlong4
+	};
+	// Indexed by the low nibble of the first byte
+	constexpr char FirstLow[16] = {
+		Carry | Overlong3 | Overlong2 | Overlong4,
+		Carry | Overlong2,
+		Carry,
+		Carry,
+		Carry | TooLarge,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000 | Surrogate,
+		Carry | TooLarge | TooLarge1000,
+		Carry | TooLarge | TooLarge1000
+	};
+	// Indexed by the high nibble of the second byte
+	constexpr char SecondHigh[16] = {
+		TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+		TooLong | Overlong2 | TwoContinuations | Overlong3 | TooLarge1000 | Overlong4,
+		TooLong | Overlong2 | TwoContinuations | Overlong3 | TooLarge,
+		TooLong | Overlong2 | TwoContinuations | Surrogate | TooLarge,
+		TooLong | Overlong2 | TwoContinuations | Surrogate | TooLarge,
+		TooShort, TooShort, TooShort, TooShort
+	};
+	// A block ending with these bytes (or above) ends in the middle of a sequence
+	constexpr char IncompleteBelow[32] = {
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+		-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, static_cast<char>(0xEF), static_cast<char>(0xDF), static_cast<char>(0xBF)
+	};
+}
+
+INX_DEEPSEEK_TARGET("sse4.2")
+static bool IsValidUtf8SSE42(const char* data, size_t size)
+{
+	const __m128i first_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::FirstHigh));
+	const __m128i first_low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::FirstLow));
+	const __m128i second_high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::SecondHigh));
+	const __m128i incomplete_below = _mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::IncompleteBelow + 16));
+	const __m128i nibble = _mm_set1_epi8(0x0F);
+
+	__m128i error = _mm_setzero_si128();
+	__m128i previous = _mm_setzero_si128();
+	__m128i previous_incomplete = _mm_setzero_si128();
+	alignas(16) char tail[16] = {};
+	for (size_t i = 0; i < size; i += 16) {
+		const char* source = data + i;
+		if (size - i < 16) {
+			// The end is padded with zeros, which are ASCII
+			std::memcpy(tail, source, size - i);
+			source = tail;
+		}
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+		if (_mm_movemask_epi8(block) == 0) {
+			// ASCII only, the previous block must not have ended in a sequence
+			error = _mm_or_si128(error, previous_incomplete);
+			previous_incomplete = _mm_setzero_si128();
+			previous = block;
+			continue;
+		}
+		__m128i previous1 = _mm_alignr_epi8(block, previous, 15);
+		__m128i classes = _mm_and_si128(
+			_mm_and_si128(
+				_mm_shuffle_epi8(first_high, _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble)),
+				_mm_shuffle_epi8(first_low, _mm_and_si128(previous1, nibble))),
+			_mm_shuffle_epi8(second_high, _mm_and_si128(_mm_srli_epi16(block, 4), nibble)));
+		__m128i previous2 = _mm_alignr_epi8(block, previous, 14);
+		__m128i previous3 = _mm_alignr_epi8(block, previous, 13);
+		__m128i must_continue = _mm_or_si128(
+			_mm_subs_epu8(previous2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+			_mm_subs_epu8(previous3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+		must_continue = _mm_and_si128(must_continue, _mm_set1_epi8(static_cast<char>(0x80)));
+		error = _mm_or_si128(error, _mm_xor_si128(must_continue, classes));
+		previous_incomplete = _mm_subs_epu8(block, incomplete_below);
+		previous = block;
+	}
+	error = _mm_or_si128(error, previous_incomplete);
+	return _mm_testz_si128(error, error) != 0;
+}
+
+INX_DEEPSEEK_TARGET("avx2")
+static bool IsValidUtf8AVX2(const char* data, size_t size)
+{
+	const __m256i first_high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::FirstHigh)));
+	const __m256i first_low = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::FirstLow)));
+	const __m256i second_high = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(Utf8Lookup::SecondHigh)));
+	const __m256i incomplete_below = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(Utf8Lookup::IncompleteBelow));
+	const __m256i nibble = _mm256_set1_epi8(0x0F);
+
+	__m256i error = _mm256_setzero_si256();
+	__m256i previous = _mm256_setzero_si256();
+	__m256i previous_incomplete = _mm256_setzero_si256();
+	alignas(32) char tail[32] = {};
+	for (size_t i = 0; i < size; i += 32) {
+		const char* source = data + i;
+		if (size - i < 32) {
+			// The end is padded with zeros, which are ASCII
+			std::memcpy(tail, source, size - i);
+			source = tail;
+		}
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source));
+		if (_mm256_movemask_epi8(block) == 0) {
+			// ASCII only, the previous block must not have ended in a sequence
+			error = _mm256_or_si256(error, previous_incomplete);
+			previous_incomplete = _mm256_setzero_si256();
+			previous = block;
+			continue;
+		}
+		// The block shifted by 1 to 3 bytes, with the end of the previous block in front
+		__m256i shifted = _mm256_permute2x128_si256(previous, block, 0x21);
+		__m256i previous1 = _mm256_alignr_epi8(block, shifted, 15);
+		__m256i classes = _mm256_and_si256(
+			_mm256_and_si256(
+				_mm256_shuffle_epi8(first_high, _mm256_and_si256(_mm256_srli_epi16(previous1, 4), nibble)),
+				_mm256_shuffle_epi8(first_low, _mm256_and_si256(previous1, nibble))),
+			_mm256_shuffle_epi8(second_high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble)));
+		__m256i previous2 = _mm256_alignr_epi8(block, shifted, 14);
+		__m256i previous3 = _mm256_alignr_epi8(block, shifted, 13);
+		__m256i must_continue = _mm256_or_si256(
+			_mm256_subs_epu8(previous2, _mm256_set1_epi8(static_cast<char>(0xE0 - 0x80))),
+			_mm256_subs_epu8(previous3, _mm256_set1_epi8(static_cast<char>(0xF0 - 0x80))));
+		must_continue = _mm256_and_si256(must_continue, _mm256_set1_epi8(static_cast<char>(0x80)));
+		error = _mm256_or_si256(error, _mm256_xor_si256(must_continue, classes));
+		previous_incomplete = _mm256_subs_epu8(block, incomplete_below);
+		previous = block;
+	}
+	error = _mm256_or_si256(error, previous_incomplete);
+	return _mm256_testz_si256(error, error) != 0;
+}
+#endif
+
+static size_t SpanJsonPlainScalar(const char* data, size_t size)
+{
+	size_t i = 0;
+	while (i < size) {
+		unsigned char c = static_cast<unsigned char>(data[i]);
+		if (c < 0x20 || c >= 0x80 || c == '"' || c == '\\') {
+			break;
+		}
+		i++;
+	}
+	return i;
+}
+
+#ifdef INX_DEEPSEEK_X86
+// Compared as signed bytes, the bytes above 0x7F are negative, so a single "less than 0x20" catches them with the control characters
+INX_DEEPSEEK_TARGET("sse4.2")
+static size_t SpanJsonPlainSSE42(const char* data, size_t size)
+{
+	const __m128i space = _mm_set1_epi8(0x20);
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+
+	size_t i = 0;
+	for (; i + 16 <= size; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		__m128i special = _mm_or_si128(_mm_cmplt_epi8(block, space),
+			_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)));
+		unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+		if (mask != 0) {
+			return i + std::countr_zero(mask);
+		}
+	}
+	return i + SpanJsonPlainScalar(data + i, size - i);
+}
+
+INX_DEEPSEEK_TARGET("avx2")
+static size_t SpanJsonPlainAVX2(const char* data, size_t size)
+{
+	const __m256i space = _mm256_set1_epi8(0x20);
+	const __m256i quote = _mm256_set1_epi8('"');
+	const __m256i backslash = _mm256_set1_epi8('\\');
+
+	size_t i = 0;
+	for (; i + 32 <= size; i += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		__m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space, block),
+			_mm256_or_si256(_mm256_cmpeq_epi8(block, quote), _mm256_cmpeq_epi8(block, backslash)));
+		unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+		if (mask != 0) {
+			return i + std::countr_zero(mask);
+		}
+	}
+	return i + SpanJsonPlainSSE42(data + i, size - i);
+}
+#endif
+
+static inx::DeepSeek::InstructionSet DetectInstructionSet()
+{
+#ifdef INX_DEEPSEEK_X86
+	bool sse42 = false;
+	bool avx2 = false;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int max_leaf = info[0];
+	__cpuid(info, 1);
+	sse42 = (info[2] & (1 << 20)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	// AVX2 also needs the OS to save the YMM registers
+	if (max_leaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	sse42 = __builtin_cpu_supports("sse4.2");
+	avx2 = __builtin_cpu_supports("avx2");
+#endif
+	if (avx2) {
+		return inx::DeepSeek::InstructionSet::AVX2;
+	}
+	if (sse42) {
+		return inx::DeepSeek::InstructionSet::SSE42;
+	}
+#endif
+	return inx::DeepSeek::InstructionSet::Scalar;
+}
+
+static inx::DeepSeek::InstructionSet SupportedInstructionSet()
+{
+	static const inx::DeepSeek::InstructionSet supported = DetectInstructionSet();
+	return supported;
+}
+
+static SpanAsciiFunction SpanAsciiFor(inx::DeepSeek::InstructionSet instruction_set)
+{
+	switch (instruction_set) {
+#ifdef INX_DEEPSEEK_X86
+	case inx::DeepSeek::InstructionSet::AVX2:
+		return SpanAsciiAVX2;
+	case inx::DeepSeek::InstructionSet::SSE42:
+		return SpanAsciiSSE42;
+#endif
+	default:
+		return SpanAsciiScalar;
+	}
+}
+
+static SpanJsonPlainFunction SpanJsonPlainFor(inx::DeepSeek::InstructionSet instruction_set)
+{
+	switch (instruction_set) {
+#ifdef INX_DEEPSEEK_X86
+	case inx::DeepSeek::InstructionSet::AVX2:
+		return SpanJsonPlainAVX2;
+	case inx::DeepSeek::InstructionSet::SSE42:
+		return SpanJsonPlainSSE42;
+#endif
+	default:
+		return SpanJsonPlainScalar;
+	}
+}
+
+static IsValidUtf8Function IsValidUtf8For(inx::DeepSeek::InstructionSet instruction_set)
+{
+	switch (instruction_set) {
+#ifdef INX_DEEPSEEK_X86
+	case inx::DeepSeek::InstructionSet::AVX2:
+		return IsValidUtf8AVX2;
+	case inx::DeepSeek::InstructionSet::SSE42:
+		return IsValidUtf8SSE42;
+#endif
+	default:
+		return IsValidUtf8Scalar;
+	}
+}
+
+static size_t SpanAsciiResolve(const char* data, size_t size, const inx::DeepSeek::AsciiSet& set);
+static size_t SpanJsonPlainResolve(const char* data, size_t size);
+static bool IsValidUtf8Resolve(const char* data, size_t size);
+
+// All start unresolved (constant initialized, so they can be used during static initialization)
+static std::atomic<int> ActiveInstructionSet{ -1 };
+static std::atomic<SpanAsciiFunction> ActiveSpanAscii{ SpanAsciiResolve };
+static std::atomic<SpanJsonPlainFunction> ActiveSpanJsonPlain{ SpanJsonPlainResolve };
+static std::atomic<IsValidUtf8Function> ActiveIsValidUtf8{ IsValidUtf8Resolve };
+
+static size_t SpanAsciiResolve(const char* data, size_t size, const inx::DeepSeek::AsciiSet& set)
+{
+	SpanAsciiFunction function = SpanAsciiFor(inx::DeepSeek::GetInstructionSet());
+	ActiveSpanAscii.store(function, std::memory_order_relaxed);
+	return function(data, size, set);
+}
+
+static size_t SpanJsonPlainResolve(const char* data, size_t size)
+{
+	SpanJsonPlainFunction function = SpanJsonPlainFor(inx::DeepSeek::GetInstructionSet());
+	ActiveSpanJsonPlain.store(function, std::memory_order_relaxed);
+	return function(data, size);
+}
+
+static bool IsValidUtf8Resolve(const char* data, size_t size)
+{
+	IsValidUtf8Function function = IsValidUtf8For(inx::DeepSeek::GetInstructionSet());
+	ActiveIsValidUtf8.store(function, std::memory_order_relaxed);
+	return function(data, size);
+}
+
+inx::DeepSeek::InstructionSet inx::DeepSeek::GetInstructionSet()
+{
+	int active = ActiveInstructionSet.load(std::memory_order_relaxed);
+	return active < 0 ? SupportedInstructionSet() : static_cast<InstructionSet>(active);
+}
+
+void inx::DeepSeek::SetInstructionSet(InstructionSet instruction_set)
+{
+	if (static_cast<int>(instruction_set) > static_cast<int>(SupportedInstructionSet())) {
+		instruction_set = SupportedInstructionSet();
+	}
+	ActiveInstructionSet.store(static_cast<int>(instruction_set), std::memory_order_relaxed);
+	ActiveSpanAscii.store(SpanAsciiFor(instruction_set), std::memory_order_relaxed);
+	ActiveSpanJsonPlain.store(SpanJsonPlainFor(instruction_set), std::memory_order_relaxed);
+	ActiveIsValidUtf8.store(IsValidUtf8For(instruction_set), std::memory_order_relaxed);
+}
+
+size_t inx::DeepSeek::SpanAsciiBlocks(const char* data, size_t size, const AsciiSet& set)
+{
+	return ActiveSpanAscii.load(std::memory_order_relaxed)(data, size, set);
+}
+
+size_t inx::DeepSeek::SpanJsonPlain(const char* data, size_t size)
+{
+	return ActiveSpanJsonPlain.load(std::memory_order_relaxed)(data, size);
+}
+
+bool inx::DeepSeek::IsValidUtf8(const char* data, size_t size)
+{
+	return ActiveIsValidUtf8.load(std::memory_order_relaxed)(data, size);
+}
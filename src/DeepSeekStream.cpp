@@ -0,0 +1,141 @@
+#include "DeepSeekStream.h"
+#include "DeepSeekSimd.h"
+#include <algorithm>
+#include <stdexcept>
+
+// Returns the length of the sequence a lead byte starts, 0 for ASCII, continuation and invalid bytes
+static size_t ExpectedSequenceLength(unsigned char lead)
+{
+	if (lead >= 0xC0 && lead <= 0xDF) {
+		return 2;
+	}
+	if (lead >= 0xE0 && lead <= 0xEF) {
+		return 3;
+	}
+	if (lead >= 0xF0 && lead <= 0xF7) {
+		return 4;
+	}
+	return 0;
+}
+
+// Returns the number of bytes at the end of the data that start a sequence without finishing it
+static size_t IncompleteTail(const char* data, size_t size)
+{
+	for (size_t count = 1; count <= 3 && count <= size; count++) {
+		unsigned char c = static_cast<unsigned char>(data[size - count]);
+		if ((c & 0xC0) == 0x80) {
+			continue;
+		}
+		return ExpectedSequenceLength(c) > count ? count : 0;
+	}
+	return 0;
+}
+
+static std::runtime_error InvalidUtf8()
+{
+	return std::runtime_error("The completion stream isn't valid UTF-8");
+}
+
+void inx::DeepSeek::StreamDecoder::Feed(std::string_view chunk)
+{
+	size_t start = 0;
+	if (CarrySize > 0) {
+		// Completes the sequence split by the previous chunk
+		size_t expected = ExpectedSequenceLength(static_cast<unsigned char>(Carry[0]));
+		size_t taken = std::min(expected - CarrySize, chunk.size());
+		std::copy_n(chunk.data(), taken, Carry + CarrySize);
+		CarrySize += taken;
+		start = taken;
+		if (CarrySize == expected) {
+			if (Utf8SequenceLength(Carry, CarrySize) != CarrySize) {
+				throw InvalidUtf8();
+			}
+			CarrySize = 0;
+		}
+	}
+	if (CarrySize == 0) {
+		size_t tail = IncompleteTail(chunk.data() + start, chunk.size() - start);
+		if (!IsValidUtf8(chunk.data() + start, chunk.size() - start - tail)) {
+			throw InvalidUtf8();
+		}
+		std::copy_n(chunk.data() + chunk.size() - tail, tail, Carry);
+		CarrySize = tail;
+	}
+
+	// What's left of the previous chunks has no line break, only the new bytes are searched
+	size_t search = Pending.size();
+	Pending.append(chunk);
+	size_t line_start = 0;
+	size_t line_end;
+	while ((line_end = Pending.find('\n', search)) != std::string::npos) {
+		ProcessLine(std::string_view(Pending).substr(line_start, line_end - line_start));
+		line_start = line_end + 1;
+		search = line_start;
+	}
+	Pending.erase(0, line_start);
+}
+
+void inx::DeepSeek::StreamDecoder::Finish()
+{
+	if (!Pending.empty()) {
+		ProcessLine(Pending);
+		Pending.clear();
+	}
+	if (Done) {
+		return;
+	}
+	if (!Unparsed.empty()) {
+		// Errors are answered with a plain JSON body
+		nlohmann::json response = nlohmann::json::parse(Unparsed, nullptr, false);
+		if (response.is_object() && response.contains("error") && response["error"].is_object()) {
+			throw std::runtime_error("DeepSeek API error: " + response["error"].value("message", std::string("unknown error")));
+		}
+	}
+	throw std::runtime_error("The completion stream ended before it was complete");
+}
+
+void inx::DeepSeek::StreamDecoder::ProcessLine(std::string_view line)
+{
+	if (!line.empty() && line.back() == '\r') {
+		line.remove_suffix(1);
+	}
+	// Blank lines end the events and the lines starting with ':' are comments (keep-alives), the events are single data lines
+	if (line.empty() || line.front() == ':') {
+		return;
+	}
+	if (line.substr(0, 5) != "data:") {
+		Unparsed += line;
+		Unparsed += '\n';
+		return;
+	}
+	std::string_view data = line.substr(5);
+	if (!data.empty() && data.front() == ' ') {
+		data.remove_prefix(1);
+	}
+	if (data == "[DONE]") {
+		Done = true;
+		return;
+	}
+
+	nlohmann::json event = nlohmann::json::parse(data);
+	if (event.contains("error") && event["error"].is_object()) {
+		throw std::runtime_error("DeepSeek API error: " + event["error"].value("message", std::string("unknown error")));
+	}
+	if (event.contains("usage") && event["usage"].is_object()) {
+		UsageEvent = event;
+	}
+	if (!event.contains("choices") || !event["choices"].is_array() || event["choices"].empty()) {
+		return;
+	}
+	const nlohmann::json& delta = event["choices"][0]["delta"];
+	if (!delta.is_object() || !delta.contains("content") || !delta["content"].is_string()) {
+		return;
+	}
+	const std::string& content = delta["content"].get_ref<const std::string&>();
+	if (!content.empty()) {
+		Content += content;
+		if (OnDelta) {
+			OnDelta(content);
+		}
+	}
+}
@@ -0,0 +1,86 @@
+#include "DeepSeekSubmissionQueue.h"
+#include <bit>
+#include <algorithm>
+
+inx::DeepSeek::SubmissionQueue::SubmissionQueue(size_t capacity)
+{
+	size_t cells = std::bit_ceil(std::max<size_t>(capacity, 2));
+	Cells = std::make_unique<Cell[]>(cells);
+	Mask = cells - 1;
+	for (size_t i = 0; i < cells; i++) {
+		Cells[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+inx::DeepSeek::SubmissionQueue::PushResult inx::DeepSeek::SubmissionQueue::TryPush(std::shared_ptr<Transfer>& transfer)
+{
+	size_t position = Tail.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true) {
+		if (position & ClosedBit) {
+			return PushResult::Closed;
+		}
+		cell = &Cells[position & Mask];
+		size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - position);
+		if (difference == 0) {
+			// The cell is free for this lap, claim it
+			if (Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (difference < 0) {
+			// The cell still holds the item of the previous lap
+			return PushResult::Full;
+		}
+		else {
+			position = Tail.load(std::memory_order_relaxed);
+		}
+	}
+	cell->Item = std::move(transfer);
+	cell->Sequence.store(position + 1, std::memory_order_release);
+	return PushResult::Pushed;
+}
+
+bool inx::DeepSeek::SubmissionQueue::TryPop(std::shared_ptr<Transfer>& transfer)
+{
+	size_t position = Head.load(std::memory_order_relaxed);
+	Cell* cell;
+	while (true) {
+		cell = &Cells[position & Mask];
+		size_t sequence = cell->Sequence.load(std::memory_order_acquire);
+		std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+		if (difference == 0) {
+			if (Head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				break;
+			}
+		}
+		else if (difference < 0) {
+			return false;
+		}
+		else {
+			position = Head.load(std::memory_order_relaxed);
+		}
+	}
+	transfer = std::move(cell->Item);
+	// Free for the next lap
+	cell->Sequence.store(position + Mask + 1, std::memory_order_release);
+	return true;
+}
+
+void inx::DeepSeek::SubmissionQueue::Close()
+{
+	Tail.fetch_or(ClosedBit, std::memory_order_acq_rel);
+}
+
+bool inx::DeepSeek::SubmissionQueue::IsDrained() const
+{
+	return Head.load(std::memory_order_acquire) == (Tail.load(std::memory_order_acquire) & ~ClosedBit);
+}
+
+size_t inx::DeepSeek::SubmissionQueue::size() const
+{
+	size_t head = Head.load(std::memory_order_relaxed);
+	size_t tail = Tail.load(std::memory_order_relaxed) & ~ClosedBit;
+	return tail > head ? tail - head : 0;
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "DeepSeekTimerWheel.h"
+#include <bit>
+#include <algorithm>
+
+inx::DeepSeek::TimerWheel::TimerWheel(Clock::time_point start)
+	: Start(start)
+{
+	for (size_t level = 0; level < Levels; level++) {
+		for (size_t slot = 0; slot < Slots; slot++) {
+			Link* head = Head(level, slot);
+			head->Previous = head;
+			head->Next = head;
+		}
+	}
+}
+
+std::uint64_t inx::DeepSeek::TimerWheel::ToTick(Clock::time_point time) const
+{
+	if (time <= Start) {
+		return 0;
+	}
+	return static_cast<std::uint64_t>((time - Start) / Tick);
+}
+
+void inx::DeepSeek::TimerWheel::Schedule(Timer& timer, Clock::time_point due, std::function<void()> on_fired)
+{
+	if (timer.IsScheduled()) {
+		Unlink(timer);
+		Count--;
+		CancelledCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	// Rounded up, so a timer never fires before its due time
+	std::uint64_t tick = ToTick(due);
+	if (Start + tick * Tick < due) {
+		tick++;
+	}
+	timer.DueTick = tick;
+	timer.Due = due;
+	timer.OnFired = std::move(on_fired);
+	// The timers already due fire on the next tick
+	Insert(timer, Current + 1);
+	Count++;
+	ScheduledCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void inx::DeepSeek::TimerWheel::Cancel(Timer& timer)
+{
+	if (!timer.IsScheduled()) {
+		return;
+	}
+	Unlink(timer);
+	Count--;
+	timer.OnFired = nullptr;
+	CancelledCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void inx::DeepSeek::TimerWheel::Insert(Timer& timer, std::uint64_t earliest)
+{
+	std::uint64_t due = std::max(timer.DueTick, earliest);
+	std::uint64_t delta = due - Current;
+	size_t level = 0;
+	while (level + 1 < Levels && delta >> (SlotBits * (level + 1)) != 0) {
+		level++;
+	}
+	std::uint64_t span = std::uint64_t(1) << (SlotBits * Levels);
+	if (delta >= span) {
+		// Beyond the last level: waits in its furthest slot, and is placed again from there
+		due = Current + span - 1;
+	}
+	size_t slot = static_cast<size_t>(due >> (SlotBits * level)) & (Slots - 1);
+
+	Link* head = Head(level, slot);
+	timer.Next = head;
+	timer.Previous = head->Previous;
+	head->Previous->Next = &timer;
+	head->Previous = &timer;
+	timer.Level = static_cast<std::uint8_t>(level);
+	timer.SlotIndex = static_cast<std::uint8_t>(slot);
+	Occupied[level] |= std::uint64_t(1) << slot;
+}
+
+void inx::DeepSeek::TimerWheel::Unlink(Timer& timer)
+{
+	timer.Previous->Next = timer.Next;
+	timer.Next->Previous = timer.Previous;
+	if (timer.Previous == timer.Next) {
+		// Only the head is left
+		Occupied[timer.Level] &= ~(std::uint64_t(1) << timer.SlotIndex);
+	}
+	timer.Previous = nullptr;
+	timer.Next = nullptr;
+}
+
+void inx::DeepSeek::TimerWheel::Cascade(size_t level, size_t slot)
+{
+	Link* head = Head(level, slot);
+	if (head->Next == head) {
+		return;
+	}
+	// Detached first, as a timer still out of range goes back to the same slot
+	Link* first = head->Next;
+	Link* last = head->Previous;
+	head->Next = head;
+	head->Previous = head;
+	Occupied[level] &= ~(std::uint64_t(1) << slot);
+	last->Next = nullptr;
+	for (Link* link = first; link;) {
+		Link* next = link->Next;
+		// One due on the current tick goes to its slot of the first level, which Advance fires right after
+		Insert(ToTimer(link), Current);
+		CascadeCount.fetch_add(1, std::memory_order_relaxed);
+		link = next;
+	}
+}
+
+size_t inx::DeepSeek::TimerWheel::Advance(Clock::time_point now)
+{
+	std::uint64_t target = ToTick(now);
+	size_t fired = 0;
+	while (Current < target) {
+		if (Count == 0) {
+			Current = target;
+			break;
+		}
+		Current++;
+		std::uint64_t tick = Current;
+		for (size_t level = 1; level < Levels && (tick & (Slots - 1)) == 0; level++) {
+			tick >>= SlotBits;
+			Cascade(level, static_cast<size_t>(tick) & (Slots - 1));
+		}
+
+		Link* head = Head(0, static_cast<size_t>(Current) & (Slots - 1));
+		while (head->Next != head) {
+			Timer& timer = ToTimer(head->Next);
+			Unlink(timer);
+			Count--;
+			long long lag = std::chrono::duration_cast<std::chrono::microseconds>(now - timer.Due).count();
+			TotalLagMicroseconds.fetch_add(lag, std::memory_order_relaxed);
+			if (lag > MaxLagMicroseconds.load(std::memory_order_relaxed)) {
+				MaxLagMicroseconds.store(lag, std::memory_order_relaxed);
+			}
+			FiredCount.fetch_add(1, std::memory_order_relaxed);
+			fired++;
+			// The callback may destroy or schedule the timer again
+			std::function<void()> on_fired = std::move(timer.OnFired);
+			timer.OnFired = nullptr;
+			on_fired();
+		}
+	}
+	return fired;
+}
+
+std::optional<inx::DeepSeek::TimerWheel::Clock::time_point> inx::DeepSeek::TimerWheel::GetNextDue() const
+{
+	if (Count == 0) {
+		return std::nullopt;
+	}
+	std::optional<std::uint64_t> next;
+	for (size_t level = 0; level < Levels; level++) {
+		if (Occupied[level] == 0) {
+			continue;
+		}
+		// The slots after the current one, in the order the wheel turns to them
+		std::uint64_t block = Current >> (SlotBits * level);
+		int after = static_cast<int>((block + 1) & (Slots - 1));
+		std::uint64_t distance = static_cast<std::uint64_t>(std::countr_zero(std::rotr(Occupied[level], after))) + 1;
+		std::uint64_t tick = (block + distance) << (SlotBits * level);
+		if (!next || tick < *next) {
+			next = tick;
+		}
+	}
+	return Start + *next * Tick;
+}
+
+inx::DeepSeek::TimerStats inx::DeepSeek::TimerWheel::GetStats() const
+{
+	TimerStats stats;
+	stats.Scheduled = ScheduledCount.load(std::memory_order_relaxed);
+	stats.Cancelled = CancelledCount.load(std::memory_order_relaxed);
+	stats.Fired = FiredCount.load(std::memory_order_relaxed);
+	stats.Pending = stats.Scheduled - std::min(stats.Scheduled, stats.Cancelled + stats.Fired);
+	stats.Cascades = CascadeCount.load(std::memory_order_relaxed);
+	if (stats.Fired != 0) {
+		stats.MeanLagMs = TotalLagMicroseconds.load(std::memory_order_relaxed) / 1000.0 / static_cast<double>(stats.Fired);
+	}
+	stats.MaxLagMs = MaxLagMicroseconds.load(std::memory_order_relaxed) / 1000.0;
+	return stats;
+}
\ No newline at end of file
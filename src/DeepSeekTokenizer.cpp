@@ -0,0 +1,770 @@
+#include "DeepSeekTokenizer.h"
+#include "DeepSeekSimd.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+
+enum class CharClass : unsigned char {
+	Letter,
+	Mark,
+	Number,
+	Punctuation, // \p{P} and \p{S}, the split rules never tell them apart
+	Whitespace,
+	Other
+};
+
+struct CodePointRange {
+	char32_t First, Last;
+};
+
+// Compact versions of the Unicode property tables, covering the scripts that show up in practice.
+// Anything non-ASCII that isn't listed here (or a surrogate or private use) is treated as a letter.
+static const CodePointRange WhitespaceRanges[] = {
+	{ 0x0085, 0x0085 }, { 0x00A0, 0x00A0 }, { 0x1680, 0x1680 }, { 0x2000, 0x200A },
+	{ 0x2028, 0x2029 }, { 0x202F, 0x202F }, { 0x205F, 0x205F }, { 0x3000, 0x3000 }
+};
+
+static const CodePointRange NumberRanges[] = {
+	{ 0x00B2, 0x00B3 }, { 0x00B9, 0x00B9 }, { 0x00BC, 0x00BE }, { 0x0660, 0x0669 },
+	{ 0x06F0, 0x06F9 }, { 0x07C0, 0x07C9 }, { 0x0966, 0x096F }, { 0x09E6, 0x09EF },
+	{ 0x0A66, 0x0A6F }, { 0x0AE6, 0x0AEF }, { 0x0B66, 0x0B6F }, { 0x0BE6, 0x0BF2 },
+	{ 0x0C66, 0x0C6F }, { 0x0CE6, 0x0CEF }, { 0x0D66, 0x0D78 }, { 0x0E50, 0x0E59 },
+	{ 0x0ED0, 0x0ED9 }, { 0x0F20, 0x0F33 }, { 0x1040, 0x1049 }, { 0x17E0, 0x17E9 },
+	{ 0x1810, 0x1819 }, { 0x2070, 0x2070 }, { 0x2074, 0x2079 }, { 0x2080, 0x2089 },
+	{ 0x2150, 0x2182 }, { 0x2185, 0x2189 }, { 0x2460, 0x249B }, { 0x24EA, 0x24FF },
+	{ 0x2776, 0x2793 }, { 0x3007, 0x3007 }, { 0x3021, 0x3029 }, { 0x3038, 0x303A },
+	{ 0x3192, 0x3195 }, { 0x3220, 0x3229 }, { 0x3248, 0x324F }, { 0x3251, 0x325F },
+	{ 0x3280, 0x3289 }, { 0x32B1, 0x32BF }, { 0xFF10, 0xFF19 }, { 0x1D7CE, 0x1D7FF },
+	{ 0x1F100, 0x1F10C }
+};
+
+static const CodePointRange PunctuationRanges[] = {
+	{ 0x00A1, 0x00A9 }, { 0x00AB, 0x00AC }, { 0x00AE, 0x00B1 }, { 0x00B4, 0x00B4 },
+	{ 0x00B6, 0x00B8 }, { 0x00BB, 0x00BB }, { 0x00BF, 0x00BF }, { 0x00D7, 0x00D7 },
+	{ 0x00F7, 0x00F7 }, { 0x02C2, 0x02C5 }, { 0x02D2, 0x02DF }, { 0x02E5, 0x02EB },
+	{ 0x02ED, 0x02ED }, { 0x02EF, 0x02FF }, { 0x037E, 0x037E }, { 0x0384, 0x0385 },
+	{ 0x0387, 0x0387 }, { 0x03F6, 0x03F6 }, { 0x055A, 0x055F }, { 0x0589, 0x058A },
+	{ 0x05BE, 0x05BE }, { 0x05C0, 0x05C0 }, { 0x05C3, 0x05C3 }, { 0x05C6, 0x05C6 },
+	{ 0x05F3, 0x05F4 }, { 0x0606, 0x060F }, { 0x061B, 0x061B }, { 0x061D, 0x061F },
+	{ 0x066A, 0x066D }, { 0x06D4, 0x06D4 }, { 0x0964, 0x0965 }, { 0x0970, 0x0970 },
+	{ 0x0E3F, 0x0E3F }, { 0x0E4F, 0x0E4F }, { 0x0E5A, 0x0E5B }, { 0x2010, 0x2027 },
+	{ 0x2030, 0x205E }, { 0x207A, 0x207E }, { 0x208A, 0x208E }, { 0x20A0, 0x20C0 },
+	{ 0x2100, 0x2101 }, { 0x2103, 0x2106 }, { 0x2108, 0x2109 }, { 0x2114, 0x2114 },
+	{ 0x2116, 0x2118 }, { 0x211E, 0x2123 }, { 0x2125, 0x2125 }, { 0x2127, 0x2127 },
+	{ 0x2129, 0x2129 }, { 0x212E, 0x212E }, { 0x213A, 0x213B }, { 0x2140, 0x2144 },
+	{ 0x214A, 0x214D }, { 0x214F, 0x214F }, { 0x218A, 0x218B }, { 0x2190, 0x245F },
+	{ 0x249C, 0x24E9 }, { 0x2500, 0x2775 }, { 0x2794, 0x2BFF }, { 0x2CF9, 0x2CFC },
+	{ 0x2CFE, 0x2CFF }, { 0x2E00, 0x2E5D }, { 0x2E80, 0x2FFB }, { 0x3001, 0x3004 },
+	{ 0x3008, 0x3020 }, { 0x3030, 0x3030 }, { 0x3036, 0x3037 }, { 0x303D, 0x303F },
+	{ 0x309B, 0x309C }, { 0x30A0, 0x30A0 }, { 0x30FB, 0x30FB }, { 0x3190, 0x3191 },
+	{ 0x3196, 0x319F }, { 0x31C0, 0x31E3 }, { 0x3200, 0x321E }, { 0x322A, 0x3247 },
+	{ 0x3250, 0x3250 }, { 0x3260, 0x327F }, { 0x328A, 0x32B0 }, { 0x32C0, 0x33FF },
+	{ 0x4DC0, 0x4DFF }, { 0xA490, 0xA4C6 }, { 0xFD3E, 0xFD3F }, { 0xFE10, 0xFE19 },
+	{ 0xFE30, 0xFE52 }, { 0xFE54, 0xFE66 }, { 0xFE68, 0xFE6B }, { 0xFF01, 0xFF0F },
+	{ 0xFF1A, 0xFF20 }, { 0xFF3B, 0xFF40 }, { 0xFF5B, 0xFF65 }, { 0xFFE0, 0xFFEE },
+	{ 0xFFFC, 0xFFFD }, { 0x1D000, 0x1D24F }, { 0x1F000, 0x1F0FF }, { 0x1F10D, 0x1FBFF }
+};
+
+// Format characters (\p{Cf}) like the zero-width space and joiner or the byte order mark are in none of the classes of the split rules
+static const CodePointRange FormatRanges[] = {
+	{ 0x00AD, 0x00AD }, { 0x0600, 0x0605 }, { 0x061C, 0x061C }, { 0x06DD, 0x06DD },
+	{ 0x070F, 0x070F }, { 0x0890, 0x0891 }, { 0x08E2, 0x08E2 }, { 0x180E, 0x180E },
+	{ 0x200B, 0x200F }, { 0x202A, 0x202E }, { 0x2060, 0x2064 }, { 0x2066, 0x206F },
+	{ 0xFEFF, 0xFEFF }, { 0xFFF9, 0xFFFB }, { 0x110BD, 0x110BD }, { 0x110CD, 0x110CD },
+	{ 0x13430, 0x1343F }, { 0x1BCA0, 0x1BCA3 }, { 0x1D173, 0x1D17A }, { 0xE0001, 0xE0001 },
+	{ 0xE0020, 0xE007F }
+};
+
+static const CodePointRange MarkRanges[] = {
+	{ 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x05BF, 0x05BF },
+	{ 0x05C1, 0x05C2 }, { 0x05C4, 0x05C5 }, { 0x05C7, 0x05C7 }, { 0x0610, 0x061A },
+	{ 0x064B, 0x065F }, { 0x0670, 0x0670 }, { 0x06D6, 0x06DC }, { 0x06DF, 0x06E4 },
+	{ 0x06E7, 0x06E8 }, { 0x06EA, 0x06ED }, { 0x0900, 0x0903 }, { 0x093A, 0x093C },
+	{ 0x093E, 0x094F }, { 0x0951, 0x0957 }, { 0x0962, 0x0963 }, { 0x0981, 0x0983 },
+	{ 0x09BC, 0x09BC }, { 0x09BE, 0x09CD }, { 0x0A01, 0x0A03 }, { 0x0A3C, 0x0A51 },
+	{ 0x0B01, 0x0B03 }, { 0x0B3C, 0x0B57 }, { 0x0BBE, 0x0BCD }, { 0x0C00, 0x0C04 },
+	{ 0x0C3E, 0x0C56 }, { 0x0CBC, 0x0CD6 }, { 0x0D00, 0x0D03 }, { 0x0D3E, 0x0D4D },
+	{ 0x0E31, 0x0E31 }, { 0x0E34, 0x0E3A }, { 0x0E47, 0x0E4E }, { 0x0EB1, 0x0EB1 },
+	{ 0x0EB4, 0x0EBC }, { 0x0EC8, 0x0ECE }, { 0x0F71, 0x0F84 }, { 0x102B, 0x103E },
+	{ 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x20D0, 0x20F0 }, { 0x302A, 0x302F },
+	{ 0x3099, 0x309A }, { 0xFE00, 0xFE0F }, { 0xFE20, 0xFE2F }, { 0xE0100, 0xE01EF }
+};
+
+template<size_t Count>
+static bool InRanges(char32_t code_point, const CodePointRange (&ranges)[Count])
+{
+	auto it = std::upper_bound(ranges, ranges + Count, code_point, [](char32_t value, const CodePointRange& range) {
+		return value < range.First;
+	});
+	return it != ranges && code_point <= (it - 1)->Last;
+}
+
+static constexpr auto AsciiClasses = []() {
+	std::array<CharClass, 128> classes{};
+	for (int c = 0; c < 128; c++) {
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+			classes[c] = CharClass::Letter;
+		}
+		else if (c >= '0' && c <= '9') {
+			classes[c] = CharClass::Number;
+		}
+		else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+			classes[c] = CharClass::Whitespace;
+		}
+		else if (c > ' ' && c < 0x7F) {
+			classes[c] = CharClass::Punctuation;
+		}
+		else {
+			classes[c] = CharClass::Other;
+		}
+	}
+	return classes;
+}();
+
+static CharClass ClassifyCodePoint(char32_t code_point)
+{
+	if (code_point < 0x80) {
+		return AsciiClasses[code_point];
+	}
+	if (code_point < 0xA0) {
+		return code_point == 0x85 ? CharClass::Whitespace : CharClass::Other;
+	}
+	// Fast paths for the large letter blocks (Latin-1, CJK ideographs, Hangul)
+	if ((code_point >= 0xC0 && code_point <= 0x24F && code_point != 0xD7 && code_point != 0xF7)
+		|| (code_point >= 0x4E00 && code_point <= 0x9FFF) || (code_point >= 0xAC00 && code_point <= 0xD7A3)) {
+		return CharClass::Letter;
+	}
+	if (InRanges(code_point, WhitespaceRanges)) {
+		return CharClass::Whitespace;
+	}
+	if (InRanges(code_point, FormatRanges)) {
+		return CharClass::Other;
+	}
+	if (InRanges(code_point, NumberRanges)) {
+		return CharClass::Number;
+	}
+	if (InRanges(code_point, PunctuationRanges)) {
+		return CharClass::Punctuation;
+	}
+	if (InRanges(code_point, MarkRanges)) {
+		return CharClass::Mark;
+	}
+	if ((code_point >= 0xD800 && code_point <= 0xF8FF) || (code_point >= 0xF0000)) {
+		return CharClass::Other; // surrogates and private use
+	}
+	return CharClass::Letter;
+}
+
+// The ASCII side of the classes, scanned with vector instructions when the CPU supports them
+static constexpr inx::DeepSeek::AsciiSet AsciiBytes{ { 0x00, 0x7F } };
+static constexpr inx::DeepSeek::AsciiSet AsciiNonDigits{ { 0x00, 0x2F }, { 0x3A, 0x7F } };
+static constexpr inx::DeepSeek::AsciiSet AsciiLetters{ { 'A', 'Z' }, { 'a', 'z' } };
+static constexpr inx::DeepSeek::AsciiSet AsciiPunctuation{ { 0x21, 0x2F }, { 0x3A, 0x40 }, { 0x5B, 0x60 }, { 0x7B, 0x7E } };
+
+struct DecodedChar {
+	char32_t CodePoint;
+	size_t Length;
+	CharClass Class;
+};
+
+static DecodedChar DecodeAt(std::string_view text, size_t position)
+{
+	unsigned char lead = static_cast<unsigned char>(text[position]);
+	if (lead < 0x80) {
+		return { lead, 1, AsciiClasses[lead] };
+	}
+	size_t length;
+	char32_t code_point;
+	if ((lead & 0xE0) == 0xC0) {
+		length = 2;
+		code_point = lead & 0x1F;
+	}
+	else if ((lead & 0xF0) == 0xE0) {
+		length = 3;
+		code_point = lead & 0x0F;
+	}
+	else if ((lead & 0xF8) == 0xF0) {
+		length = 4;
+		code_point = lead & 0x07;
+	}
+	else {
+		return { lead, 1, CharClass::Other };
+	}
+	if (position + length > text.size()) {
+		return { lead, 1, CharClass::Other };
+	}
+	for (size_t i = 1; i < length; i++) {
+		unsigned char continuation = static_cast<unsigned char>(text[position + i]);
+		if ((continuation & 0xC0) != 0x80) {
+			return { lead, 1, CharClass::Other };
+		}
+		code_point = (code_point << 6) | (continuation & 0x3F);
+	}
+	return { code_point, length, ClassifyCodePoint(code_point) };
+}
+
+static bool IsLetterOrMark(CharClass char_class)
+{
+	return char_class == CharClass::Letter || char_class == CharClass::Mark;
+}
+
+static bool IsAsciiLetter(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool IsCjk(char32_t code_point)
+{
+	return (code_point >= 0x4E00 && code_point <= 0x9FA5) || (code_point >= 0x3040 && code_point <= 0x30FF);
+}
+
+// Skips the CJK letters, they are all 3 bytes long so this doesn't need the generic decoder.
+// The two punctuation characters of the CJK ranges (U+30A0 and U+30FB) stop the run.
+static size_t SpanCjkLetters(std::string_view text, size_t position)
+{
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+	while (position + 3 <= text.size()) {
+		unsigned char lead = data[position];
+		unsigned char second = data[position + 1];
+		unsigned char third = data[position + 2];
+		if ((lead & 0xF0) != 0xE0 || (second & 0xC0) != 0x80 || (third & 0xC0) != 0x80) {
+			break;
+		}
+		char32_t code_point = (static_cast<char32_t>(lead & 0x0F) << 12) | (static_cast<char32_t>(second & 0x3F) << 6) | (third & 0x3F);
+		if (!IsCjk(code_point) || code_point == 0x30A0 || code_point == 0x30FB) {
+			break;
+		}
+		position += 3;
+	}
+	return position;
+}
+
+template<typename Predicate>
+static size_t SkipClass(std::string_view text, size_t position, Predicate predicate, const inx::DeepSeek::AsciiSet& ascii)
+{
+	while (position < text.size()) {
+		position += inx::DeepSeek::SpanAscii(text.data() + position, text.size() - position, ascii);
+		if (position >= text.size() || static_cast<unsigned char>(text[position]) < 0x80) {
+			break;
+		}
+		DecodedChar c = DecodeAt(text, position);
+		if (!predicate(c.Class)) {
+			break;
+		}
+		position += c.Length;
+	}
+	return position;
+}
+
+static size_t SkipNewlines(std::string_view text, size_t position)
+{
+	while (position < text.size() && (text[position] == '\r' || text[position] == '\n')) {
+		position++;
+	}
+	return position;
+}
+
+// Returns the end of the word matched at the position, or the position itself if nothing matches.
+// The alternatives are tried in order, like the DeepSeek-V3 split regex:
+//   [ASCII punctuation][A-Za-z]+
+//   [^\r\n\p{L}\p{P}\p{S}]?[\p{L}\p{M}]+
+//    ?[\p{P}\p{S}]+[\r\n]*
+//   \s*[\r\n]+
+//   \s+(?!\S)
+//   \s+
+static size_t MatchWord(std::string_view text, size_t position, const DecodedChar& c)
+{
+	const size_t size = text.size();
+	const size_t next = position + c.Length;
+	bool is_newline = c.CodePoint == '\r' || c.CodePoint == '\n';
+
+	if (c.CodePoint < 0x80 && c.Class == CharClass::Punctuation && next < size && IsAsciiLetter(text[next])) {
+		return next + inx::DeepSeek::SpanAscii(text.data() + next, size - next, AsciiLetters);
+	}
+
+	if (!is_newline && c.Class != CharClass::Letter && c.Class != CharClass::Punctuation && next < size
+		&& IsLetterOrMark(DecodeAt(text, next).Class)) {
+		return SkipClass(text, next, IsLetterOrMark, AsciiLetters);
+	}
+	if (IsLetterOrMark(c.Class)) {
+		return SkipClass(text, next, IsLetterOrMark, AsciiLetters);
+	}
+
+	auto is_punctuation = [](CharClass char_class) { return char_class == CharClass::Punctuation; };
+	if (c.CodePoint == ' ' && next < size && DecodeAt(text, next).Class == CharClass::Punctuation) {
+		return SkipNewlines(text, SkipClass(text, next, is_punctuation, AsciiPunctuation));
+	}
+	if (c.Class == CharClass::Punctuation) {
+		return SkipNewlines(text, SkipClass(text, next, is_punctuation, AsciiPunctuation));
+	}
+
+	if (c.Class == CharClass::Whitespace) {
+		size_t end = position;
+		size_t last_start = position;
+		size_t after_newline = 0;
+		while (end < size) {
+			DecodedChar space = DecodeAt(text, end);
+			if (space.Class != CharClass::Whitespace) {
+				break;
+			}
+			last_start = end;
+			end += space.Length;
+			if (space.CodePoint == '\r' || space.CodePoint == '\n') {
+				after_newline = end;
+			}
+		}
+		if (after_newline != 0) {
+			return after_newline;
+		}
+		if (end < size && last_start > position) {
+			return last_start; // leave the last space to the following word
+		}
+		return end;
+	}
+
+	return position;
+}
+
+// Applies the word split, the characters no alternative matches are grouped in their own pieces.
+template<typename Callback>
+static void SplitWords(std::string_view text, Callback& emit)
+{
+	size_t position = 0;
+	size_t unmatched = std::string_view::npos;
+	while (position < text.size()) {
+		DecodedChar c = DecodeAt(text, position);
+		size_t end = MatchWord(text, position, c);
+		if (end == position) {
+			if (unmatched == std::string_view::npos) {
+				unmatched = position;
+			}
+			position += c.Length;
+			continue;
+		}
+		if (unmatched != std::string_view::npos) {
+			emit(text.substr(unmatched, position - unmatched));
+			unmatched = std::string_view::npos;
+		}
+		emit(text.substr(position, end - position));
+		position = end;
+	}
+	if (unmatched != std::string_view::npos) {
+		emit(text.substr(unmatched));
+	}
+}
+
+// Isolates the CJK runs, then applies the word split on every part.
+template<typename Callback>
+static void SplitCjk(std::string_view text, Callback& emit)
+{
+	size_t position = 0;
+	size_t segment = 0;
+	while (position < text.size()) {
+		position += inx::DeepSeek::SpanAscii(text.data() + position, text.size() - position, AsciiBytes);
+		if (position >= text.size()) {
+			break;
+		}
+		DecodedChar c = DecodeAt(text, position);
+		if (!IsCjk(c.CodePoint)) {
+			position += c.Length;
+			continue;
+		}
+		if (position > segment) {
+			SplitWords(text.substr(segment, position - segment), emit);
+		}
+		size_t end = SpanCjkLetters(text, position);
+		bool letters_only = true;
+		while (end < text.size()) {
+			DecodedChar next = DecodeAt(text, end);
+			if (!IsCjk(next.CodePoint)) {
+				break;
+			}
+			letters_only = false;
+			end = SpanCjkLetters(text, end + next.Length);
+		}
+		// A run of letters is a single word, only the runs with CJK punctuation need the word split
+		if (letters_only) {
+			emit(text.substr(position, end - position));
+		}
+		else {
+			SplitWords(text.substr(position, end - position), emit);
+		}
+		position = segment = end;
+	}
+	if (segment < text.size()) {
+		SplitWords(text.substr(segment), emit);
+	}
+}
+
+// Isolates the groups of up to 3 digits, then splits the rest.
+template<typename Callback>
+static void PreTokenize(std::string_view text, Callback&& emit)
+{
+	size_t position = 0;
+	size_t segment = 0;
+	while (position < text.size()) {
+		position += inx::DeepSeek::SpanAscii(text.data() + position, text.size() - position, AsciiNonDigits);
+		if (position >= text.size()) {
+			break;
+		}
+		DecodedChar c = DecodeAt(text, position);
+		if (c.Class != CharClass::Number) {
+			position += c.Length;
+			continue;
+		}
+		if (position > segment) {
+			SplitCjk(text.substr(segment, position - segment), emit);
+		}
+		size_t end = position + c.Length;
+		for (int digits = 1; digits < 3 && end < text.size(); digits++) {
+			DecodedChar next = DecodeAt(text, end);
+			if (next.Class != CharClass::Number) {
+				break;
+			}
+			end += next.Length;
+		}
+		emit(text.substr(position, end - position));
+		position = segment = end;
+	}
+	if (segment < text.size()) {
+		SplitCjk(text.substr(segment), emit);
+	}
+}
+
+// Byte-level BPE vocabularies store bytes as printable code points, this maps them back to bytes.
+static std::string DecodeByteLevel(std::string_view token, bool& valid)
+{
+	static const std::vector<int> code_point_to_byte = []() {
+		std::vector<int> table(324, -1);
+		int extra = 0;
+		for (int byte = 0; byte < 256; byte++) {
+			bool printable = (byte >= '!' && byte <= '~') || (byte >= 0xA1 && byte <= 0xAC) || (byte >= 0xAE && byte <= 0xFF);
+			table[printable ? byte : 256 + extra++] = byte;
+		}
+		return table;
+	}();
+
+	std::string bytes;
+	bytes.reserve(token.size());
+	valid = true;
+	size_t position = 0;
+	while (position < token.size()) {
+		DecodedChar c = DecodeAt(token, position);
+		if (c.CodePoint >= code_point_to_byte.size() || code_point_to_byte[c.CodePoint] < 0) {
+			valid = false;
+			return {};
+		}
+		bytes.push_back(static_cast<char>(code_point_to_byte[c.CodePoint]));
+		position += c.Length;
+	}
+	return bytes;
+}
+
+static nlohmann::json ReadJSONFile(const std::string& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open tokenizer file: " + path);
+	}
+	return nlohmann::json::parse(file);
+}
+
+template<typename Map>
+static void LoadVocab(const nlohmann::json& vocab, Map& output)
+{
+	for (const auto& [token, id] : vocab.items()) {
+		bool valid;
+		std::string bytes = DecodeByteLevel(token, valid);
+		if (valid) {
+			output.emplace(std::move(bytes), id.template get<int>());
+		}
+	}
+}
+
+static std::pair<std::string, std::string> SplitMerge(std::string_view merge)
+{
+	size_t space = merge.find(' ');
+	if (space == std::string_view::npos) {
+		throw std::runtime_error("Invalid BPE merge: " + std::string(merge));
+	}
+	return { std::string(merge.substr(0, space)), std::string(merge.substr(space + 1)) };
+}
+
+inx::DeepSeek::Tokenizer::Tokenizer(const std::string& tokenizer_json_path)
+{
+	nlohmann::json tokenizer = ReadJSONFile(tokenizer_json_path);
+	const nlohmann::json& model = tokenizer.at("model");
+
+	LoadVocab(model.at("vocab"), Vocab);
+
+	std::vector<std::pair<std::string, std::string>> merges;
+	for (const auto& merge : model.at("merges")) {
+		if (merge.is_array()) {
+			merges.emplace_back(merge.at(0).get<std::string>(), merge.at(1).get<std::string>());
+		}
+		else {
+			merges.push_back(SplitMerge(merge.get<std::string>()));
+		}
+	}
+	Initialize(merges);
+}
+
+inx::DeepSeek::Tokenizer::Tokenizer(const std::string& vocab_path, const std::string& merges_path)
+{
+	LoadVocab(ReadJSONFile(vocab_path), Vocab);
+
+	std::ifstream file(merges_path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("Failed to open tokenizer file: " + merges_path);
+	}
+	std::vector<std::pair<std::string, std::string>> merges;
+	std::string line;
+	while (std::getline(file, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.empty() || line.starts_with("#version")) {
+			continue;
+		}
+		merges.push_back(SplitMerge(line));
+	}
+	Initialize(merges);
+}
+
+void inx::DeepSeek::Tokenizer::Initialize(const std::vector<std::pair<std::string, std::string>>& merges)
+{
+	for (int byte = 0; byte < 256; byte++) {
+		char c = static_cast<char>(byte);
+		auto it = Vocab.find(std::string_view(&c, 1));
+		if (it == Vocab.end()) {
+			throw std::runtime_error("The tokenizer vocabulary is not byte-level, byte " + std::to_string(byte) + " has no token");
+		}
+		ByteTokens[byte] = it->second;
+	}
+
+	Merges.reserve(merges.size());
+	for (size_t rank = 0; rank < merges.size(); rank++) {
+		const auto& [left, right] = merges[rank];
+		bool left_valid, right_valid;
+		std::string left_bytes = DecodeByteLevel(left, left_valid);
+		std::string right_bytes = DecodeByteLevel(right, right_valid);
+		if (!left_valid || !right_valid) {
+			continue;
+		}
+		auto left_id = Vocab.find(left_bytes);
+		auto right_id = Vocab.find(right_bytes);
+		auto merged_id = Vocab.find(left_bytes + right_bytes);
+		if (left_id == Vocab.end() || right_id == Vocab.end() || merged_id == Vocab.end()) {
+			continue;
+		}
+		unsigned long long key = (static_cast<unsigned long long>(static_cast<unsigned int>(left_id->second)) << 32) | static_cast<unsigned int>(right_id->second);
+		Merges.emplace(key, MergeRule{ static_cast<int>(rank), merged_id->second });
+	}
+
+	Cache = std::make_unique<CacheShard[]>(CacheShards);
+
+	// The ids are never reused, a memo left by a destroyed tokenizer can't be taken for one of a new tokenizer.
+	// They're 32 bits wide, running out would take billions of tokenizers: the new ones would then count without memoizing.
+	static std::atomic<std::uint32_t> last_id{ 0 };
+	std::uint32_t id = last_id.load(std::memory_order_relaxed);
+	while (id != std::numeric_limits<std::uint32_t>::max() && !last_id.compare_exchange_weak(id, id + 1, std::memory_order_relaxed)) {
+	}
+	Id = id != std::numeric_limits<std::uint32_t>::max() ? id + 1 : 0;
+}
+
+void inx::DeepSeek::Tokenizer::EncodePiece(std::string_view piece, std::vector<int>& output) const
+{
+	struct Symbol {
+		int Id;
+		int Previous;
+		int Next;
+	};
+	struct Candidate {
+		int Rank;
+		int Left;
+		int LeftId;
+		int RightId;
+		bool operator>(const Candidate& other) const {
+			return Rank != other.Rank ? Rank > other.Rank : Left > other.Left;
+		}
+	};
+
+	const int count = static_cast<int>(piece.size());
+	std::vector<Symbol> symbols(count);
+	for (int i = 0; i < count; i++) {
+		symbols[i] = { ByteTokens[static_cast<unsigned char>(piece[i])], i - 1, i + 1 < count ? i + 1 : -1 };
+	}
+
+	auto find_rule = [this](int left, int right) -> const MergeRule* {
+		unsigned long long key = (static_cast<unsigned long long>(static_cast<unsigned int>(left)) << 32) | static_cast<unsigned int>(right);
+		auto it = Merges.find(key);
+		return it == Merges.end() ? nullptr : &it->second;
+	};
+
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+	for (int i = 0; i + 1 < count; i++) {
+		if (const MergeRule* rule = find_rule(symbols[i].Id, symbols[i + 1].Id)) {
+			candidates.push({ rule->Rank, i, symbols[i].Id, symbols[i + 1].Id });
+		}
+	}
+
+	while (!candidates.empty()) {
+		Candidate candidate = candidates.top();
+		candidates.pop();
+		Symbol& left = symbols[candidate.Left];
+		// Skip the candidates that were invalidated by an earlier merge
+		if (left.Id != candidate.LeftId || left.Next < 0 || symbols[left.Next].Id != candidate.RightId) {
+			continue;
+		}
+		const MergeRule* rule = find_rule(candidate.LeftId, candidate.RightId);
+		Symbol& right = symbols[left.Next];
+		left.Id = rule->Merged;
+		right.Id = -1;
+		left.Next = right.Next;
+		if (left.Next >= 0) {
+			symbols[left.Next].Previous = candidate.Left;
+		}
+		if (left.Previous >= 0) {
+			if (const MergeRule* previous = find_rule(symbols[left.Previous].Id, left.Id)) {
+				candidates.push({ previous->Rank, left.Previous, symbols[left.Previous].Id, left.Id });
+			}
+		}
+		if (left.Next >= 0) {
+			if (const MergeRule* next = find_rule(left.Id, symbols[left.Next].Id)) {
+				candidates.push({ next->Rank, candidate.Left, left.Id, symbols[left.Next].Id });
+			}
+		}
+	}
+
+	for (int i = 0; i >= 0 && i < count; i = symbols[i].Next) {
+		output.push_back(symbols[i].Id);
+	}
+}
+
+inx::DeepSeek::Tokenizer::CacheShard& inx::DeepSeek::Tokenizer::ShardFor(std::string_view piece) const
+{
+	return Cache[StringHash{}(piece) % CacheShards];
+}
+
+void inx::DeepSeek::Tokenizer::EncodeCached(std::string_view piece, std::vector<int>& output) const
+{
+	auto known = Vocab.find(piece);
+	if (known != Vocab.end()) {
+		output.push_back(known->second);
+		return;
+	}
+
+	CacheShard& shard = ShardFor(piece);
+	{
+		std::lock_guard lock(shard.Mutex);
+		auto it = shard.Tokens.find(piece);
+		if (it != shard.Tokens.end()) {
+			output.insert(output.end(), it->second.begin(), it->second.end());
+			return;
+		}
+	}
+
+	std::vector<int> tokens;
+	EncodePiece(piece, tokens);
+	output.insert(output.end(), tokens.begin(), tokens.end());
+
+	std::lock_guard lock(shard.Mutex);
+	if (shard.Tokens.size() >= MaxCacheEntriesPerShard) {
+		shard.Tokens.clear();
+	}
+	shard.Tokens.emplace(std::string(piece), std::move(tokens));
+}
+
+size_t inx::DeepSeek::Tokenizer::CountPiece(std::string_view piece) const
+{
+	if (piece.size() == 1 || Vocab.find(piece) != Vocab.end()) {
+		return 1;
+	}
+
+	CacheShard& shard = ShardFor(piece);
+	{
+		std::lock_guard lock(shard.Mutex);
+		auto it = shard.Tokens.find(piece);
+		if (it != shard.Tokens.end()) {
+			return it->second.size();
+		}
+	}
+
+	std::vector<int> tokens;
+	EncodeCached(piece, tokens);
+	return tokens.size();
+}
+
+std::vector<int> inx::DeepSeek::Tokenizer::Encode(std::string_view text) const
+{
+	std::vector<int> tokens;
+	tokens.reserve(text.size() / 4);
+	PreTokenize(text, [&](std::string_view piece) {
+		EncodeCached(piece, tokens);
+	});
+	return tokens;
+}
+
+std::vector<std::string_view> inx::DeepSeek::Tokenizer::Split(std::string_view text)
+{
+	std::vector<std::string_view> pieces;
+	PreTokenize(text, [&pieces](std::string_view piece) {
+		pieces.push_back(piece);
+	});
+	return pieces;
+}
+
+size_t inx::DeepSeek::Tokenizer::CountTokens(std::string_view text) const
+{
+	size_t count = 0;
+	PreTokenize(text, [&](std::string_view piece) {
+		count += CountPiece(piece);
+	});
+	return count;
+}
+
+size_t inx::DeepSeek::Tokenizer::MessageOverhead(Message::Role role)
+{
+	// <｜begin▁of▁sentence｜>{system}<｜User｜>{user}<｜Assistant｜>{assistant}<｜end▁of▁sentence｜>
+	switch (role) {
+	case Message::Role::System:
+		return 0;
+	case Message::Role::User:
+		return 1;
+	case Message::Role::Assistant:
+		return 2;
+	default: // only adding this to avoid compiler warnings
+		return 1;
+	}
+}
+
+size_t inx::DeepSeek::Tokenizer::CountTokens(const Message& message) const
+{
+	constexpr std::uint64_t count_mask = (1ull << 32) - 1;
+	// Shared content is counted once for all the messages using it
+	std::atomic<std::uint64_t>& memo_slot = message.SharedContent ? message.SharedContent->TokenMemo : message.TokenMemo;
+
+	std::uint64_t memo = memo_slot.load(std::memory_order_relaxed);
+	if (Id != 0 && (memo >> 32) == Id) {
+		return (memo & count_mask) + MessageOverhead(message.role);
+	}
+
+	size_t count = CountTokens(message.GetContent());
+	if (Id != 0 && count <= count_mask) {
+		memo_slot.store((static_cast<std::uint64_t>(Id) << 32) | count, std::memory_order_relaxed);
+	}
+	return count + MessageOverhead(message.role);
+}
+
+size_t inx::DeepSeek::Tokenizer::CountTokens(const std::vector<Message>& messages) const
+{
+	size_t count = HistoryOverhead;
+	for (const auto& message : messages) {
+		count += CountTokens(message);
+	}
+	return count;
+}
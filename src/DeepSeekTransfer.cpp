@@ -0,0 +1,291 @@
+#include "DeepSeekTransfer.h"
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+
+// The server of the requests, replaced at build time to benchmark against a local one (see bench/mock_server.py)
+#ifndef INX_DEEPSEEK_API_URL
+#define INX_DEEPSEEK_API_URL "https://api.deepseek.com"
+#endif
+
+static inx::DeepSeek::Usage ParseUsage(const nlohmann::json& json_response)
+{
+	inx::DeepSeek::Usage usage;
+	if (!json_response.contains("usage") || !json_response["usage"].is_object()) {
+		return usage;
+	}
+	const nlohmann::json& object = json_response["usage"];
+	usage.PromptTokens = object.value("prompt_tokens", 0);
+	usage.CompletionTokens = object.value("completion_tokens", 0);
+	usage.TotalTokens = object.value("total_tokens", 0);
+	usage.PromptCacheHitTokens = object.value("prompt_cache_hit_tokens", 0);
+	usage.PromptCacheMissTokens = object.value("prompt_cache_miss_tokens", 0);
+	return usage;
+}
+
+// The curl callbacks, the user pointer is the transfer
+struct inx::DeepSeek::TransferCallbacks {
+	// Feeds the request body to curl as it uploads it
+	static size_t Read(char* buffer, size_t size, size_t nitems, void* userp)
+	{
+		Transfer* transfer = static_cast<Transfer*>(userp);
+		if (transfer->Cancelled) {
+			return CURL_READFUNC_ABORT;
+		}
+		try {
+			return transfer->Body->Read(buffer, size * nitems);
+		}
+		catch (...) {
+			transfer->Error = std::current_exception();
+			return CURL_READFUNC_ABORT;
+		}
+	}
+
+	static int Seek(void* userp, curl_off_t offset, int origin)
+	{
+		// Only rewinding is needed (redirects, retries on a reused connection)
+		if (origin != SEEK_SET || offset != 0) {
+			return CURL_SEEKFUNC_CANTSEEK;
+		}
+		static_cast<Transfer*>(userp)->Body->Rewind();
+		return CURL_SEEKFUNC_OK;
+	}
+
+	static size_t Write(char* contents, size_t size, size_t nmemb, void* userp)
+	{
+		Transfer* transfer = static_cast<Transfer*>(userp);
+		if (transfer->Cancelled) {
+			return 0;
+		}
+		size_t received = size * nmemb;
+		if (!transfer->Received && std::string_view(contents, received).find_first_not_of(" \t\r\n") != std::string_view::npos) {
+			// The blank lines sent while the request waits don't count
+			transfer->OnFirstToken();
+		}
+		try {
+			transfer->Borrowed->Receive(contents, received);
+			return received;
+		}
+		catch (...) {
+			// Returning less than received aborts the transfer
+			transfer->Error = std::current_exception();
+			return 0;
+		}
+	}
+
+	// Feeds the response of a streamed request to its decoder as curl receives it
+	static size_t StreamWrite(char* contents, size_t size, size_t nmemb, void* userp)
+	{
+		Transfer* transfer = static_cast<Transfer*>(userp);
+		if (transfer->Cancelled) {
+			return 0;
+		}
+		try {
+			transfer->Decoder->Feed(std::string_view(contents, size * nmemb));
+			if (!transfer->Received && !transfer->Decoder->GetContent().empty()) {
+				transfer->OnFirstToken();
+			}
+			return size * nmemb;
+		}
+		catch (...) {
+			// Returning less than received aborts the transfer
+			transfer->Error = std::current_exception();
+			return 0;
+		}
+	}
+
+	// Called regularly even while nothing is received, so a cancelled transfer stops without waiting for data
+	static int Progress(void* userp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+	{
+		return static_cast<Transfer*>(userp)->Cancelled ? 1 : 0;
+	}
+};
+
+inx::DeepSeek::Transfer::Transfer(std::shared_ptr<ConnectionPool> pool, std::shared_ptr<const RequestHeaders> headers)
+	: Pool(std::move(pool)), Borrowed(Pool->Acquire()), Headers(std::move(headers))
+{
+	CURL* curl = static_cast<CURL*>(GetHandle());
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, TransferCallbacks::Progress);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, this);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+}
+
+inx::DeepSeek::Transfer::~Transfer()
+{
+	if (Scheduler) {
+		Scheduler->Leave(Ticket);
+	}
+}
+
+void inx::DeepSeek::Transfer::PrepareCompletion(RequestBody body, DeltaCallback on_delta)
+{
+	Body.emplace(std::move(body));
+	OnDelta = std::move(on_delta);
+
+	CURL* curl = static_cast<CURL*>(GetHandle());
+	curl_easy_setopt(curl, CURLOPT_URL, INX_DEEPSEEK_API_URL "/chat/completions");
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, static_cast<curl_slist*>(Headers->GetCompletionHeaders()));
+	curl_easy_setopt(curl, CURLOPT_POST, 1L);
+	curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(Body->size()));
+	curl_easy_setopt(curl, CURLOPT_READFUNCTION, TransferCallbacks::Read);
+	curl_easy_setopt(curl, CURLOPT_READDATA, this);
+	curl_easy_setopt(curl, CURLOPT_SEEKFUNCTION, TransferCallbacks::Seek);
+	curl_easy_setopt(curl, CURLOPT_SEEKDATA, this);
+	if (OnDelta) {
+		// The connection buffer holds the incomplete line, to reuse its memory
+		Decoder.emplace(OnDelta, Borrowed->Response);
+		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, TransferCallbacks::StreamWrite);
+	}
+	else {
+		curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, TransferCallbacks::Write);
+	}
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+}
+
+void inx::DeepSeek::Transfer::PrepareBalance()
+{
+	CURL* curl = static_cast<CURL*>(GetHandle());
+	curl_easy_setopt(curl, CURLOPT_URL, INX_DEEPSEEK_API_URL "/user/balance");
+	curl_easy_setopt(curl, CURLOPT_HTTPHEADER, static_cast<curl_slist*>(Headers->GetBalanceHeaders()));
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, TransferCallbacks::Write);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+}
+
+void inx::DeepSeek::Transfer::SetScheduler(std::shared_ptr<RequestScheduler> scheduler, RequestPriority priority, std::string tenant, std::string tag, size_t prompt_tokens)
+{
+	Scheduler = std::move(scheduler);
+	Ticket.Priority = priority;
+	Ticket.Tenant = std::move(tenant);
+	Ticket.Tag = std::move(tag);
+	Ticket.PromptTokens = prompt_tokens;
+}
+
+int inx::DeepSeek::Transfer::Perform()
+{
+	if (Scheduler) {
+		// Given back by the destructor, once the response is decoded
+		Scheduler->Acquire(Ticket);
+	}
+	return curl_easy_perform(static_cast<CURL*>(GetHandle()));
+}
+
+void inx::DeepSeek::Transfer::CheckResult(int result) const
+{
+	if (Error) {
+		std::rethrow_exception(Error);
+	}
+	if (Cancelled) {
+		throw std::runtime_error("The request was cancelled");
+	}
+	if (result != CURLE_OK) {
+		throw std::runtime_error("CURL request failed: " + std::string(curl_easy_strerror(static_cast<CURLcode>(result))));
+	}
+}
+
+bool inx::DeepSeek::Transfer::PrepareRetry(int result)
+{
+	if (Attempts > Options.MaxRetries || Cancelled || (Error && !ErrorRetryable)) {
+		return false;
+	}
+	if (Decoder && !Decoder->GetContent().empty()) {
+		// The consumer already has a part of this answer
+		return false;
+	}
+	bool transient = false;
+	switch (result) {
+	case CURLE_OK: {
+		long status = 0;
+		curl_easy_getinfo(static_cast<CURL*>(GetHandle()), CURLINFO_RESPONSE_CODE, &status);
+		transient = status == 429 || status == 500 || status == 502 || status == 503 || status == 504;
+		break;
+	}
+	case CURLE_COULDNT_RESOLVE_HOST:
+	case CURLE_COULDNT_CONNECT:
+	case CURLE_OPERATION_TIMEDOUT:
+	case CURLE_SSL_CONNECT_ERROR:
+	case CURLE_SEND_ERROR:
+	case CURLE_RECV_ERROR:
+	case CURLE_GOT_NOTHING:
+	case CURLE_PARTIAL_FILE:
+	case CURLE_HTTP2:
+	case CURLE_HTTP2_STREAM:
+		transient = true;
+		break;
+	default:
+		break;
+	}
+	if (!transient) {
+		return false;
+	}
+
+	Error = nullptr;
+	ErrorRetryable = false;
+	if (Body) {
+		Body->Rewind();
+	}
+	Borrowed->Response.clear();
+	if (Decoder) {
+		Decoder.emplace(OnDelta, Borrowed->Response);
+	}
+	return true;
+}
+
+void inx::DeepSeek::Transfer::Expire(const std::string& message, bool retryable)
+{
+	// An exception from a callback is kept, an expired first token timeout gives way to the deadline
+	if (!Error || ErrorRetryable) {
+		Error = std::make_exception_ptr(std::runtime_error(message));
+		ErrorRetryable = retryable;
+	}
+}
+
+void inx::DeepSeek::Transfer::OnFirstToken()
+{
+	Received = true;
+	if (Timers) {
+		Timers->Cancel(AttemptTimer);
+	}
+}
+
+std::string inx::DeepSeek::Transfer::GetCompletion(int result, Usage* usage)
+{
+	CheckResult(result);
+
+	// Parsed anyway with a scheduler, which counts it against the budget of the tenant
+	Usage reported;
+	Usage* output = usage ? usage : Scheduler ? &reported : nullptr;
+
+	std::string response_message;
+	if (Decoder) {
+		Decoder->Finish();
+		if (output) {
+			*output = ParseUsage(Decoder->GetUsageEvent());
+		}
+		response_message = Decoder->GetContent();
+	}
+	else {
+		nlohmann::json json_response = nlohmann::json::parse(Borrowed->Response);
+		response_message = json_response["choices"][0]["message"]["content"].get<std::string>();
+		if (output) {
+			*output = ParseUsage(json_response);
+		}
+	}
+	if (Scheduler) {
+		Scheduler->Complete(Ticket, *output);
+	}
+	return response_message;
+}
+
+inx::DeepSeek::Balance inx::DeepSeek::Transfer::GetBalance(int result)
+{
+	CheckResult(result);
+
+	nlohmann::json json_response = nlohmann::json::parse(Borrowed->Response);
+	Balance balance;
+	balance.IsAvailable = json_response["is_available"].get<bool>();
+	balance.Currency = json_response["balance_infos"][0]["currency"].get<std::string>();
+	balance.TotalBalance = std::stod(json_response["balance_infos"][0]["total_balance"].get<std::string>());
+	balance.GrantedBalance = std::stod(json_response["balance_infos"][0]["granted_balance"].get<std::string>());
+	balance.ToppedUpBalance = std::stod(json_response["balance_infos"][0]["topped_up_balance"].get<std::string>());
+	return balance;
+}
@@ -0,0 +1,192 @@
+// Compares the JSON string escaping (AppendJsonString, JsonStringLength and the chunked RequestBody reads) with nlohmann::json::dump,
+// on every instruction set the CPU supports.
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/JsonEscapeTest.cpp src/*.cpp -lcurl -o JsonEscapeTest && ./JsonEscapeTest
+#include "DeepSeekJson.h"
+#include "DeepSeekRequestBody.h"
+#include "DeepSeekSimd.h"
+#include <nlohmann/json.hpp>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace inx::DeepSeek;
+
+static size_t Failures = 0;
+
+static std::string Hex(std::string_view text)
+{
+	static constexpr char digits[] = "0123456789abcdef";
+	std::string hex;
+	for (size_t i = 0; i < text.size() && i < 48; i++) {
+		unsigned char c = static_cast<unsigned char>(text[i]);
+		hex += digits[c >> 4];
+		hex += digits[c & 15];
+	}
+	return text.size() > 48 ? hex + "... (" + std::to_string(text.size()) + " bytes)" : hex;
+}
+
+static void Fail(const char* check, std::string_view text)
+{
+	if (++Failures <= 20) {
+		std::cerr << check << " failed for " << Hex(text) << "\n";
+	}
+}
+
+// Reads the whole body with reads of at most capacity bytes
+static std::string ReadBody(RequestBody& body, size_t capacity)
+{
+	std::string output;
+	std::vector<char> buffer(capacity);
+	while (size_t read = body.Read(buffer.data(), buffer.size())) {
+		output.append(buffer.data(), read);
+	}
+	return output;
+}
+
+static void CheckValid(std::string_view text)
+{
+	std::string expected = nlohmann::json(std::string(text)).dump();
+
+	std::string written = "prefix";
+	AppendJsonString(written, text);
+	if (written != "prefix" + expected) {
+		Fail("AppendJsonString", text);
+	}
+	if (JsonStringLength(text) != expected.size()) {
+		Fail("JsonStringLength", text);
+	}
+
+	RequestBody body;
+	body.AppendLiteral("{\"content\":");
+	body.AppendString(text);
+	body.AppendLiteral("}");
+	std::string expected_body = "{\"content\":" + expected + "}";
+	if (body.size() != expected_body.size()) {
+		Fail("RequestBody::size", text);
+	}
+	for (size_t capacity : { size_t(1), size_t(7), size_t(4096), RequestBody::ChunkSize + 3 }) {
+		// Every read ends a chunk somewhere else, the small capacities are only used on the small texts
+		if (capacity < 4096 && text.size() > 4096) {
+			continue;
+		}
+		body.Rewind();
+		if (ReadBody(body, capacity) != expected_body) {
+			Fail("RequestBody::Read", text);
+		}
+	}
+}
+
+static void CheckInvalid(std::string_view text)
+{
+	bool nlohmann_throws = false;
+	try {
+		nlohmann::json(std::string(text)).dump();
+	}
+	catch (const nlohmann::json::type_error&) {
+		nlohmann_throws = true;
+	}
+	if (!nlohmann_throws) {
+		Fail("nlohmann rejecting the invalid UTF-8", text);
+	}
+
+	auto throws = [](auto&& function) {
+		try {
+			function();
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+		return false;
+	};
+	if (!throws([&]() { std::string output; AppendJsonString(output, text); })) {
+		Fail("AppendJsonString rejecting the invalid UTF-8", text);
+	}
+	if (!throws([&]() { JsonStringLength(text); })) {
+		Fail("JsonStringLength rejecting the invalid UTF-8", text);
+	}
+	if (!throws([&]() { RequestBody body; body.AppendString(text); })) {
+		Fail("RequestBody::AppendString rejecting the invalid UTF-8", text);
+	}
+}
+
+// Plain ASCII, every byte that needs an escape, and UTF-8 sequences of every length
+static const std::vector<std::string> Fragments = {
+	"a", "plain text ", "0123456789abcdef0123456789abcdef", "\"", "\\", "/", "\x7f", "\b", "\f", "\n", "\r", "\t",
+	std::string(1, '\0'), "\x01", "\x1f", "\xc3\xa9", "\xc2\x80", "\xdf\xbf", "\xe4\xb8\xad", "\xe0\xa0\x80", "\xef\xbf\xbf",
+	"\xed\x9f\xbf", "\xee\x80\x80", "\xf0\x9f\x98\x80", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf"
+};
+
+// Truncated, overlong, surrogates, above U+10FFFF, stray continuation bytes and bytes that never appear in UTF-8
+static const std::vector<std::string> InvalidSequences = {
+	"\x80", "\xbf", "\xc3", "\xc0\x80", "\xc1\xbf", "\xe4\xb8", "\xe0\x80\x80", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xed\xbf\xbf",
+	"\xf0\x9f\x98", "\xf0\x80\x80\x80", "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80", "\xf8\x88\x80\x80\x80",
+	"\xfe", "\xff", "\xc3\x28", "\xe4\x28\xad"
+};
+
+static void RunChecks(std::mt19937& random)
+{
+	// Every single byte, and every ASCII byte at every position of a vector block
+	for (int c = 0; c < 0x80; c++) {
+		CheckValid(std::string(1, static_cast<char>(c)));
+		for (size_t position = 0; position < 70; position++) {
+			std::string text(70, 'x');
+			text[position] = static_cast<char>(c);
+			CheckValid(text);
+		}
+	}
+
+	// Random mixes, of lengths around the block sizes
+	for (int i = 0; i < 20000; i++) {
+		std::string text;
+		size_t target = random() % 100;
+		while (text.size() < target) {
+			text += Fragments[random() % Fragments.size()];
+		}
+		CheckValid(text);
+	}
+
+	// Invalid UTF-8 at every position of a block
+	for (const std::string& invalid : InvalidSequences) {
+		for (size_t position = 0; position < 40; position++) {
+			std::string text(position, 'x');
+			text += invalid;
+			text += std::string(40 - position, 'y');
+			CheckInvalid(text);
+			CheckInvalid(std::string(position, 'x') + invalid);
+		}
+	}
+
+	// Texts escaped in several chunks by RequestBody, with sequences and escapes across the chunk boundaries
+	for (const std::string& fragment : Fragments) {
+		for (size_t offset = 0; offset < 5; offset++) {
+			std::string text(RequestBody::ChunkSize - offset, 'z');
+			while (text.size() < 2 * RequestBody::ChunkSize + 10) {
+				text += fragment;
+			}
+			CheckValid(text);
+		}
+	}
+	std::string invalid_late(RequestBody::ChunkSize + 100, 'z');
+	invalid_late += "\xed\xa0\x80";
+	CheckInvalid(invalid_late);
+}
+
+int main()
+{
+	const char* names[] = { "scalar", "SSE4.2", "AVX2" };
+	for (InstructionSet requested : { InstructionSet::Scalar, InstructionSet::SSE42, InstructionSet::AVX2 }) {
+		SetInstructionSet(requested);
+		if (GetInstructionSet() != requested) {
+			std::cout << names[static_cast<int>(requested)] << ": not supported by this CPU, skipped\n";
+			continue;
+		}
+		size_t failures = Failures;
+		std::mt19937 random(40);
+		RunChecks(random);
+		std::cout << names[static_cast<int>(requested)] << ": " << (Failures == failures ? "ok" : "FAILED") << "\n";
+	}
+	return Failures == 0 ? 0 : 1;
+}
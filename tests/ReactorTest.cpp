@@ -0,0 +1,283 @@
+// Checks the reactor driven by an event loop (see EventLoopHooks) without sending anything: the transfers wait for a scheduler slot held by the test,
+// so they never reach curl. Covers the wakeups, the deadlines, the granted and cancelled transfers, stopping and the backpressure of the submission queue.
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/ReactorTest.cpp src/*.cpp -lcurl -o ReactorTest && ./ReactorTest
+#include "DeepSeekReactor.h"
+#include <curl/curl.h>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+using namespace inx::DeepSeek;
+using namespace std::chrono_literals;
+
+static size_t Failures = 0;
+
+static void Check(bool condition, const char* check)
+{
+	if (!condition) {
+		Failures++;
+		std::cerr << check << " failed\n";
+	}
+}
+
+// Records the calls of the reactor to its event loop
+struct LoopRecorder {
+	size_t Wakeups = 0;
+	size_t Timers = 0;
+	size_t Sockets = 0;
+	long LastTimeout = -1;
+
+	EventLoopHooks Hooks()
+	{
+		EventLoopHooks hooks;
+		hooks.WatchSocket = [this](SocketHandle, SocketInterest) { Sockets++; };
+		hooks.SetTimer = [this](long timeout_ms) { Timers++; LastTimeout = timeout_ms; };
+		hooks.Wakeup = [this]() { Wakeups++; };
+		return hooks;
+	}
+
+	size_t Calls() const { return Wakeups + Timers + Sockets; }
+};
+
+class TestTransfer : public Transfer {
+public:
+	using Transfer::Transfer;
+
+	void OnDone(int result) noexcept override
+	{
+		Result = result;
+		DoneCount++;
+	}
+
+	int Result = -1;
+	size_t DoneCount = 0;
+};
+
+// Transfers of a scheduler whose only slot is held by the test, so they wait in it
+struct Fixture {
+	std::shared_ptr<ConnectionPool> Pool = std::make_shared<ConnectionPool>();
+	std::shared_ptr<const RequestHeaders> Headers = std::make_shared<RequestHeaders>("test", std::vector<CustomHeader>());
+	std::shared_ptr<RequestScheduler> Scheduler;
+	RequestScheduler::Ticket Held;
+
+	Fixture()
+	{
+		SchedulerOptions options;
+		options.MaxInFlight = 1;
+		options.ReservedSlots = 0;
+		Scheduler = std::make_shared<RequestScheduler>(options);
+		Scheduler->Acquire(Held);
+	}
+
+	std::shared_ptr<TestTransfer> Make(std::optional<std::chrono::milliseconds> timeout = {})
+	{
+		auto transfer = std::make_shared<TestTransfer>(Pool, Headers);
+		transfer->PrepareCompletion(RequestBody());
+		transfer->SetScheduler(Scheduler, RequestPriority::Normal, "", "", 10);
+		transfer->Options.Timeout = timeout;
+		return transfer;
+	}
+
+	size_t Waiting() const { return Scheduler->GetStats()[RequestPriority::Normal].Waiting; }
+};
+
+static void CheckHooksRequired()
+{
+	bool throws = false;
+	try {
+		Reactor reactor{ EventLoopHooks() };
+	}
+	catch (const std::runtime_error&) {
+		throws = true;
+	}
+	Check(throws, "Rejecting missing hooks");
+}
+
+static void CheckWaitingTransfers()
+{
+	Fixture fixture;
+	LoopRecorder loop;
+	Reactor reactor(loop.Hooks());
+	auto first = fixture.Make();
+	auto expiring = fixture.Make(30ms);
+	auto last = fixture.Make();
+
+	// A single wakeup for the submissions made until the loop picks them up
+	reactor.GetCore()->Submit(first);
+	reactor.GetCore()->Submit(expiring);
+	reactor.GetCore()->Submit(last);
+	Check(loop.Wakeups == 1, "Coalescing the wakeups");
+	Check(reactor.GetActiveTransfers() == 3, "Counting the submitted transfers");
+	Check(reactor.GetSubmissionStats().Queued == 3, "Queueing the submitted transfers");
+
+	reactor.ProcessSubmitted();
+	Check(reactor.GetSubmissionStats().Queued == 0, "Emptying the queue");
+	Check(fixture.Waiting() == 3, "Waiting for the scheduler");
+	// Rounded up to the next millisecond, so the timer is never early
+	Check(loop.LastTimeout >= 0 && loop.LastTimeout <= 31, "Asking for the timer of the deadline");
+	reactor.GetCore()->Submit(fixture.Make());
+	Check(loop.Wakeups == 2, "Waking up again once the queue was picked up");
+	reactor.ProcessSubmitted();
+
+	// The deadline runs while the transfer waits, and takes it out of the scheduler
+	std::this_thread::sleep_for(40ms);
+	reactor.OnTimeout();
+	Check(expiring->DoneCount == 1 && expiring->Result == CURLE_OPERATION_TIMEDOUT, "Expiring a waiting transfer");
+	Check(first->DoneCount == 0 && last->DoneCount == 0, "Keeping the other transfers");
+	Check(fixture.Waiting() == 3 && reactor.GetActiveTransfers() == 3, "Leaving the scheduler on expiry");
+
+	// Granted on the thread releasing the slot, started by the loop: cancelled ones end there, without reaching curl
+	first->Cancel();
+	fixture.Scheduler->Leave(fixture.Held);
+	Check(loop.Wakeups == 3, "Waking up for a granted transfer");
+	Check(first->DoneCount == 0, "Starting the granted transfer on the loop thread");
+	reactor.ProcessSubmitted();
+	Check(first->DoneCount == 1 && first->Result == CURLE_ABORTED_BY_CALLBACK, "Ending a cancelled granted transfer");
+	Check(reactor.GetActiveTransfers() == 2, "Counting the done transfers");
+
+	reactor.Stop();
+	Check(last->DoneCount == 1 && last->Result == CURLE_ABORTED_BY_CALLBACK, "Failing the waiting transfers on stop");
+	Check(reactor.GetActiveTransfers() == 0 && fixture.Scheduler->GetStats().InFlight == 0 && fixture.Waiting() == 0, "Leaving the scheduler on stop");
+}
+
+static void CheckStop()
+{
+	Fixture fixture;
+	LoopRecorder loop;
+	Reactor reactor(loop.Hooks());
+	auto waiting = fixture.Make(1000ms);
+	auto queued = fixture.Make();
+	reactor.GetCore()->Submit(waiting);
+	reactor.ProcessSubmitted();
+	// Still in the submission queue when the reactor stops
+	reactor.GetCore()->Submit(queued);
+	reactor.Stop();
+	Check(waiting->DoneCount == 1 && queued->DoneCount == 1, "Failing the waiting and the queued transfers on stop");
+	Check(fixture.Waiting() == 0 && reactor.GetTimerStats().Pending == 0, "Cancelling their scheduling and their timers");
+
+	size_t calls = loop.Calls();
+	bool throws = false;
+	try {
+		reactor.GetCore()->Submit(fixture.Make());
+	}
+	catch (const std::runtime_error&) {
+		throws = true;
+	}
+	Check(throws, "Rejecting the submissions once stopped");
+	reactor.OnTimeout();
+	reactor.ProcessSubmitted();
+	Check(loop.Calls() == calls, "Not calling the loop once stopped");
+	Check(waiting->DoneCount == 1, "Ending the transfers once");
+}
+
+static void CheckCancel()
+{
+	Fixture fixture;
+	LoopRecorder loop;
+	Reactor reactor(loop.Hooks());
+	auto waiting = fixture.Make(1000ms);
+	reactor.GetCore()->Submit(waiting);
+	reactor.ProcessSubmitted();
+	Check(fixture.Waiting() == 1, "Waiting for the scheduler");
+
+	// Cancelled from another thread, ended by the loop thread without waiting for the slot
+	size_t wakeups = loop.Wakeups;
+	std::thread canceller([&]() { reactor.GetCore()->Cancel(waiting); });
+	canceller.join();
+	Check(loop.Wakeups == wakeups + 1 && waiting->DoneCount == 0, "Waking up for a cancelled transfer");
+	reactor.ProcessSubmitted();
+	Check(waiting->DoneCount == 1 && waiting->Result == CURLE_ABORTED_BY_CALLBACK, "Ending a cancelled waiting transfer");
+	Check(fixture.Waiting() == 0 && reactor.GetActiveTransfers() == 0 && reactor.GetTimerStats().Pending == 0, "Leaving the scheduler on cancel");
+	reactor.GetCore()->Cancel(waiting);
+	reactor.ProcessSubmitted();
+	Check(waiting->DoneCount == 1, "Ending a transfer cancelled twice once");
+
+	// Cancelled while still in the submission queue, it never waits for a slot
+	auto queued = fixture.Make();
+	reactor.GetCore()->Submit(queued);
+	reactor.GetCore()->Cancel(queued);
+	reactor.ProcessSubmitted();
+	Check(queued->DoneCount == 1 && fixture.Waiting() == 0 && reactor.GetActiveTransfers() == 0, "Ending a transfer cancelled in the queue");
+
+	// The slot held by the test isn't handed to a cancelled transfer
+	fixture.Scheduler->Leave(fixture.Held);
+	Check(fixture.Scheduler->GetStats().InFlight == 0, "Granting no cancelled transfer");
+	reactor.Stop();
+}
+
+static void CheckBackpressure()
+{
+	auto submit = [](Reactor& reactor, const std::shared_ptr<Transfer>& transfer) {
+		try {
+			reactor.GetCore()->Submit(transfer);
+			return true;
+		}
+		catch (const std::runtime_error&) {
+			return false;
+		}
+	};
+
+	{
+		Fixture fixture;
+		LoopRecorder loop;
+		Reactor reactor(loop.Hooks(), SubmissionOptions{ 2, Backpressure::Fail });
+		auto first = fixture.Make();
+		auto second = fixture.Make();
+		auto third = fixture.Make();
+		Check(submit(reactor, first) && submit(reactor, second), "Filling the queue");
+		Check(!submit(reactor, third), "Failing a submission to a full queue");
+		Check(reactor.GetSubmissionStats().Rejected == 1 && reactor.GetActiveTransfers() == 2, "Counting the rejected submission");
+		reactor.ProcessSubmitted();
+		Check(submit(reactor, third), "Submitting once the queue was emptied");
+		reactor.Stop();
+		Check(first->DoneCount == 1 && second->DoneCount == 1 && third->DoneCount == 1, "Failing the transfers on stop");
+	}
+	{
+		Fixture fixture;
+		LoopRecorder loop;
+		Reactor reactor(loop.Hooks(), SubmissionOptions{ 2, Backpressure::DropOldest });
+		auto oldest = fixture.Make();
+		auto second = fixture.Make();
+		auto newest = fixture.Make();
+		Check(submit(reactor, oldest) && submit(reactor, second) && submit(reactor, newest), "Submitting to a full queue dropping the oldest");
+		Check(reactor.GetSubmissionStats().Dropped == 1 && oldest->DoneCount == 0, "Dropping the oldest transfer");
+		reactor.ProcessSubmitted();
+		Check(oldest->DoneCount == 1 && oldest->Result == CURLE_ABORTED_BY_CALLBACK, "Failing the dropped transfer on the loop thread");
+		Check(second->DoneCount == 0 && newest->DoneCount == 0 && fixture.Waiting() == 2, "Keeping the newer transfers");
+		reactor.Stop();
+	}
+	{
+		// The loop thread can't wait for itself to empty the queue
+		Fixture fixture;
+		LoopRecorder loop;
+		Reactor reactor(loop.Hooks(), SubmissionOptions{ 2, Backpressure::Block });
+		reactor.ProcessSubmitted();
+		Check(submit(reactor, fixture.Make()) && submit(reactor, fixture.Make()), "Filling the queue from the loop thread");
+		Check(!submit(reactor, fixture.Make()), "Failing instead of blocking the loop thread");
+		Check(reactor.GetSubmissionStats().Rejected == 1, "Counting the submission failed on the loop thread");
+
+		// Another thread waits until the loop makes room
+		auto blocked = fixture.Make();
+		std::thread producer([&]() { reactor.GetCore()->Submit(blocked); });
+		while (reactor.GetSubmissionStats().Blocked == 0) {
+			std::this_thread::yield();
+		}
+		reactor.ProcessSubmitted();
+		producer.join();
+		Check(reactor.GetActiveTransfers() == 3, "Submitting once the loop made room");
+		reactor.Stop();
+		Check(blocked->DoneCount == 1, "Failing the blocked submission on stop");
+	}
+}
+
+int main()
+{
+	CheckHooksRequired();
+	CheckWaitingTransfers();
+	CheckStop();
+	CheckCancel();
+	CheckBackpressure();
+	std::cout << (Failures == 0 ? "ok" : "FAILED") << "\n";
+	return Failures == 0 ? 0 : 1;
+}
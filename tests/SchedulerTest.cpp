@@ -0,0 +1,347 @@
+// Checks the request scheduler on its own, with requests that only take and give back slots: the classes and the slots reserved from Batch,
+// the deadlines within a tenant, requests leaving while they wait, the shares of the tenants and their rejections, and the shortest requests first.
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/SchedulerTest.cpp src/*.cpp -lcurl -o SchedulerTest && ./SchedulerTest
+#include "DeepSeekScheduler.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using namespace std::chrono_literals;
+using Clock = RequestScheduler::Clock;
+
+static size_t Failures = 0;
+
+static void Check(bool condition, const char* check)
+{
+	if (!condition) {
+		Failures++;
+		std::cerr << check << " failed\n";
+	}
+}
+
+// Requests numbered in the order they're created, recording the order they get their slot in
+struct Requests {
+	std::shared_ptr<RequestScheduler> Scheduler;
+	std::vector<std::unique_ptr<RequestScheduler::Ticket>> Tickets;
+	std::vector<size_t> Granted;
+
+	explicit Requests(SchedulerOptions options)
+		: Scheduler(std::make_shared<RequestScheduler>(options))
+	{
+	}
+
+	// Returns the number of the request, which got its slot right away if it's in Granted
+	size_t Add(RequestPriority priority, std::string tenant = "", size_t prompt_tokens = 100, Clock::time_point deadline = Clock::time_point::max(), std::string tag = "")
+	{
+		size_t index = Tickets.size();
+		Tickets.push_back(std::make_unique<RequestScheduler::Ticket>());
+		RequestScheduler::Ticket& ticket = *Tickets.back();
+		ticket.Priority = priority;
+		ticket.Tenant = std::move(tenant);
+		ticket.PromptTokens = prompt_tokens;
+		ticket.Deadline = deadline;
+		ticket.Tag = std::move(tag);
+		if (Scheduler->TryAcquire(ticket, [this, index]() { Granted.push_back(index); })) {
+			Granted.push_back(index);
+		}
+		return index;
+	}
+
+	void Leave(size_t index) { Scheduler->Leave(*Tickets[index]); }
+
+	bool IsGranted(size_t index) const { return std::find(Granted.begin(), Granted.end(), index) != Granted.end(); }
+
+	// Gives the slot of the request granted first back, over and over, until nothing waits anymore
+	void Drain()
+	{
+		for (size_t next = 0; next < Granted.size(); next++) {
+			Leave(Granted[next]);
+		}
+	}
+
+	// Returns whether the tenant rejected the request
+	bool IsRejected(std::string tenant, size_t prompt_tokens = 100)
+	{
+		try {
+			Add(RequestPriority::Normal, std::move(tenant), prompt_tokens);
+			return false;
+		}
+		catch (const std::runtime_error&) {
+			return true;
+		}
+	}
+
+	size_t Waiting(RequestPriority priority) const { return Scheduler->GetStats()[priority].Waiting; }
+};
+
+static void CheckClasses()
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 2;
+	options.ReservedSlots = 1;
+	Requests requests(options);
+
+	// Batch can't take the reserved slot, the other classes can
+	size_t batch = requests.Add(RequestPriority::Batch);
+	size_t waiting_batch = requests.Add(RequestPriority::Batch);
+	size_t normal = requests.Add(RequestPriority::Normal);
+	Check(requests.IsGranted(batch) && !requests.IsGranted(waiting_batch) && requests.IsGranted(normal), "Keeping the reserved slot from Batch");
+
+	// Arriving lowest class first, granted highest class first
+	size_t late_batch = requests.Add(RequestPriority::Batch);
+	size_t late_normal = requests.Add(RequestPriority::Normal);
+	size_t interactive = requests.Add(RequestPriority::Interactive);
+	// Batch waited when the three requests of higher classes arrived
+	Check(requests.Scheduler->GetStats()[RequestPriority::Batch].Preempted == 3, "Counting the requests going ahead of Batch");
+	Check(requests.Scheduler->GetStats()[RequestPriority::Normal].Preempted == 1, "Counting the requests going ahead of Normal");
+
+	requests.Leave(batch);
+	Check(requests.Granted.back() == interactive, "Granting the highest class waiting");
+	requests.Leave(interactive);
+	Check(requests.Granted.back() == late_normal, "Granting the next class once the higher one is done");
+	requests.Leave(late_normal);
+	Check(requests.Granted.size() == 4 && requests.Scheduler->GetStats().InFlight == 1, "Leaving the reserved slot free with only Batch waiting");
+	requests.Leave(normal);
+	Check(requests.Granted.back() == waiting_batch, "Granting Batch in arrival order");
+	requests.Leave(waiting_batch);
+	Check(requests.Granted.back() == late_batch, "Granting the last Batch request");
+	requests.Leave(late_batch);
+	Check(requests.Scheduler->GetStats().InFlight == 0, "Giving every slot back");
+}
+
+static void CheckDeadlines()
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 1;
+	options.ReservedSlots = 0;
+	Requests requests(options);
+	Clock::time_point now = Clock::now();
+	size_t held = requests.Add(RequestPriority::Normal);
+
+	// The earliest deadline first, then the requests without one in arrival order
+	size_t no_deadline = requests.Add(RequestPriority::Normal);
+	size_t late = requests.Add(RequestPriority::Normal, "", 100, now + 30s);
+	size_t early = requests.Add(RequestPriority::Normal, "", 100, now + 10s);
+	size_t middle = requests.Add(RequestPriority::Normal, "", 100, now + 20s);
+	size_t last = requests.Add(RequestPriority::Normal);
+	// A deadline doesn't take a request ahead of a higher class
+	size_t interactive = requests.Add(RequestPriority::Interactive);
+	requests.Drain();
+	Check(requests.Granted == std::vector<size_t>({ held, interactive, early, middle, late, no_deadline, last }), "Granting by class, then earliest deadline");
+}
+
+static void CheckLeaveWaiting()
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 1;
+	options.ReservedSlots = 0;
+	Requests requests(options);
+	size_t held = requests.Add(RequestPriority::Normal, "a");
+	size_t first = requests.Add(RequestPriority::Normal, "a");
+	size_t alone = requests.Add(RequestPriority::Normal, "b");
+	size_t second = requests.Add(RequestPriority::Normal, "a");
+	Check(requests.Waiting(RequestPriority::Normal) == 3, "Queueing the requests");
+
+	// Out of the queue, and out of the round once its tenant has nothing left waiting
+	requests.Leave(first);
+	requests.Leave(alone);
+	Check(requests.Waiting(RequestPriority::Normal) == 1 && requests.Scheduler->GetStats().Tenants["b"].Waiting == 0, "Leaving the queue");
+	requests.Leave(first);
+	Check(requests.Waiting(RequestPriority::Normal) == 1, "Leaving twice");
+
+	requests.Leave(held);
+	Check(requests.Granted == std::vector<size_t>({ held, second }), "Granting only the request still waiting");
+	requests.Leave(second);
+	Check(requests.Scheduler->GetStats().InFlight == 0 && requests.Waiting(RequestPriority::Normal) == 0, "Giving every slot back");
+
+	// A tenant leaving its turn doesn't stall the round: the next tenant gets the slot
+	size_t holder = requests.Add(RequestPriority::Normal, "a");
+	size_t leaving = requests.Add(RequestPriority::Normal, "a");
+	size_t other = requests.Add(RequestPriority::Normal, "b");
+	requests.Leave(leaving);
+	requests.Leave(holder);
+	Check(requests.Granted.back() == other, "Passing the turn of a tenant that left");
+	requests.Leave(other);
+}
+
+static void CheckShares()
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 1;
+	options.ReservedSlots = 0;
+	options.Quantum = 100;
+	{
+		// Weights 2 and 1: two requests of the first tenant per turn, one of the second
+		Requests requests(options);
+		requests.Scheduler->SetTenant("heavy", TenantOptions{ 2 });
+		size_t held = requests.Add(RequestPriority::Normal, "holder");
+		for (size_t i = 0; i < 30; i++) {
+			requests.Add(RequestPriority::Normal, "heavy");
+			requests.Add(RequestPriority::Normal, "light");
+		}
+		requests.Leave(held);
+		for (size_t next = 1; next <= 30; next++) {
+			requests.Leave(requests.Granted[next]);
+		}
+		size_t heavy = 0;
+		for (size_t next = 1; next <= 30; next++) {
+			heavy += requests.Tickets[requests.Granted[next]]->Tenant == "heavy" ? 1 : 0;
+		}
+		Check(heavy == 20, "Sharing the slots by weight");
+		requests.Drain();
+	}
+	{
+		// Equal weights, large requests against small ones: the same tokens, not the same number of requests
+		Requests requests(options);
+		size_t held = requests.Add(RequestPriority::Normal, "holder");
+		for (size_t i = 0; i < 10; i++) {
+			requests.Add(RequestPriority::Normal, "large", 1000);
+		}
+		for (size_t i = 0; i < 100; i++) {
+			requests.Add(RequestPriority::Normal, "small", 100);
+		}
+		requests.Leave(held);
+		size_t large_tokens = 0;
+		size_t small_tokens = 0;
+		for (size_t next = 1; next < requests.Granted.size() && large_tokens < 5000; next++) {
+			const RequestScheduler::Ticket& ticket = *requests.Tickets[requests.Granted[next]];
+			(ticket.Tenant == "large" ? large_tokens : small_tokens) += ticket.PromptTokens;
+			requests.Leave(requests.Granted[next]);
+		}
+		Check(small_tokens + 1000 >= large_tokens && small_tokens <= large_tokens + 1000, "Sharing the tokens, whatever the size of the requests");
+		requests.Drain();
+	}
+	{
+		// A tenant at its cap leaves the free slots to the others, even unused
+		options.MaxInFlight = 3;
+		Requests requests(options);
+		requests.Scheduler->SetTenant("capped", TenantOptions{ 1, 1 });
+		for (size_t i = 0; i < 3; i++) {
+			requests.Add(RequestPriority::Normal, "capped");
+		}
+		requests.Add(RequestPriority::Normal, "free");
+		SchedulerStats stats = requests.Scheduler->GetStats();
+		Check(stats.InFlight == 2 && stats.Tenants["capped"].InFlight == 1 && stats.Tenants["capped"].Waiting == 2, "Capping the requests of a tenant in flight");
+		// Raising the cap hands the free slot over
+		requests.Scheduler->SetTenant("capped", TenantOptions{ 1, 2 });
+		Check(requests.Scheduler->GetStats().InFlight == 3, "Granting the free slot once the cap is raised");
+		requests.Drain();
+	}
+}
+
+static void CheckRejections()
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 1;
+	options.ReservedSlots = 0;
+	{
+		// Charged their prompt on arrival, rejected once the budget is spent
+		Requests requests(options);
+		TenantOptions budget;
+		budget.TokensPerMinute = 250;
+		requests.Scheduler->SetTenant("budget", budget);
+		size_t held = requests.Add(RequestPriority::Normal, "budget");
+		size_t waiting = requests.Add(RequestPriority::Normal, "budget");
+		Check(!requests.IsRejected("budget"), "Accepting a request within the budget");
+		Check(requests.IsRejected("budget"), "Rejecting a request over the budget");
+		Check(requests.Scheduler->GetStats().Tenants["budget"].Rejected == 1, "Counting the rejected request");
+		Check(!requests.IsRejected("other"), "Accepting the requests of another tenant");
+
+		// A request leaving the queue was never sent, its charge is given back
+		requests.Leave(waiting);
+		Check(!requests.IsRejected("budget"), "Giving the charge of a request leaving the queue back");
+		Check(requests.IsRejected("budget"), "Rejecting again once the budget is spent");
+
+		// The usage reported replaces the estimate charged
+		Usage usage;
+		usage.PromptTokens = 5;
+		usage.CompletionTokens = 5;
+		usage.TotalTokens = 10;
+		requests.Scheduler->Complete(*requests.Tickets[held], usage);
+		requests.Leave(held);
+		Check(!requests.IsRejected("budget"), "Correcting the charge with the usage reported");
+		requests.Drain();
+	}
+	{
+		Requests requests(options);
+		TenantOptions queue;
+		queue.MaxQueued = 2;
+		requests.Scheduler->SetTenant("queue", queue);
+		requests.Add(RequestPriority::Normal, "queue");
+		size_t first = requests.Add(RequestPriority::Normal, "queue");
+		requests.Add(RequestPriority::Normal, "queue");
+		Check(requests.IsRejected("queue"), "Rejecting a request beyond the queue of its tenant");
+		Check(requests.Scheduler->GetStats().Tenants["queue"].Rejected == 1 && requests.Waiting(RequestPriority::Normal) == 2, "Queueing nothing rejected");
+		requests.Leave(first);
+		Check(!requests.IsRejected("queue"), "Accepting a request once the queue has room");
+		requests.Drain();
+	}
+}
+
+static void CheckShortestFirst()
+{
+	SchedulerOptions options;
+	options.MaxInFlight = 1;
+	options.ReservedSlots = 0;
+	options.ShortestPredictedFirst = true;
+	Requests requests(options);
+
+	// Learns that a request of a tag takes at least 20 ms once granted, and 400 completion tokens
+	size_t learned = requests.Add(RequestPriority::Normal, "", 100, Clock::time_point::max(), "essay");
+	std::this_thread::sleep_for(20ms);
+	Usage usage;
+	usage.PromptTokens = 100;
+	usage.CompletionTokens = 400;
+	usage.TotalTokens = 500;
+	requests.Scheduler->Complete(*requests.Tickets[learned], usage);
+	requests.Leave(learned);
+	// And a short one, which the other requests get, quickly
+	size_t label = requests.Add(RequestPriority::Normal, "", 100, Clock::time_point::max(), "label");
+	usage.CompletionTokens = 5;
+	usage.TotalTokens = 105;
+	requests.Scheduler->Complete(*requests.Tickets[label], usage);
+	requests.Leave(label);
+	TagStats essay = requests.Scheduler->GetStats().Tags["essay"];
+	Check(essay.PredictedCompletionTokens == 400 && essay.PredictedServiceMs >= 20, "Learning the completion and the service time of a tag");
+
+	// By prompt plus predicted completion, whatever the arrival order; a far deadline doesn't change it
+	Clock::time_point now = Clock::now();
+	size_t held = requests.Add(RequestPriority::Normal);
+	size_t long_prompt = requests.Add(RequestPriority::Normal, "", 600, Clock::time_point::max(), "label");
+	size_t long_completion = requests.Add(RequestPriority::Normal, "", 100, now + 1h, "essay");
+	size_t shortest = requests.Add(RequestPriority::Normal, "", 50, Clock::time_point::max(), "label");
+	size_t shorter = requests.Add(RequestPriority::Normal, "", 200, Clock::time_point::max(), "label");
+	// Its slack (30 ms left, minus the 20 ms it takes) is below the time it takes: it goes first
+	size_t urgent = requests.Add(RequestPriority::Normal, "", 100, now + 30ms, "essay");
+	// Both promoted: the least slack first
+	size_t urgent_long = requests.Add(RequestPriority::Normal, "", 1000, now + 5ms, "essay");
+	requests.Drain();
+	Check(requests.Granted == std::vector<size_t>({ learned, label, held, urgent_long, urgent, shortest, shorter, long_completion, long_prompt }), "Granting the shortest first, and the requests close to their deadline ahead");
+	Check(requests.Scheduler->GetStats().InFlight == 0 && requests.Waiting(RequestPriority::Normal) == 0, "Giving every slot back");
+
+	// A promoted request leaving the queue leaves the promotions too
+	held = requests.Add(RequestPriority::Normal);
+	size_t leaving = requests.Add(RequestPriority::Normal, "", 100, now, "essay");
+	size_t remaining = requests.Add(RequestPriority::Normal, "", 300, Clock::time_point::max(), "label");
+	requests.Leave(leaving);
+	requests.Leave(held);
+	Check(requests.Granted.back() == remaining, "Leaving the queue once promoted");
+	requests.Leave(remaining);
+}
+
+int main()
+{
+	CheckClasses();
+	CheckDeadlines();
+	CheckLeaveWaiting();
+	CheckShares();
+	CheckRejections();
+	CheckShortestFirst();
+	std::cout << (Failures == 0 ? "ok" : "FAILED") << "\n";
+	return Failures == 0 ? 0 : 1;
+}
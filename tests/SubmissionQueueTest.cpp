@@ -0,0 +1,225 @@
+// Checks the submission queue of the reactors on its own: capacity, order, full and closed queues, popping from the producers (Backpressure::DropOldest),
+// and that concurrent producers lose and duplicate nothing.
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/SubmissionQueueTest.cpp src/*.cpp -lcurl -o SubmissionQueueTest && ./SubmissionQueueTest
+#include "DeepSeekSubmissionQueue.h"
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace inx::DeepSeek;
+
+static size_t Failures = 0;
+
+static void Check(bool condition, const char* check)
+{
+	if (!condition) {
+		Failures++;
+		std::cerr << check << " failed\n";
+	}
+}
+
+// A transfer numbered by its producer, never started
+class TestTransfer : public Transfer {
+public:
+	TestTransfer(size_t producer, size_t index)
+		: Transfer(Pool, Headers), Producer(producer), Index(index)
+	{
+	}
+
+	size_t Producer;
+	size_t Index;
+
+	static inline std::shared_ptr<ConnectionPool> Pool = std::make_shared<ConnectionPool>();
+	static inline std::shared_ptr<const RequestHeaders> Headers = std::make_shared<RequestHeaders>("test", std::vector<CustomHeader>());
+};
+
+static std::shared_ptr<Transfer> Make(size_t index, size_t producer = 0)
+{
+	return std::make_shared<TestTransfer>(producer, index);
+}
+
+static size_t IndexOf(const std::shared_ptr<Transfer>& transfer)
+{
+	return static_cast<const TestTransfer&>(*transfer).Index;
+}
+
+static void CheckCapacity()
+{
+	Check(SubmissionQueue(5).capacity() == 8, "Rounding the capacity up to a power of two");
+	Check(SubmissionQueue(8).capacity() == 8, "Keeping a power of two");
+	Check(SubmissionQueue(0).capacity() == 2, "Holding at least two cells");
+}
+
+static void CheckFullAndOrder()
+{
+	SubmissionQueue queue(4);
+	std::shared_ptr<Transfer> popped;
+	Check(!queue.TryPop(popped) && queue.size() == 0 && queue.IsDrained(), "Popping nothing from an empty queue");
+
+	// Several laps of the ring, so the sequences of the cells wrap around
+	size_t next_push = 0;
+	size_t next_pop = 0;
+	bool ordered = true;
+	bool full = true;
+	for (size_t lap = 0; lap < 5; lap++) {
+		while (true) {
+			std::shared_ptr<Transfer> transfer = Make(next_push);
+			SubmissionQueue::PushResult result = queue.TryPush(transfer);
+			if (result == SubmissionQueue::PushResult::Full) {
+				// Left to the caller, which still owns the transfer
+				full &= transfer != nullptr && queue.size() == 4;
+				break;
+			}
+			full &= result == SubmissionQueue::PushResult::Pushed && transfer == nullptr;
+			next_push++;
+		}
+		// Emptied partially, so the next lap starts in the middle of the ring
+		for (size_t i = 0; i < 3; i++) {
+			ordered &= queue.TryPop(popped) && IndexOf(popped) == next_pop++;
+		}
+	}
+	Check(full, "Filling the queue to its capacity, and not taking the transfer when full");
+	while (queue.TryPop(popped)) {
+		ordered &= IndexOf(popped) == next_pop++;
+	}
+	Check(ordered && next_pop == next_push, "Popping the transfers in the order they were pushed");
+	Check(queue.size() == 0 && queue.IsDrained(), "Draining the queue");
+}
+
+static void CheckDropOldest()
+{
+	// What a producer does with Backpressure::DropOldest: pops the oldest transfer itself, then pushes again
+	SubmissionQueue queue(4);
+	for (size_t i = 0; i < 4; i++) {
+		std::shared_ptr<Transfer> transfer = Make(i);
+		queue.TryPush(transfer);
+	}
+	std::shared_ptr<Transfer> newest = Make(4);
+	std::shared_ptr<Transfer> dropped;
+	std::thread producer([&]() {
+		if (queue.TryPush(newest) == SubmissionQueue::PushResult::Full && queue.TryPop(dropped)) {
+			queue.TryPush(newest);
+		}
+	});
+	producer.join();
+	Check(dropped && IndexOf(dropped) == 0 && !newest, "Dropping the oldest transfer from a producer");
+
+	std::shared_ptr<Transfer> popped;
+	bool ordered = true;
+	for (size_t i = 1; i <= 4; i++) {
+		ordered &= queue.TryPop(popped) && IndexOf(popped) == i;
+	}
+	Check(ordered && queue.IsDrained(), "Keeping the order of the newer transfers");
+}
+
+static void CheckClosed()
+{
+	SubmissionQueue queue(4);
+	std::shared_ptr<Transfer> first = Make(0);
+	queue.TryPush(first);
+	queue.Close();
+	std::shared_ptr<Transfer> late = Make(1);
+	Check(queue.TryPush(late) == SubmissionQueue::PushResult::Closed && late, "Rejecting a push once closed");
+	Check(queue.size() == 1 && !queue.IsDrained(), "Keeping the transfers queued before closing");
+
+	std::shared_ptr<Transfer> popped;
+	Check(queue.TryPop(popped) && IndexOf(popped) == 0, "Popping a transfer queued before closing");
+	Check(!queue.TryPop(popped) && queue.IsDrained(), "Draining a closed queue");
+
+	// Full and closed: closed wins, so a blocked producer stops waiting
+	SubmissionQueue full(2);
+	for (size_t i = 0; i < 2; i++) {
+		std::shared_ptr<Transfer> transfer = Make(i);
+		full.TryPush(transfer);
+	}
+	full.Close();
+	Check(full.TryPush(late) == SubmissionQueue::PushResult::Closed, "Rejecting a push to a full closed queue");
+}
+
+static void CheckConcurrent(bool drop_oldest)
+{
+	// Producers racing each other and a consumer (and, dropping the oldest, popping from each other) on a small queue
+	const size_t producers = 8;
+	const size_t count = 5000;
+	SubmissionQueue queue(64);
+	std::vector<std::vector<size_t>> received(producers);
+	std::vector<std::vector<size_t>> dropped(producers);
+	std::vector<std::vector<std::shared_ptr<Transfer>>> dropped_by(producers);
+	std::atomic<size_t> done = 0;
+
+	std::vector<std::thread> threads;
+	for (size_t p = 0; p < producers; p++) {
+		threads.emplace_back([&, p]() {
+			for (size_t i = 0; i < count; i++) {
+				std::shared_ptr<Transfer> transfer = Make(i, p);
+				while (queue.TryPush(transfer) != SubmissionQueue::PushResult::Pushed) {
+					std::shared_ptr<Transfer> oldest;
+					if (drop_oldest && queue.TryPop(oldest)) {
+						dropped_by[p].push_back(std::move(oldest));
+					}
+					else {
+						std::this_thread::yield();
+					}
+				}
+			}
+			done++;
+		});
+	}
+	std::shared_ptr<Transfer> popped;
+	while (done < producers || !queue.IsDrained()) {
+		if (queue.TryPop(popped)) {
+			const TestTransfer& transfer = static_cast<const TestTransfer&>(*popped);
+			received[transfer.Producer].push_back(transfer.Index);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+	for (auto& list : dropped_by) {
+		for (const std::shared_ptr<Transfer>& transfer : list) {
+			const TestTransfer& test = static_cast<const TestTransfer&>(*transfer);
+			dropped[test.Producer].push_back(test.Index);
+		}
+	}
+
+	// Every transfer once, either received or dropped, and a producer's transfers received in its order
+	bool complete = true;
+	bool ordered = true;
+	size_t total_dropped = 0;
+	for (size_t p = 0; p < producers; p++) {
+		std::vector<bool> seen(count, false);
+		for (size_t list = 0; list < 2; list++) {
+			for (size_t index : list == 0 ? received[p] : dropped[p]) {
+				complete &= index < count && !seen[index];
+				seen[index] = true;
+			}
+		}
+		for (bool was_seen : seen) {
+			complete &= was_seen;
+		}
+		for (size_t i = 1; i < received[p].size(); i++) {
+			ordered &= received[p][i - 1] < received[p][i];
+		}
+		total_dropped += dropped[p].size();
+	}
+	Check(complete, drop_oldest ? "Receiving or dropping every transfer once, dropping the oldest" : "Receiving every transfer once");
+	Check(ordered, "Receiving the transfers of a producer in order");
+	Check(drop_oldest || total_dropped == 0, "Dropping nothing without popping from the producers");
+}
+
+int main()
+{
+	CheckCapacity();
+	CheckFullAndOrder();
+	CheckDropOldest();
+	CheckClosed();
+	CheckConcurrent(false);
+	CheckConcurrent(true);
+	std::cout << (Failures == 0 ? "ok" : "FAILED") << "\n";
+	return Failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+// Checks the timer wheel on a simulated clock: timers fire on the first Advance at or after their due time and in due order, on every level,
+// across the cascades (due exactly on a level boundary included) and beyond the span of the wheel, and GetNextDue leads to them.
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/TimerWheelTest.cpp src/*.cpp -lcurl -o TimerWheelTest && ./TimerWheelTest
+#include "DeepSeekTimerWheel.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace inx::DeepSeek;
+using Clock = TimerWheel::Clock;
+using Ms = std::chrono::milliseconds;
+
+static size_t Failures = 0;
+
+static void Check(bool condition, const char* check)
+{
+	if (!condition) {
+		Failures++;
+		std::cerr << check << " failed\n";
+	}
+}
+
+// A fixed start, so every tick is exact
+static const Clock::time_point Start = Clock::time_point(std::chrono::hours(1));
+
+// Advances the wheel through GetNextDue until the time given, and returns the number of steps
+static size_t AdvanceTo(TimerWheel& wheel, Clock::time_point time)
+{
+	size_t steps = 0;
+	while (std::optional<Clock::time_point> next = wheel.GetNextDue()) {
+		if (*next > time) {
+			break;
+		}
+		wheel.Advance(*next);
+		steps++;
+	}
+	wheel.Advance(time);
+	return steps;
+}
+
+static void CheckBoundaries()
+{
+	// Due exactly when a level turns: the timer is cascaded down on that tick and must fire on it, not on the next one
+	for (std::uint64_t tick : { 1ull, 63ull, 64ull, 65ull, 4095ull, 4096ull, 4097ull, 262144ull, 16777216ull }) {
+		TimerWheel wheel(Start);
+		TimerWheel::Timer timer;
+		bool fired = false;
+		wheel.Schedule(timer, Start + Ms(tick), [&]() { fired = true; });
+		AdvanceTo(wheel, Start + Ms(tick - 1));
+		Check(!fired, "Not firing a timer before its due tick");
+		wheel.Advance(Start + Ms(tick));
+		Check(fired, "Firing a timer on its due tick");
+		Check(!timer.IsScheduled() && wheel.size() == 0, "Unscheduling a fired timer");
+	}
+
+	// Rounded up to the next tick, so never early
+	TimerWheel wheel(Start);
+	TimerWheel::Timer timer;
+	bool fired = false;
+	wheel.Schedule(timer, Start + Ms(10) + std::chrono::microseconds(500), [&]() { fired = true; });
+	wheel.Advance(Start + Ms(10) + std::chrono::microseconds(900));
+	Check(!fired, "Not firing a timer due between two ticks early");
+	wheel.Advance(Start + Ms(11));
+	Check(fired, "Firing a timer due between two ticks on the next one");
+
+	// Already due: on the next tick, not during the current Advance
+	wheel.Advance(Start + Ms(20));
+	fired = false;
+	wheel.Schedule(timer, Start + Ms(5), [&]() { fired = true; });
+	wheel.Advance(Start + Ms(20));
+	Check(!fired, "Not firing a past timer on the current tick");
+	wheel.Advance(Start + Ms(21));
+	Check(fired, "Firing a past timer on the next tick");
+}
+
+static void CheckOrdering(std::mt19937& random)
+{
+	TimerWheel wheel(Start);
+	const size_t count = 20000;
+	std::vector<std::unique_ptr<TimerWheel::Timer>> timers;
+	std::vector<std::uint64_t> due(count);
+	std::vector<std::uint64_t> fired_at(count, 0);
+	std::vector<size_t> order;
+	std::uint64_t now = 0;
+	for (size_t i = 0; i < count; i++) {
+		// Spread over the first three levels, with clusters on the same ticks
+		due[i] = 1 + random() % (i % 2 ? 300000 : 5000);
+		timers.push_back(std::make_unique<TimerWheel::Timer>());
+		wheel.Schedule(*timers[i], Start + Ms(due[i]), [&, i]() { fired_at[i] = now; order.push_back(i); });
+	}
+	// A few cancelled, and a few rescheduled later
+	for (size_t i = 0; i < count; i += 97) {
+		wheel.Cancel(*timers[i]);
+		due[i] = 0;
+	}
+	for (size_t i = 1; i < count; i += 89) {
+		due[i] += 1000;
+		wheel.Schedule(*timers[i], Start + Ms(due[i]), [&, i]() { fired_at[i] = now; order.push_back(i); });
+	}
+	size_t scheduled = wheel.size();
+
+	// Advanced in irregular steps, sometimes through GetNextDue
+	while (wheel.size() != 0) {
+		std::optional<Clock::time_point> next = wheel.GetNextDue();
+		if (random() % 2) {
+			now = static_cast<std::uint64_t>((*next - Start) / Ms(1));
+		}
+		else {
+			now += 1 + random() % 3000;
+		}
+		wheel.Advance(Start + Ms(now));
+	}
+
+	bool exact = true;
+	for (size_t i = 0; i < count; i++) {
+		if (due[i] == 0) {
+			exact &= fired_at[i] == 0;
+		}
+		else {
+			// Fired by the first Advance reaching the due tick
+			exact &= fired_at[i] >= due[i] && (fired_at[i] == due[i] || fired_at[i] - due[i] < 3000);
+		}
+	}
+	Check(exact, "Firing every timer on the first Advance reaching it, and no cancelled one");
+	Check(order.size() == scheduled, "Firing every scheduled timer once");
+	Check(std::is_sorted(order.begin(), order.end(), [&](size_t a, size_t b) { return due[a] < due[b]; }), "Firing in due order");
+
+	TimerStats stats = wheel.GetStats();
+	Check(stats.Fired == scheduled && stats.Pending == 0 && stats.Cascades != 0, "Counting the fired timers and the cascades");
+}
+
+static void CheckNextDue()
+{
+	TimerWheel wheel(Start);
+	Check(!wheel.GetNextDue(), "No next due time without timers");
+
+	TimerWheel::Timer near;
+	TimerWheel::Timer far;
+	wheel.Schedule(near, Start + Ms(10), []() {});
+	Check(wheel.GetNextDue() == Start + Ms(10), "Returning the due time of a first level timer");
+
+	// A far timer is reached through the cascades, never skipped: every step is at most its due time
+	bool fired = false;
+	const Clock::time_point far_due = Start + Ms(5000000);
+	wheel.Schedule(far, far_due, [&]() { fired = true; });
+	size_t steps = 0;
+	bool never_late = true;
+	while (!fired && steps < 100) {
+		Clock::time_point next = *wheel.GetNextDue();
+		never_late &= next <= far_due;
+		wheel.Advance(next);
+		steps++;
+	}
+	Check(fired && never_late, "Reaching a far timer through GetNextDue");
+	Check(steps <= TimerWheel::Levels + 1, "Reaching a far timer in one step per level");
+	Check(!wheel.GetNextDue(), "No next due time once every timer fired");
+
+	// Beyond the span of the wheel, it waits in the last level and is placed again from there
+	const Clock::time_point beyond = Start + Ms((std::uint64_t(1) << (TimerWheel::SlotBits * TimerWheel::Levels)) * 3 + 12345);
+	fired = false;
+	wheel.Schedule(far, beyond, [&]() { fired = true; });
+	AdvanceTo(wheel, beyond - Ms(1));
+	Check(!fired, "Not firing a timer beyond the span early");
+	wheel.Advance(beyond);
+	Check(fired, "Firing a timer beyond the span on its due tick");
+}
+
+static void CheckCallbacks()
+{
+	TimerWheel wheel(Start);
+	TimerWheel::Timer repeating;
+	TimerWheel::Timer cancelled;
+	std::vector<std::uint64_t> ticks;
+	bool cancelled_fired = false;
+	std::function<void()> repeat = [&]() {
+		ticks.push_back(ticks.size());
+		// Rescheduling itself from its callback, and cancelling another timer due on the same tick
+		wheel.Cancel(cancelled);
+		if (ticks.size() < 5) {
+			wheel.Schedule(repeating, Start + Ms(64 * (ticks.size() + 1)), repeat);
+			wheel.Schedule(cancelled, Start + Ms(64 * (ticks.size() + 1)), [&]() { cancelled_fired = true; });
+		}
+	};
+	wheel.Schedule(repeating, Start + Ms(64), repeat);
+	wheel.Schedule(cancelled, Start + Ms(64), [&]() { cancelled_fired = true; });
+	wheel.Advance(Start + Ms(1000));
+	Check(ticks.size() == 5 && wheel.size() == 0, "Rescheduling a timer from its callback");
+	Check(!cancelled_fired, "Cancelling a timer from a callback on the same tick");
+}
+
+int main()
+{
+	std::mt19937 random(46);
+	CheckBoundaries();
+	CheckOrdering(random);
+	CheckNextDue();
+	CheckCallbacks();
+	std::cout << (Failures == 0 ? "ok" : "FAILED") << "\n";
+	return Failures == 0 ? 0 : 1;
+}
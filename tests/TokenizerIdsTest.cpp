@@ -0,0 +1,59 @@
+// Compares Tokenizer::Encode and CountTokens with the reference token ids of Hugging Face tokenizers (see generate_tokenizer_ids.py).
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/TokenizerIdsTest.cpp src/*.cpp -lcurl -o TokenizerIdsTest && ./TokenizerIdsTest [tokenizer.json] [ids.json]
+#include "DeepSeekTokenizer.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace inx::DeepSeek;
+
+static std::string Escape(std::string_view text)
+{
+	return nlohmann::json(std::string(text)).dump(-1, ' ', true, nlohmann::json::error_handler_t::replace);
+}
+
+static std::string Join(const std::vector<int>& ids)
+{
+	std::string joined;
+	for (int id : ids) {
+		joined += " " + std::to_string(id);
+	}
+	return joined;
+}
+
+int main(int argc, char** argv)
+{
+	const char* tokenizer_path = argc > 1 ? argv[1] : "tests/data/bpe_tokenizer.json";
+	const char* path = argc > 2 ? argv[2] : "tests/data/tokenizer_ids.json";
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::cerr << "Failed to open " << path << "\n";
+		return 1;
+	}
+	nlohmann::json cases = nlohmann::json::parse(file);
+	Tokenizer tokenizer(tokenizer_path);
+
+	size_t failures = 0;
+	for (const auto& test_case : cases) {
+		std::string text = test_case[0].get<std::string>();
+		std::vector<int> expected = test_case[1].get<std::vector<int>>();
+		std::vector<int> ids = tokenizer.Encode(text);
+		// Counted twice, the second count comes from the memo of the message
+		Message message(Message::Role::User, text);
+		size_t message_tokens = expected.size() + Tokenizer::MessageOverhead(Message::Role::User);
+		bool counts_match = tokenizer.CountTokens(text) == expected.size() && tokenizer.CountTokens(message) == message_tokens
+			&& tokenizer.CountTokens(message) == message_tokens;
+		if (ids == expected && counts_match) {
+			continue;
+		}
+		if (++failures <= 10) {
+			std::cerr << "Encode " << Escape(text) << "\n  expected:" << Join(expected) << "\n  actual:  " << Join(ids)
+				<< "\n  count:    " << tokenizer.CountTokens(text) << "\n";
+		}
+	}
+	std::cout << cases.size() - failures << " of " << cases.size() << " encodings match\n";
+	return failures == 0 ? 0 : 1;
+}
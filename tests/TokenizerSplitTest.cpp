@@ -0,0 +1,48 @@
+// Compares Tokenizer::Split with the reference splits of the DeepSeek-V3 pre-tokenizer (see generate_pretokenizer_splits.py).
+// Build and run from the repository root:
+//   g++ -std=c++20 -Iinclude -Iext tests/TokenizerSplitTest.cpp src/*.cpp -lcurl -o TokenizerSplitTest && ./TokenizerSplitTest
+#include "DeepSeekTokenizer.h"
+#include <nlohmann/json.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static std::string Escape(std::string_view text)
+{
+	return nlohmann::json(std::string(text)).dump(-1, ' ', true, nlohmann::json::error_handler_t::replace);
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = argc > 1 ? argv[1] : "tests/data/pretokenizer_splits.json";
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		std::cerr << "Failed to open " << path << "\n";
+		return 1;
+	}
+	nlohmann::json cases = nlohmann::json::parse(file);
+
+	size_t failures = 0;
+	for (const auto& test_case : cases) {
+		std::string text = test_case[0].get<std::string>();
+		std::vector<std::string> expected = test_case[1].get<std::vector<std::string>>();
+		std::vector<std::string_view> pieces = inx::DeepSeek::Tokenizer::Split(text);
+		if (std::equal(pieces.begin(), pieces.end(), expected.begin(), expected.end())) {
+			continue;
+		}
+		if (++failures <= 10) {
+			std::cerr << "Split " << Escape(text) << "\n  expected:";
+			for (const auto& piece : expected) {
+				std::cerr << " " << Escape(piece);
+			}
+			std::cerr << "\n  actual:  ";
+			for (const auto& piece : pieces) {
+				std::cerr << " " << Escape(piece);
+			}
+			std::cerr << "\n";
+		}
+	}
+	std::cout << cases.size() - failures << " of " << cases.size() << " splits match\n";
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+# Regenerates data/pretokenizer_splits.json, the reference splits TokenizerSplitTest compares Tokenizer::Split with.
+# The reference is the DeepSeek-V3 pre-tokenizer of Hugging Face tokenizers (pip install tokenizers).
+import json
+import random
+import sys
+from pathlib import Path
+from tokenizers import pre_tokenizers, Regex
+
+# The Split steps of the pre_tokenizer in the DeepSeek-V3 tokenizer.json, its final ByteLevel step doesn't split
+PATTERNS = [
+    r"\p{N}{1,3}",
+    "[\u4e00-\u9fa5\u3040-\u309f\u30a0-\u30ff]+",
+    r"[!\"#$%&'()*+,\-./:;<=>?@\[\\\]^_`{|}~][A-Za-z]+|[^\r\n\p{L}\p{P}\p{S}]?[\p{L}\p{M}]+| ?[\p{P}\p{S}]+[\r\n]*|\s*[\r\n]+|\s+(?!\S)|\s+",
+]
+
+# Words, numbers, whitespace and punctuation of several scripts, with the format characters (\p{Cf}) found in chat text
+FRAGMENTS = [
+    "hello", "World", " ", "  ", "\n", "\r\n", "\n\n", "\t", "123", "45678", "3.14", "\uff0c", "\u3002", "\u4e2d\u6587",
+    "\u65e5\u672c\u8a9e", "\u30ab\u30bf\u30ab\u30ca", "\u3072\u3089\u304c\u306a", "\ud55c\uad6d\uc5b4", "\u00e9", "na\u00efve",
+    "e\u0301", "\u00df", "\u041f\u0440\u0438\u0432\u0435\u0442", "\u0645\u0631\u062d\u0628\u0627", "\u0661\u0662\u0663",
+    "\u0939\u093f\u0928\u094d\u0926\u0940", "\u0e44\u0e17\u0e22", "\U0001f600", "\U0001f468\u200d\U0001f469\u200d\U0001f467",
+    "!", "?!", "...", "'s", "(x)", "```", "->", "$", "\u20ac", "\u00b1", "\u00bd", "\u00b2", "\u216b", "\u00a0", "\u3000",
+    "\u0085", "\x01", "\x7f", "",
+    # \p{Cf}
+    "\u00ad", "\u0600", "\u061c", "\u06dd", "\u070f", "\u08e2", "\u180e", "\u200b", "\u200c", "\u200d", "\u200e", "\u200f",
+    "\u202a", "\u202e", "\u2060", "\u2061", "\u2066", "\u2069", "\ufeff", "\ufff9", "\U000110bd", "\U0001d173", "\U000e0001",
+    "\U000e0041",
+]
+
+
+def main():
+    count = int(sys.argv[1]) if len(sys.argv) > 1 else 1000
+    pre_tokenizer = pre_tokenizers.Sequence([pre_tokenizers.Split(Regex(pattern), "isolated") for pattern in PATTERNS])
+    rng = random.Random(28)
+    cases = []
+    for _ in range(count):
+        text = "".join(rng.choice(FRAGMENTS) for _ in range(rng.randint(1, 12)))
+        cases.append({"text": text, "pieces": [piece for piece, _ in pre_tokenizer.pre_tokenize_str(text)]})
+    output = Path(__file__).parent / "data" / "pretokenizer_splits.json"
+    # One case per line, as [text, [pieces...]]
+    lines = (json.dumps([case["text"], case["pieces"]], ensure_ascii=True) for case in cases)
+    output.write_text("[\n" + ",\n".join(lines) + "\n]\n", encoding="utf-8")
+
+
+if __name__ == "__main__":
+    main()
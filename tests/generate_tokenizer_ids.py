@@ -0,0 +1,63 @@
+# Regenerates data/tokenizer_ids.json, the reference token ids TokenizerIdsTest compares Tokenizer::Encode and CountTokens with.
+# The reference is Hugging Face tokenizers (pip install tokenizers), with the DeepSeek-V3 pre-tokenizer.
+# By default it trains a small byte-level BPE on the fragments of generate_pretokenizer_splits.py and saves it as data/bpe_tokenizer.json,
+# so the fixtures need no download. Pass the path of a DeepSeek tokenizer.json to generate them for the real vocabulary instead:
+#   python3 tests/generate_tokenizer_ids.py [tokenizer.json]
+import json
+import random
+import sys
+from pathlib import Path
+from tokenizers import Regex, Tokenizer, models, pre_tokenizers, trainers
+
+from generate_pretokenizer_splits import FRAGMENTS, PATTERNS
+
+DATA = Path(__file__).parent / "data"
+
+WORDS = [
+    "the", "of", "and", "to", "in", "is", "that", "for", "it", "with", "as", "was", "on", "request", "token", "model", "context",
+    "window", "scheduler", "tenant", "stream", "message", "history", "summary", "prompt", "completion", "function", "return",
+    "value", "const", "std::string", "nullptr", "int main()", "{", "}", "();", "//", "#include", "0x7f", "1024", "2026",
+]
+
+
+def pre_tokenizer():
+    # The Split steps, then the ByteLevel mapping of the DeepSeek-V3 tokenizer.json, without its regex
+    steps = [pre_tokenizers.Split(Regex(pattern), "isolated") for pattern in PATTERNS]
+    steps.append(pre_tokenizers.ByteLevel(add_prefix_space=False, use_regex=False))
+    return pre_tokenizers.Sequence(steps)
+
+
+def random_text(rng, length):
+    parts = []
+    for _ in range(length):
+        parts.append(rng.choice(WORDS) + " " if rng.random() < 0.6 else rng.choice(FRAGMENTS))
+    return "".join(parts)
+
+
+def train(rng):
+    tokenizer = Tokenizer(models.BPE())
+    tokenizer.pre_tokenizer = pre_tokenizer()
+    trainer = trainers.BpeTrainer(vocab_size=3000, initial_alphabet=pre_tokenizers.ByteLevel.alphabet(), show_progress=False)
+    tokenizer.train_from_iterator((random_text(rng, 40) for _ in range(4000)), trainer)
+    path = DATA / "bpe_tokenizer.json"
+    tokenizer.save(str(path))
+    return tokenizer
+
+
+def main():
+    rng = random.Random(30)
+    if len(sys.argv) > 1:
+        tokenizer = Tokenizer.from_file(sys.argv[1])
+    else:
+        tokenizer = train(rng)
+    cases = []
+    for _ in range(1000):
+        text = random_text(rng, rng.randint(1, 30))
+        cases.append([text, tokenizer.encode(text, add_special_tokens=False).ids])
+    # One case per line, as [text, [ids...]]
+    lines = (json.dumps(case, ensure_ascii=True) for case in cases)
+    (DATA / "tokenizer_ids.json").write_text("[\n" + ",\n".join(lines) + "\n]\n", encoding="utf-8")
+
+
+if __name__ == "__main__":
+    main()